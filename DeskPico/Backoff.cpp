@@ -0,0 +1,30 @@
+//=========================================================================
+//  Backoff.cpp
+//  Implementation of the jittered exponential backoff.
+//=========================================================================
+
+#include "Backoff.h"
+
+Backoff::Backoff(uint32_t baseMs, uint32_t maxMs)
+    : baseMs(baseMs), maxMs(maxMs)
+{
+}
+
+uint32_t Backoff::next(uint32_t random) {
+    uint32_t delay = baseMs;
+    for (uint32_t i = 0; i < _attempts && delay < maxMs; i++) {
+        delay *= 2;
+    }
+    if (delay > maxMs) {
+        delay = maxMs;
+    }
+    if (_attempts < UINT32_MAX) {
+        _attempts++;
+    }
+    uint32_t half = delay / 2;
+    return delay - half + random % (half + 1);
+}
+
+void Backoff::reset() {
+    _attempts = 0;
+}
@@ -0,0 +1,30 @@
+//=========================================================================
+//  Backoff.h
+//  Jittered exponential backoff for reconnect attempts.
+//  Each failure doubles the delay, up to a cap; the actual wait is drawn
+//  from the upper half of it ("equal jitter"), so a fleet that lost the
+//  broker at the same moment does not come back in lockstep, while every
+//  desk still waits at least half the nominal delay.
+//  Pure C++; the caller supplies the random number (get_rand_32()).
+//=========================================================================
+
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <cstdint>
+
+class Backoff {
+public:
+    Backoff(uint32_t baseMs, uint32_t maxMs);
+
+    uint32_t next(uint32_t random);                                          // Delay before the next attempt
+    void reset();                                                            // After a success
+    uint32_t attempts() const { return _attempts; }                          // Failures since the last reset
+
+private:
+    uint32_t baseMs;
+    uint32_t maxMs;
+    uint32_t _attempts = 0;
+};
+
+#endif
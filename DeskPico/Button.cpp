@@ -1,15 +1,118 @@
 #include "Button.h"
 #include "pico/stdlib.h"
+#include "hardware/irq.h"
 
 
+static Button* buttons[NUM_BANK0_GPIOS];           // Pin -> instance, for the shared IRQ handler
+
 Button::Button(unsigned int pinNumber) : pin(pinNumber) {
 
 	gpio_init(pin);
     gpio_set_dir(pin, GPIO_IN);
     gpio_pull_down(pin);
+
+    pressed = gpio_get(pin);
+    buttons[pin] = this;
+    // Only this pin: other bank 0 pins (the CYW43 host wake on GPIO 24)
+    // have raw handlers of their own on the same IRQ
+    gpio_add_raw_irq_handler(pin, onGpioIrq);
+    gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+Button::~Button() {
+    gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+    gpio_remove_raw_irq_handler(pin, onGpioIrq);
+    buttons[pin] = nullptr;
+    if (debounceAlarm > 0) {
+        cancel_alarm(debounceAlarm);
+    }
+    if (longPressAlarm > 0) {
+        cancel_alarm(longPressAlarm);
+    }
 }
 
 bool Button::read() const {
     return gpio_get(pin);
 }
 
+bool Button::pollEvent(ButtonEvent& event) {
+    uint8_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    event = queue[h % QUEUE_LEN];
+    head.store((uint8_t)(h + 1), std::memory_order_release);
+    return true;
+}
+
+void Button::push(ButtonEventType type, uint32_t timestamp_ms) {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    if ((uint8_t)(t - head.load(std::memory_order_acquire)) >= QUEUE_LEN) {
+        dropped++;
+        return;
+    }
+    queue[t % QUEUE_LEN] = { type, timestamp_ms };
+    tail.store((uint8_t)(t + 1), std::memory_order_release);
+    if (notify) {
+        notify(notifyArg);
+    }
+}
+
+// Every edge (bounces included) restarts the debounce alarm; the state is
+// sampled once the line has been quiet for DEBOUNCE_MS.
+void Button::onGpioIrq() {
+    for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+        Button* b = buttons[gpio];
+        if (b == nullptr) continue;
+        uint32_t events = gpio_get_irq_event_mask(gpio) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+        if (!events) continue;
+        gpio_acknowledge_irq(gpio, events);
+        if (b->debounceAlarm > 0) {
+            cancel_alarm(b->debounceAlarm);
+        }
+        b->debounceAlarm = add_alarm_in_ms(DEBOUNCE_MS, onDebounce, b, true);
+    }
+}
+
+int64_t Button::onDebounce(alarm_id_t id, void* user_data) {
+    Button* b = static_cast<Button*>(user_data);
+    b->debounceAlarm = 0;
+    b->settle(to_ms_since_boot(get_absolute_time()));
+    return 0;
+}
+
+int64_t Button::onLongPress(alarm_id_t id, void* user_data) {
+    Button* b = static_cast<Button*>(user_data);
+    b->longPressAlarm = 0;
+    if (b->pressed) {
+        b->push(ButtonEventType::LongPress, to_ms_since_boot(get_absolute_time()));
+        b->armedForDouble = false;              // A long press never starts a double press
+    }
+    return 0;
+}
+
+void Button::settle(uint32_t now_ms) {
+    bool level = gpio_get(pin);
+    if (level == pressed) {
+        return;                                 // Bounce that ended where it started
+    }
+    pressed = level;
+    if (pressed) {
+        push(ButtonEventType::Press, now_ms);
+        if (armedForDouble && now_ms - lastRelease_ms <= DOUBLE_PRESS_MS) {
+            push(ButtonEventType::DoublePress, now_ms);
+            armedForDouble = false;
+        } else {
+            armedForDouble = true;
+        }
+        longPressAlarm = add_alarm_in_ms(LONG_PRESS_MS, onLongPress, this, true);
+    } else {
+        if (longPressAlarm > 0) {
+            cancel_alarm(longPressAlarm);
+            longPressAlarm = 0;
+        }
+        push(ButtonEventType::Release, now_ms);
+        lastRelease_ms = now_ms;
+    }
+}
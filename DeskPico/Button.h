@@ -2,16 +2,69 @@
 #define BUTTON_H
 
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "pico/stdlib.h"
 
+enum class ButtonEventType : uint8_t {
+	Press,
+	Release,
+	LongPress,                                  // Still held LONG_PRESS_MS after the press
+	DoublePress,                                // Second press within DOUBLE_PRESS_MS of a release (follows its Press)
+};
+
+struct ButtonEvent {
+	ButtonEventType type;
+	uint32_t timestamp_ms;                      // Time since boot of the debounced edge
+};
+
+// Push button (active high, pulled down). Edges are captured by GPIO
+// interrupt, debounced with an alarm and turned into timestamped events
+// that the application drains with pollEvent().
 class Button {
 public:
+	static constexpr uint32_t DEBOUNCE_MS = 20;
+	static constexpr uint32_t LONG_PRESS_MS = 800;
+	static constexpr uint32_t DOUBLE_PRESS_MS = 300;
+	static constexpr size_t QUEUE_LEN = 8;  // Power of two
+
 	Button(unsigned int pinNumber);
+	~Button();
+	Button(const Button&) = delete;             // Registered by address with the IRQ handler
+	Button& operator=(const Button&) = delete;
 
 	// Read current raw button state (true = pressed)
 	bool read() const;
 
+	// Takes the oldest pending event; false if there is none
+	bool pollEvent(ButtonEvent& event);
+
+	// Events lost because the queue was full
+	uint32_t droppedEvents() const { return dropped; }
+
+	// Called from interrupt context after each queued event (wakes the main loop)
+	void setNotify(void (*handler)(void* arg), void* arg) { notifyArg = arg; notify = handler; }
+
 private:
+	static void onGpioIrq();                    // Raw handler, registered for each button's pin only
+	static int64_t onDebounce(alarm_id_t id, void* user_data);
+	static int64_t onLongPress(alarm_id_t id, void* user_data);
+	void settle(uint32_t now_ms);               // Debounced state change
+	void push(ButtonEventType type, uint32_t timestamp_ms);
+
 	unsigned int pin;
+	bool pressed = false;                       // Debounced state
+	uint32_t lastRelease_ms = 0;
+	bool armedForDouble = false;                // Last press was a single press
+	alarm_id_t debounceAlarm = 0;
+	alarm_id_t longPressAlarm = 0;
+
+	ButtonEvent queue[QUEUE_LEN];
+	std::atomic<uint8_t> head{0};               // Written by the consumer
+	std::atomic<uint8_t> tail{0};               // Written by interrupt context
+	uint32_t dropped = 0;
+	void (*volatile notify)(void* arg) = nullptr;
+	void* notifyArg = nullptr;
 };
 
-#endif // REDLED_H
+#endif // BUTTON_H
@@ -1,23 +1,125 @@
 #include "Buzzer.h"
 #include "pico/stdlib.h"
+#include "hardware/pwm.h"
+#include "hardware/clocks.h"
+#include <algorithm>
 
 
 Buzzer::Buzzer(unsigned int pinNumber) : pin(pinNumber) {
-    gpio_init(pin);
-    gpio_set_dir(pin, GPIO_OUT);
+    gpio_set_function(pin, GPIO_FUNC_PWM);
+    slice = pwm_gpio_to_slice_num(pin);
+    channel = pwm_gpio_to_channel(pin);
+    pwm_set_chan_level(slice, channel, 0);
+    pwm_set_enabled(slice, false);
+    critical_section_init(&lock);
 }
 
 
 void Buzzer::buzzTone(unsigned int frequency, unsigned int duration_ms) {
     if (frequency == 0 || duration_ms == 0) return;
+    // Lowest: the integer divider at 255 with a full 16-bit wrap
+    unsigned int lowest = clock_get_hz(clk_sys) / (255u * 65536u) + 1;
+    frequency = std::clamp(frequency, lowest, (unsigned int)UINT16_MAX);
+    duration_ms = std::min(duration_ms, (unsigned int)UINT16_MAX);
+    BuzzerNote note = { (uint16_t)frequency, (uint16_t)duration_ms, defaultVolume };
+    play(&note, 1);
+}
+
+void Buzzer::rest(unsigned int duration_ms) {
+    if (duration_ms == 0) return;
+    duration_ms = std::min(duration_ms, (unsigned int)UINT16_MAX);
+    BuzzerNote note = { 0, (uint16_t)duration_ms, 0 };
+    play(&note, 1);
+}
 
-    unsigned int cycles = (frequency * duration_ms) / 1000;
-    unsigned int half_period_us = 500000u / frequency;
+bool Buzzer::play(const BuzzerNote* notes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (notes[i].duration_ms == 0) return false;       // Would end without an alarm to start the next
+    }
+    critical_section_enter_blocking(&lock);
+    if (count + n > QUEUE_LEN) {
+        critical_section_exit(&lock);
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        enqueue(notes[i]);
+    }
+    bool started = true;
+    if (!playing) {
+        uint32_t us = startNext();
+        if (us) {
+            alarm = add_alarm_in_us(us, onNoteEnd, this, true);
+        }
+        if (alarm < 0) {                                   // No alarm slot: nothing would end the note
+            count = 0;
+            playing = false;
+            output(0, 0);
+            started = false;
+        }
+    }
+    critical_section_exit(&lock);
+    return started;
+}
 
-    for (unsigned int i = 0; i < cycles; ++i) {
-        gpio_put(pin, 1);
-        sleep_us(half_period_us);
-        gpio_put(pin, 0);
-        sleep_us(half_period_us);
+void Buzzer::stop() {
+    critical_section_enter_blocking(&lock);
+    if (playing) {
+        cancel_alarm(alarm);
     }
+    count = 0;
+    playing = false;
+    output(0, 0);
+    critical_section_exit(&lock);
+}
+
+bool Buzzer::enqueue(const BuzzerNote& note) {
+    if (count >= QUEUE_LEN) return false;
+    queue[(head + count) % QUEUE_LEN] = note;
+    count++;
+    return true;
+}
+
+// Pops the next note and drives the PWM for it
+uint32_t Buzzer::startNext() {
+    if (count == 0) {
+        playing = false;
+        output(0, 0);
+        return 0;
+    }
+    BuzzerNote note = queue[head];
+    head = (head + 1) % QUEUE_LEN;
+    count--;
+    playing = true;
+    output(note.frequency, note.volume);
+    return (uint32_t)note.duration_ms * 1000u;
+}
+
+// Alarm context. A positive return reschedules relative to the previous
+// deadline, so a long pattern does not drift.
+int64_t Buzzer::onNoteEnd(alarm_id_t id, void* user_data) {
+    Buzzer* self = static_cast<Buzzer*>(user_data);
+    critical_section_enter_blocking(&self->lock);
+    uint32_t us = self->startNext();
+    critical_section_exit(&self->lock);
+    return us;
+}
+
+// Programs the slice for a square wave at frequency; volume sets the duty
+void Buzzer::output(uint16_t frequency, uint8_t volume) {
+    if (frequency == 0 || volume == 0) {
+        pwm_set_chan_level(slice, channel, 0);
+        pwm_set_enabled(slice, false);
+        return;
+    }
+    // Smallest integer divider that keeps wrap within 16 bits
+    uint32_t sys = clock_get_hz(clk_sys);
+    uint32_t div = sys / ((uint32_t)frequency * 65536u) + 1;
+    if (div > 255) div = 255;
+    uint32_t top = sys / (div * frequency) - 1;
+    if (top > 0xFFFF) top = 0xFFFF;
+
+    pwm_set_clkdiv_int_frac(slice, (uint8_t)div, 0);
+    pwm_set_wrap(slice, (uint16_t)top);
+    pwm_set_chan_level(slice, channel, (uint16_t)(((top + 1) * volume) / 510));
+    pwm_set_enabled(slice, true);
 }
@@ -2,13 +2,52 @@
 #define BUZZER_H
 
 #include <cstdint>
+#include <cstddef>
+#include "pico/stdlib.h"
+#include "pico/sync.h"
 
+// One step of a buzzer pattern. frequency 0 is a rest.
+struct BuzzerNote {
+    uint16_t frequency;        // Hz
+    uint16_t duration_ms;
+    uint8_t volume;            // 0-255, mapped onto PWM duty (255 = 50 %)
+};
+
+// Piezo buzzer on a hardware PWM slice. Notes are queued and sequenced
+// from alarm interrupts, so playing a pattern never blocks the caller.
 class Buzzer {
 public: 
+    static constexpr size_t QUEUE_LEN = 16;
+
     Buzzer(unsigned int pinNumber);
+
+    // Queues a tone, clamped to what the PWM divider can reach; returns immediately.
     void buzzTone(unsigned int frequency, unsigned int duration_ms);
+    void rest(unsigned int duration_ms);
+    // Queues a whole pattern; false if it does not fit in the queue, a
+    // note has no duration or no alarm was free to sequence it.
+    bool play(const BuzzerNote* notes, size_t count);
+    void stop();                                           // Silence and drop queued notes
+    bool isPlaying() const { return playing; }
+    void setVolume(uint8_t volume) { defaultVolume = volume; }
+
 private:
+    static int64_t onNoteEnd(alarm_id_t id, void* user_data);
+    bool enqueue(const BuzzerNote& note);                  // Caller holds lock
+    uint32_t startNext();                                  // Caller holds lock; returns duration in us, 0 when idle
+    void output(uint16_t frequency, uint8_t volume);
+
     unsigned int pin;
+    uint slice;
+    uint channel;
+    uint8_t defaultVolume = 255;
+
+    critical_section_t lock;                               // Shared with the alarm callback
+    BuzzerNote queue[QUEUE_LEN];
+    size_t head = 0;                                       // Next note to play
+    size_t count = 0;                                      // Notes waiting
+    volatile bool playing = false;
+    alarm_id_t alarm = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,264 @@
+//=========================================================================
+//  Cbor.cpp
+//  Implementation of the streaming CBOR writer and reader.
+//=========================================================================
+
+#include "Cbor.h"
+#include <cstring>
+
+namespace {
+
+enum : uint8_t {
+    MAJOR_UNSIGNED = 0,
+    MAJOR_NEGATIVE = 1,
+    MAJOR_BYTES = 2,
+    MAJOR_TEXT = 3,
+    MAJOR_ARRAY = 4,
+    MAJOR_MAP = 5,
+    MAJOR_TAG = 6,
+    MAJOR_SIMPLE = 7,
+};
+
+constexpr uint8_t INFO_INDEFINITE = 31;
+constexpr uint8_t BREAK = 0xff;
+
+} // namespace
+
+int64_t CborItem::asInt() const {
+    if (value > (uint64_t)INT64_MAX) {
+        return type == CborType::Negative ? INT64_MIN : INT64_MAX;
+    }
+    return type == CborType::Negative ? -1 - (int64_t)value : (int64_t)value;
+}
+
+//-------------------------------------------------------------------------
+//  Writer
+//-------------------------------------------------------------------------
+CborWriter::CborWriter(uint8_t* buffer, size_t size)
+    : buffer(buffer), capacity(size)
+{
+}
+
+void CborWriter::put(const void* src, size_t n) {
+    if (overflow || n > capacity - length) {
+        overflow = true;
+        return;
+    }
+    memcpy(buffer + length, src, n);
+    length += n;
+}
+
+// Shortest head for the value, as deterministic encoding asks
+void CborWriter::head(uint8_t major, uint64_t value) {
+    uint8_t out[9];
+    size_t n;
+    major <<= 5;
+    if (value < 24) {
+        out[0] = major | (uint8_t)value;
+        n = 1;
+    } else if (value <= 0xff) {
+        out[0] = major | 24;
+        n = 2;
+    } else if (value <= 0xffff) {
+        out[0] = major | 25;
+        n = 3;
+    } else if (value <= 0xffffffffu) {
+        out[0] = major | 26;
+        n = 5;
+    } else {
+        out[0] = major | 27;
+        n = 9;
+    }
+    for (size_t i = 1; i < n; i++) {
+        out[i] = (uint8_t)(value >> (8 * (n - 1 - i)));                       // Big endian
+    }
+    put(out, n);
+}
+
+void CborWriter::unsignedInt(uint64_t value) {
+    head(MAJOR_UNSIGNED, value);
+}
+
+void CborWriter::integer(int64_t value) {
+    if (value < 0) {
+        head(MAJOR_NEGATIVE, (uint64_t)(-1 - value));
+    } else {
+        head(MAJOR_UNSIGNED, (uint64_t)value);
+    }
+}
+
+void CborWriter::bytes(const void* data, size_t n) {
+    head(MAJOR_BYTES, n);
+    put(data, n);
+}
+
+void CborWriter::text(const char* text) {
+    this->text(text, strlen(text));
+}
+
+void CborWriter::text(const char* text, size_t n) {
+    head(MAJOR_TEXT, n);
+    put(text, n);
+}
+
+void CborWriter::array(size_t items) {
+    head(MAJOR_ARRAY, items);
+}
+
+void CborWriter::map(size_t pairs) {
+    head(MAJOR_MAP, pairs);
+}
+
+void CborWriter::beginArray() {
+    uint8_t byte = MAJOR_ARRAY << 5 | INFO_INDEFINITE;
+    put(&byte, 1);
+}
+
+void CborWriter::beginMap() {
+    uint8_t byte = MAJOR_MAP << 5 | INFO_INDEFINITE;
+    put(&byte, 1);
+}
+
+void CborWriter::end() {
+    put(&BREAK, 1);
+}
+
+void CborWriter::tag(uint64_t tag) {
+    head(MAJOR_TAG, tag);
+}
+
+void CborWriter::boolean(bool value) {
+    head(MAJOR_SIMPLE, value ? 21 : 20);
+}
+
+void CborWriter::null() {
+    head(MAJOR_SIMPLE, 22);
+}
+
+void CborWriter::rewind(size_t mark) {
+    if (mark <= length) {
+        length = mark;
+        overflow = false;
+    }
+}
+
+//-------------------------------------------------------------------------
+//  Reader
+//-------------------------------------------------------------------------
+CborReader::CborReader(const uint8_t* data, size_t size)
+    : data(data), size(size)
+{
+}
+
+bool CborReader::next(CborItem& item) {
+    if (failed || pos >= size) {
+        return false;
+    }
+    uint8_t initial = data[pos++];
+    uint8_t major = initial >> 5;
+    uint8_t info = initial & 0x1f;
+
+    item = CborItem();
+    if (initial == BREAK) {
+        item.type = CborType::Break;
+        return true;
+    }
+
+    uint64_t value = info;
+    size_t extra = 0;
+    if (info == 24) {
+        extra = 1;
+    } else if (info == 25) {
+        extra = 2;
+    } else if (info == 26) {
+        extra = 4;
+    } else if (info == 27) {
+        extra = 8;
+    } else if (info == INFO_INDEFINITE) {
+        if (major != MAJOR_ARRAY && major != MAJOR_MAP) {
+            failed = true;                                                   // Chunked strings and stray 0x?f
+            return false;
+        }
+        item.indefinite = true;
+        value = 0;
+    } else if (info > 23) {
+        failed = true;                                                       // Reserved additional info
+        return false;
+    }
+    if (extra > size - pos) {
+        failed = true;
+        return false;
+    }
+    if (extra > 0) {
+        value = 0;
+        for (size_t i = 0; i < extra; i++) {
+            value = value << 8 | data[pos++];
+        }
+    }
+    item.value = value;
+
+    switch (major) {
+        case MAJOR_UNSIGNED: item.type = CborType::Unsigned; break;
+        case MAJOR_NEGATIVE: item.type = CborType::Negative; break;
+        case MAJOR_BYTES:
+        case MAJOR_TEXT:
+            item.type = major == MAJOR_BYTES ? CborType::Bytes : CborType::Text;
+            if (value > size - pos) {
+                failed = true;
+                return false;
+            }
+            item.data = data + pos;
+            pos += (size_t)value;
+            break;
+        case MAJOR_ARRAY:    item.type = CborType::Array; break;
+        case MAJOR_MAP:      item.type = CborType::Map; break;
+        case MAJOR_TAG:      item.type = CborType::Tag; break;
+        case MAJOR_SIMPLE:
+            if (extra >= 2) {
+                item.type = CborType::Float;
+                item.size = (uint8_t)extra;
+            } else {
+                item.type = CborType::Simple;
+            }
+            break;
+    }
+    return true;
+}
+
+bool CborReader::skip(const CborItem& item) {
+    return skipNested(item, 0);
+}
+
+bool CborReader::skipNested(const CborItem& item, int depth) {
+    if (item.type != CborType::Array && item.type != CborType::Map && item.type != CborType::Tag) {
+        return !failed;
+    }
+    if (depth >= MAX_DEPTH) {
+        failed = true;
+        return false;
+    }
+    uint64_t remaining = item.type == CborType::Tag ? 1 : item.type == CborType::Map ? item.value * 2 : item.value;
+    if (item.type == CborType::Map && item.value > UINT64_MAX / 2) {
+        failed = true;
+        return false;
+    }
+    CborItem child;
+    while (item.indefinite || remaining > 0) {
+        if (!next(child)) {
+            failed = true;                                                   // Truncated
+            return false;
+        }
+        if (child.type == CborType::Break) {
+            if (!item.indefinite) {
+                failed = true;
+                return false;
+            }
+            return true;
+        }
+        if (!skipNested(child, depth + 1)) {
+            return false;
+        }
+        remaining--;
+    }
+    return true;
+}
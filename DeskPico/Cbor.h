@@ -0,0 +1,103 @@
+//=========================================================================
+//  Cbor.h
+//  Streaming CBOR (RFC 8949) writer and reader over caller buffers.
+//  Nothing is allocated: the writer appends to a fixed buffer and flags
+//  an overflow instead of growing, the reader hands out items one at a
+//  time with byte and text strings pointing into the input.
+//  Covers what the desk schema needs: integers, byte and text strings,
+//  definite and indefinite arrays and maps, tags, simple values and
+//  floats (raw bits). Indefinite-length strings are rejected.
+//  Pure C++, no Pico SDK dependency: builds and tests on the host.
+//=========================================================================
+
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum class CborType : uint8_t {
+    Unsigned,                                // value
+    Negative,                                // -1 - value, see CborItem::asInt()
+    Bytes,                                   // value = length, data
+    Text,                                    // value = length, data (UTF-8, not terminated)
+    Array,                                   // value = items, or indefinite
+    Map,                                     // value = pairs, or indefinite
+    Tag,                                     // value = tag; the tagged item follows
+    Simple,                                  // value: 20 false, 21 true, 22 null, 23 undefined
+    Float,                                   // value = raw IEEE bits, size in bytes
+    Break,                                   // End of an indefinite array or map
+};
+
+struct CborItem {
+    CborType type = CborType::Simple;
+    uint64_t value = 0;
+    bool indefinite = false;
+    uint8_t size = 0;                        // Float width in bytes
+    const uint8_t* data = nullptr;
+
+    int64_t asInt() const;                   // Unsigned and Negative, saturated
+};
+
+class CborWriter {
+public:
+    CborWriter(uint8_t* buffer, size_t size);
+
+    void unsignedInt(uint64_t value);
+    void integer(int64_t value);
+    void bytes(const void* data, size_t length);
+    void text(const char* text);
+    void text(const char* text, size_t length);
+    void array(size_t items);
+    void map(size_t pairs);
+    void beginArray();                       // Indefinite length, closed by end()
+    void beginMap();
+    void end();
+    void tag(uint64_t tag);
+    void boolean(bool value);
+    void null();
+
+    bool ok() const { return !overflow; }
+    size_t size() const { return length; }
+
+    // Undo everything written after mark(); used to drop an item that did not fit
+    size_t mark() const { return length; }
+    void rewind(size_t mark);
+
+private:
+    void head(uint8_t major, uint64_t value);
+    void put(const void* data, size_t n);
+
+    uint8_t* buffer;
+    size_t capacity;
+    size_t length = 0;
+    bool overflow = false;
+};
+
+class CborReader {
+public:
+    static constexpr int MAX_DEPTH = 8;                                      // Nesting skip() will follow
+
+    CborReader(const uint8_t* data, size_t size);
+
+    // Next item; false at the end of the input or on malformed input
+    // (see error()). Strings are skipped over, their bytes are in item.data.
+    bool next(CborItem& item);
+
+    // After next() returned an array, map or tag, skips what it contains
+    bool skip(const CborItem& item);
+
+    bool atEnd() const { return pos >= size; }
+    bool error() const { return failed; }
+    size_t offset() const { return pos; }
+
+private:
+    bool skipNested(const CborItem& item, int depth);
+
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool failed = false;
+};
+
+#endif
@@ -0,0 +1,303 @@
+//=========================================================================
+//  DeskMessages.cpp
+//  CBOR encoding and decoding of desk commands, and decoding of their
+//  JSON form.
+//=========================================================================
+
+#include "DeskMessages.h"
+#include "Cbor.h"
+#include "Json.h"
+#include <cstring>
+
+namespace {
+
+struct WireName {
+    WireCommand command;
+    const char* name;
+    DeskCommand desk;
+};
+
+const WireName WIRE_NAMES[] = {
+    { WireCommand::Free,    "green",    DeskCommand::Free },
+    { WireCommand::Occupy,  "red",      DeskCommand::Occupy },
+    { WireCommand::Reserve, "reserved", DeskCommand::Reserve },
+    { WireCommand::Sit,     "sit",      DeskCommand::Sit },
+    { WireCommand::Stand,   "stand",    DeskCommand::Stand },
+    { WireCommand::Buzz,    "buzz",     DeskCommand::Unknown },
+};
+
+// The backend's desk states: "state" in JSON commands, words on {mac}/state
+struct StateName {
+    const char* name;
+    WireCommand command;
+};
+
+const StateName STATE_NAMES[] = {
+    { "free",     WireCommand::Free },
+    { "occupied", WireCommand::Occupy },
+    { "reserved", WireCommand::Reserve },
+};
+
+bool readUnsigned(CborReader& reader, uint64_t max, uint64_t& value) {
+    CborItem item;
+    if (!reader.next(item) || item.type != CborType::Unsigned || item.value > max) {
+        return false;
+    }
+    value = item.value;
+    return true;
+}
+
+bool jsonUnsigned(const JsonDocument& doc, int token, uint64_t max, uint64_t& value) {
+    int64_t number = 0;
+    if (!doc.getInt(token, number) || number < 0 || (uint64_t)number > max) {
+        return false;
+    }
+    value = (uint64_t)number;
+    return true;
+}
+
+// 0xRRGGBB as a number or as "#rrggbb"
+bool jsonColour(const JsonDocument& doc, int token, uint32_t& colour) {
+    uint64_t value = 0;
+    if (!doc.isString(token)) {
+        bool ok = jsonUnsigned(doc, token, 0xffffff, value);
+        colour = (uint32_t)value;
+        return ok;
+    }
+    std::string_view text = doc.raw(token);
+    if (text.size() != 7 || text[0] != '#') {
+        return false;
+    }
+    for (size_t i = 1; i < text.size(); i++) {
+        char c = text[i];
+        int digit = c >= '0' && c <= '9' ? c - '0'
+                    : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                    : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                    : -1;
+        if (digit < 0) {
+            return false;
+        }
+        value = value << 4 | (uint64_t)digit;
+    }
+    colour = (uint32_t)value;
+    return true;
+}
+
+WireCommand jsonCommand(const JsonDocument& doc, int token, bool state) {
+    if (!doc.isString(token)) {
+        return WireCommand::None;
+    }
+    return state ? parseDeskState(doc.raw(token)) : parseWireCommand(doc.raw(token));
+}
+
+} // namespace
+
+bool isDeskMessage(const uint8_t* payload, size_t length) {
+    return length > 0 && payload[0] >> 5 == 5;                               // Major type 5; never ASCII
+}
+
+bool decodeDeskMessage(const uint8_t* payload, size_t length, DeskMessage& message) {
+    CborReader reader(payload, length);
+    CborItem map;
+    message = DeskMessage();
+    if (!reader.next(map) || map.type != CborType::Map) {
+        return false;
+    }
+
+    uint64_t pairs = map.value;
+    while (map.indefinite || pairs-- > 0) {
+        CborItem key;
+        if (!reader.next(key)) {
+            return false;
+        }
+        if (key.type == CborType::Break) {
+            if (!map.indefinite) {
+                return false;
+            }
+            break;
+        }
+
+        uint64_t value = 0;
+        bool ok = true;
+        if (key.type != CborType::Unsigned) {
+            CborItem skipped;
+            ok = reader.skip(key) && reader.next(skipped) && reader.skip(skipped);
+        } else if (key.value == KEY_CMD) {
+            ok = readUnsigned(reader, UINT8_MAX, value);
+            message.command = (WireCommand)value;
+        } else if (key.value == KEY_HEIGHT) {
+            ok = readUnsigned(reader, UINT16_MAX, value);
+            message.heightMm = (uint16_t)value;
+            message.fields |= DeskMessage::HAS_HEIGHT;
+        } else if (key.value == KEY_COLOUR) {
+            ok = readUnsigned(reader, 0xffffff, value);
+            message.colour = (uint32_t)value;
+            message.fields |= DeskMessage::HAS_COLOUR;
+        } else if (key.value == KEY_TEXT) {
+            CborItem text;
+            ok = reader.next(text) && text.type == CborType::Text && text.value <= DeskMessage::TEXT_MAX;
+            if (ok) {
+                memcpy(message.text, text.data, (size_t)text.value);
+                message.text[text.value] = '\0';
+                message.fields |= DeskMessage::HAS_TEXT;
+            }
+        } else if (key.value == KEY_UNTIL) {
+            ok = readUnsigned(reader, UINT32_MAX, value);
+            message.untilS = (uint32_t)value;
+            message.fields |= DeskMessage::HAS_UNTIL;
+        } else if (key.value == KEY_TONE) {
+            CborItem tone;
+            uint64_t hz = 0, ms = 0, repeat = 0;
+            ok = reader.next(tone) && tone.type == CborType::Array && !tone.indefinite && tone.value == 3
+                 && readUnsigned(reader, UINT16_MAX, hz) && readUnsigned(reader, UINT16_MAX, ms)
+                 && readUnsigned(reader, UINT8_MAX, repeat);
+            message.toneHz = (uint16_t)hz;
+            message.toneMs = (uint16_t)ms;
+            message.toneRepeat = (uint8_t)repeat;
+            message.fields |= DeskMessage::HAS_TONE;
+        } else {
+            CborItem skipped;
+            ok = reader.next(skipped) && reader.skip(skipped);                // Newer field
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return !reader.error();
+}
+
+bool isDeskJson(const uint8_t* payload, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (payload[i] != ' ' && payload[i] != '\t' && payload[i] != '\n' && payload[i] != '\r') {
+            return payload[i] == '{';
+        }
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------------
+//  Walks the top-level keys once instead of one find() per field, so the
+//  cost stays linear in the token count.
+//-------------------------------------------------------------------------
+bool decodeDeskJson(const uint8_t* payload, size_t length, DeskMessage& message) {
+    JsonToken tokens[DESK_JSON_TOKENS];
+    JsonDocument doc((const char*)payload, length, tokens, DESK_JSON_TOKENS);
+    message = DeskMessage();
+    if (!doc.ok() || doc.token(0).type != JsonType::Object) {
+        return false;
+    }
+
+    int key = 1;
+    for (uint16_t n = 0; n < doc.token(0).size; n++, key = doc.next(key)) {
+        int value = key + 1;
+        uint64_t number = 0;
+        bool ok = true;
+        if (doc.equals(key, "cmd") || doc.equals(key, "state")) {
+            message.command = jsonCommand(doc, value, doc.equals(key, "state"));
+            ok = message.command != WireCommand::None;
+        } else if (doc.equals(key, "height")) {
+            ok = jsonUnsigned(doc, value, UINT16_MAX, number);
+            message.heightMm = (uint16_t)number;
+            message.fields |= DeskMessage::HAS_HEIGHT;
+        } else if (doc.equals(key, "colour")) {
+            ok = jsonColour(doc, value, message.colour);
+            message.fields |= DeskMessage::HAS_COLOUR;
+        } else if (doc.equals(key, "text")) {
+            ok = doc.getString(value, message.text, sizeof(message.text));
+            message.fields |= DeskMessage::HAS_TEXT;
+        } else if (doc.equals(key, "until")) {
+            ok = jsonUnsigned(doc, value, UINT32_MAX, number);
+            message.untilS = (uint32_t)number;
+            message.fields |= DeskMessage::HAS_UNTIL;
+        } else if (doc.equals(key, "tone")) {
+            uint64_t hz = 0, ms = 0, repeat = 0;
+            ok = doc.token(value).type == JsonType::Array && doc.token(value).size == 3
+                 && jsonUnsigned(doc, doc.element(value, 0), UINT16_MAX, hz)
+                 && jsonUnsigned(doc, doc.element(value, 1), UINT16_MAX, ms)
+                 && jsonUnsigned(doc, doc.element(value, 2), UINT8_MAX, repeat);
+            message.toneHz = (uint16_t)hz;
+            message.toneMs = (uint16_t)ms;
+            message.toneRepeat = (uint8_t)repeat;
+            message.fields |= DeskMessage::HAS_TONE;
+        }                                                                    // Anything else: newer field
+        if (!ok) {
+            message = DeskMessage();
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t encodeDeskMessage(const DeskMessage& message, uint8_t* out, size_t size) {
+    CborWriter writer(out, size);
+    size_t pairs = (message.command != WireCommand::None);
+    for (uint8_t bit = 1; bit != 0; bit <<= 1) {
+        pairs += (message.fields & bit) != 0;
+    }
+
+    writer.map(pairs);
+    if (message.command != WireCommand::None) {
+        writer.unsignedInt(KEY_CMD);
+        writer.unsignedInt((uint8_t)message.command);
+    }
+    if (message.fields & DeskMessage::HAS_HEIGHT) {
+        writer.unsignedInt(KEY_HEIGHT);
+        writer.unsignedInt(message.heightMm);
+    }
+    if (message.fields & DeskMessage::HAS_COLOUR) {
+        writer.unsignedInt(KEY_COLOUR);
+        writer.unsignedInt(message.colour & 0xffffff);
+    }
+    if (message.fields & DeskMessage::HAS_TEXT) {
+        writer.unsignedInt(KEY_TEXT);
+        writer.text(message.text, strnlen(message.text, DeskMessage::TEXT_MAX));
+    }
+    if (message.fields & DeskMessage::HAS_UNTIL) {
+        writer.unsignedInt(KEY_UNTIL);
+        writer.unsignedInt(message.untilS);
+    }
+    if (message.fields & DeskMessage::HAS_TONE) {
+        writer.unsignedInt(KEY_TONE);
+        writer.array(3);
+        writer.unsignedInt(message.toneHz);
+        writer.unsignedInt(message.toneMs);
+        writer.unsignedInt(message.toneRepeat);
+    }
+    return writer.ok() ? writer.size() : 0;
+}
+
+DeskCommand toDeskCommand(WireCommand command) {
+    for (const WireName& entry : WIRE_NAMES) {
+        if (entry.command == command) {
+            return entry.desk;
+        }
+    }
+    return DeskCommand::Unknown;
+}
+
+WireCommand parseWireCommand(std::string_view name) {
+    for (const WireName& entry : WIRE_NAMES) {
+        if (name == entry.name) {
+            return entry.command;
+        }
+    }
+    return WireCommand::None;
+}
+
+WireCommand parseDeskState(std::string_view name) {
+    for (const StateName& entry : STATE_NAMES) {
+        if (name == entry.name) {
+            return entry.command;
+        }
+    }
+    return WireCommand::None;
+}
+
+const char* toString(WireCommand command) {
+    for (const WireName& entry : WIRE_NAMES) {
+        if (entry.command == command) {
+            return entry.name;
+        }
+    }
+    return "none";
+}
@@ -0,0 +1,115 @@
+//=========================================================================
+//  DeskMessages.h
+//  Binary MQTT schema of the desk, CBOR-encoded (Cbor.h), both ways.
+//
+//  Commands, backend to desk ({mac}/led, {mac}/buzzer and the retained
+//  {mac}/state, which only takes free / occupied / reserved): one CBOR map
+//  with small unsigned keys; unknown keys are skipped, so fields can be
+//  added without breaking older desks.
+//      0  cmd     uint        WireCommand
+//      1  height  uint        Desk height, mm
+//      2  colour  uint        0xRRGGBB
+//      3  text    tstr        Display line, at most DeskMessage::TEXT_MAX bytes
+//      4  until   uint        Deadline, seconds from receipt
+//      5  tone    [uint, uint, uint]   Hz, ms, repeat count
+//  The same command may come as a JSON object, for publishers without a
+//  CBOR library (tokenized in place, Json.h):
+//      {"state":"occupied","height":720,"text":"Anna 14:00"}
+//      cmd     string      Command word, as below
+//      state   string      free / occupied / reserved; another way to say cmd
+//      height  integer
+//      colour  integer or "#rrggbb"
+//      text    string
+//      until   integer
+//      tone    [hz, ms, repeat]
+//  A payload that is neither is the old bare ASCII word ("red", "sit",
+//  "buzz", ...), which stays accepted.
+//
+//  Telemetry, desk to backend (desks/{mac}/telemetry):
+//      {0: seq, 1: dropped, 2: [_ [kind, ms since boot, value], ...]}
+//  kind is TelemetryKind as a number; the sample array is indefinite so
+//  the batch can be written in one pass.
+//
+//  Pure C++, no Pico SDK dependency: builds and tests on the host.
+//=========================================================================
+
+#ifndef DESK_MESSAGES_H
+#define DESK_MESSAGES_H
+
+#include "DeskStateMachine.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Command codes on the wire. Fixed values: never renumber.
+enum class WireCommand : uint8_t {
+    None = 0,
+    Free = 1,                                // "green"
+    Occupy = 2,                              // "red"
+    Reserve = 3,                             // "reserved"
+    Sit = 4,                                 // "sit"
+    Stand = 5,                               // "stand"
+    Buzz = 6,                                // "buzz"
+};
+
+enum DeskMessageKey : uint8_t {
+    KEY_CMD = 0,
+    KEY_HEIGHT = 1,
+    KEY_COLOUR = 2,
+    KEY_TEXT = 3,
+    KEY_UNTIL = 4,
+    KEY_TONE = 5,
+};
+
+enum TelemetryKey : uint8_t {
+    TELEMETRY_SEQ = 0,
+    TELEMETRY_DROPPED = 1,
+    TELEMETRY_SAMPLES = 2,
+};
+
+struct DeskMessage {
+    static constexpr size_t TEXT_MAX = 20;
+
+    enum : uint8_t {                         // Bits of fields
+        HAS_HEIGHT = 1 << 0,
+        HAS_COLOUR = 1 << 1,
+        HAS_TEXT = 1 << 2,
+        HAS_UNTIL = 1 << 3,
+        HAS_TONE = 1 << 4,
+    };
+
+    WireCommand command = WireCommand::None;
+    uint8_t fields = 0;
+    uint16_t heightMm = 0;
+    uint32_t colour = 0;
+    char text[TEXT_MAX + 1] = {};            // Terminated
+    uint32_t untilS = 0;
+    uint16_t toneHz = 0;
+    uint16_t toneMs = 0;
+    uint8_t toneRepeat = 0;
+};
+
+// True if the payload is a CBOR map, i.e. not an ASCII command word
+bool isDeskMessage(const uint8_t* payload, size_t length);
+
+// False if the payload is malformed, a field has the wrong type or an out
+// of range value, or the text is too long
+bool decodeDeskMessage(const uint8_t* payload, size_t length, DeskMessage& message);
+
+// True if the payload is a JSON object: '{' after any whitespace
+bool isDeskJson(const uint8_t* payload, size_t length);
+
+// As decodeDeskMessage, for the JSON form. Needs no heap: at most
+// DESK_JSON_TOKENS tokens, on the stack.
+constexpr size_t DESK_JSON_TOKENS = 32;
+bool decodeDeskJson(const uint8_t* payload, size_t length, DeskMessage& message);
+
+// Encoded length, 0 if it does not fit in size
+size_t encodeDeskMessage(const DeskMessage& message, uint8_t* out, size_t size);
+
+DeskCommand toDeskCommand(WireCommand command);                             // Unknown for None and Buzz
+WireCommand parseWireCommand(std::string_view name);                        // "sit" -> Sit, None if unknown
+WireCommand parseDeskState(std::string_view name);                          // "occupied" -> Occupy, None if unknown
+const char* toString(WireCommand command);
+
+#endif
@@ -0,0 +1,154 @@
+//=========================================================================
+//  DeskStateMachine.cpp
+//  Transition table and output mapping for the desk state machine.
+//=========================================================================
+
+#include "DeskStateMachine.h"
+#include <cstddef>
+
+namespace {
+
+struct Transition {
+    DeskState from;
+    DeskCommand command;
+    DeskState to;
+};
+
+// Target that is no state of its own: back to where the desk was when it
+// went offline, see RESUME_STATES
+constexpr DeskState RESUME = static_cast<DeskState>(0xff);
+
+//-------------------------------------------------------------------------
+//  Every allowed transition. A (state, command) pair that is not listed is
+//  ignored. Listing a state as its own target re-enters it (restarts the
+//  sit/stand prompt). The retained state that follows Connected can still
+//  override where RESUME led.
+//-------------------------------------------------------------------------
+constexpr Transition TRANSITIONS[] = {
+    { DeskState::Offline,   DeskCommand::Connected,    RESUME               },
+
+    { DeskState::Free,      DeskCommand::Occupy,       DeskState::Occupied  },
+    { DeskState::Free,      DeskCommand::Reserve,      DeskState::Reserved  },
+    { DeskState::Free,      DeskCommand::Button,       DeskState::Occupied  },
+    { DeskState::Free,      DeskCommand::Disconnected, DeskState::Offline   },
+
+    { DeskState::Reserved,  DeskCommand::Occupy,       DeskState::Occupied  },
+    { DeskState::Reserved,  DeskCommand::Free,         DeskState::Free      },
+    { DeskState::Reserved,  DeskCommand::Button,       DeskState::Occupied  },
+    { DeskState::Reserved,  DeskCommand::Disconnected, DeskState::Offline   },
+
+    { DeskState::Occupied,  DeskCommand::Free,         DeskState::Free      },
+    { DeskState::Occupied,  DeskCommand::Sit,          DeskState::Adjusting },
+    { DeskState::Occupied,  DeskCommand::Stand,        DeskState::Adjusting },
+    { DeskState::Occupied,  DeskCommand::Button,       DeskState::Free      },
+    { DeskState::Occupied,  DeskCommand::Disconnected, DeskState::Offline   },
+
+    { DeskState::Adjusting, DeskCommand::PromptDone,   DeskState::Occupied  },
+    { DeskState::Adjusting, DeskCommand::Sit,          DeskState::Adjusting },
+    { DeskState::Adjusting, DeskCommand::Stand,        DeskState::Adjusting },
+    { DeskState::Adjusting, DeskCommand::Free,         DeskState::Free      },
+    { DeskState::Adjusting, DeskCommand::Button,       DeskState::Free      },
+    { DeskState::Adjusting, DeskCommand::Disconnected, DeskState::Offline   },
+};
+
+// Outputs per state, indexed by DeskState. Adjusting picks its screen from
+// the command that started the prompt.
+constexpr DeskOutput STATE_OUTPUTS[] = {
+    { DeskScreen::Offline,  DeskLed::Off      },                            // Offline
+    { DeskScreen::QrCode,   DeskLed::Free     },                            // Free
+    { DeskScreen::Reserved, DeskLed::Reserved },                            // Reserved
+    { DeskScreen::Occupied, DeskLed::Occupied },                            // Occupied
+    { DeskScreen::SitDown,  DeskLed::Occupied },                            // Adjusting
+};
+
+// What RESUME leads to after going offline from each state, indexed by
+// DeskState. The prompt does not survive the outage; the check-in does.
+constexpr DeskState RESUME_STATES[] = {
+    DeskState::Free,                                                        // Offline: the first connect
+    DeskState::Free,                                                        // Free
+    DeskState::Reserved,                                                    // Reserved
+    DeskState::Occupied,                                                    // Occupied
+    DeskState::Occupied,                                                    // Adjusting
+};
+
+struct CommandName {
+    std::string_view payload;
+    DeskCommand command;
+};
+
+constexpr CommandName COMMANDS[] = {
+    { "green",    DeskCommand::Free    },
+    { "red",      DeskCommand::Occupy  },
+    { "reserved", DeskCommand::Reserve },
+    { "sit",      DeskCommand::Sit     },
+    { "stand",    DeskCommand::Stand   },
+};
+
+} // namespace
+
+DeskCommand parseDeskCommand(std::string_view payload) {
+    for (const CommandName& entry : COMMANDS) {
+        if (entry.payload == payload) {
+            return entry.command;
+        }
+    }
+    return DeskCommand::Unknown;
+}
+
+DeskStateMachine::DeskStateMachine()
+    : _output(STATE_OUTPUTS[static_cast<size_t>(DeskState::Offline)])
+{
+}
+
+uint8_t DeskStateMachine::handle(DeskCommand command) {
+    const Transition* hit = nullptr;
+    for (const Transition& t : TRANSITIONS) {
+        if (t.from == _state && t.command == command) {
+            hit = &t;
+            break;
+        }
+    }
+    if (hit == nullptr) {
+        _ignored++;
+        return 0;
+    }
+
+    DeskState to = (hit->to == RESUME) ? _resume : hit->to;
+    if (to == DeskState::Offline) {
+        _resume = RESUME_STATES[static_cast<size_t>(_state)];
+    }
+
+    DeskOutput next = STATE_OUTPUTS[static_cast<size_t>(to)];
+    if (to == DeskState::Adjusting) {
+        next.screen = (command == DeskCommand::Stand) ? DeskScreen::StandUp : DeskScreen::SitDown;
+    }
+
+    uint8_t changed = 0;
+    if (next.screen != _output.screen) {
+        changed |= CHANGED_SCREEN;
+    }
+    if (next.led != _output.led) {
+        changed |= CHANGED_LED;
+    }
+    if (to == DeskState::Adjusting) {
+        changed |= START_PROMPT;
+    }
+
+    _state = to;
+    _output = next;
+    if (changed) {
+        _transitions++;
+    }
+    return changed;
+}
+
+const char* toString(DeskState state) {
+    switch (state) {
+        case DeskState::Offline:   return "offline";
+        case DeskState::Free:      return "free";
+        case DeskState::Reserved:  return "reserved";
+        case DeskState::Occupied:  return "occupied";
+        case DeskState::Adjusting: return "adjusting";
+    }
+    return "?";
+}
@@ -0,0 +1,88 @@
+//=========================================================================
+//  DeskStateMachine.h
+//  Desk logic as an explicit, table-driven state machine.
+//  Commands are parsed once into DeskCommand; a transition table decides
+//  the next state and handle() reports which outputs (screen, LED, prompt)
+//  actually changed, so callers only drive hardware on a change.
+//  Pure C++, no Pico SDK dependency: builds and tests on the host.
+//=========================================================================
+
+#ifndef DESK_STATE_MACHINE_H
+#define DESK_STATE_MACHINE_H
+
+#include <cstdint>
+#include <string_view>
+
+enum class DeskState : uint8_t {
+    Offline,                                 // No broker connection yet / lost
+    Free,                                    // Available, QR code shown
+    Reserved,                                // Booked, starting soon
+    Occupied,                                // Checked in
+    Adjusting,                               // Sit/stand prompt running
+};
+
+enum class DeskCommand : uint8_t {
+    Unknown,
+    Free,                                    // "green"
+    Occupy,                                  // "red"
+    Reserve,                                 // "reserved"
+    Sit,                                     // "sit"
+    Stand,                                   // "stand"
+    Button,                                  // Local check-in / check-out
+    PromptDone,                              // Sit/stand prompt finished
+    Connected,                               // Broker session up
+    Disconnected,                            // Broker session lost
+};
+
+enum class DeskScreen : uint8_t {
+    Offline,
+    QrCode,
+    Reserved,
+    Occupied,
+    SitDown,
+    StandUp,
+};
+
+enum class DeskLed : uint8_t {
+    Off,
+    Free,                                    // Green
+    Reserved,                                // Yellow pulse
+    Occupied,                                // Red
+};
+
+struct DeskOutput {
+    DeskScreen screen;
+    DeskLed led;
+};
+
+// Parses an MQTT payload ("red", "green", "sit", ...) into a command
+DeskCommand parseDeskCommand(std::string_view payload);
+
+class DeskStateMachine {
+public:
+    // handle() result bits
+    static constexpr uint8_t CHANGED_SCREEN = 0x01;
+    static constexpr uint8_t CHANGED_LED    = 0x02;
+    static constexpr uint8_t START_PROMPT   = 0x04;                          // Entered (or re-entered) Adjusting
+
+    DeskStateMachine();
+
+    // Applies a command; 0 when it is ignored in the current state
+    uint8_t handle(DeskCommand command);
+
+    DeskState state() const { return _state; }
+    const DeskOutput& output() const { return _output; }
+    uint32_t transitions() const { return _transitions; }                    // Commands that changed something
+    uint32_t ignored() const { return _ignored; }                            // Commands with no table entry
+
+private:
+    DeskState _state = DeskState::Offline;
+    DeskState _resume = DeskState::Free;                                     // Where the table's RESUME target leads
+    DeskOutput _output;
+    uint32_t _transitions = 0;
+    uint32_t _ignored = 0;
+};
+
+const char* toString(DeskState state);
+
+#endif
@@ -0,0 +1,31 @@
+//=========================================================================
+//  DisplayTransport.h
+//  Bus abstraction underneath OLEDDisplay.
+//  An SSD1306 only needs two operations from its bus: a command stream
+//  and a GDDRAM data stream. Each backend (I²C, SPI, host mock) maps them
+//  onto its own framing.
+//=========================================================================
+
+#ifndef DISPLAY_TRANSPORT_H
+#define DISPLAY_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+
+//-------------------------------------------------------------------------
+//  DisplayTransport interface
+//  sendData() buffers always come with one byte of writable headroom in
+//  front (data[-1]). Backends that need a framing byte (I²C control byte)
+//  use it so a whole frame goes out in one transfer without a copy; they
+//  must restore it before returning.
+//-------------------------------------------------------------------------
+class DisplayTransport {
+public:
+    virtual ~DisplayTransport() {}
+
+    virtual void reset() {}                                                  // Hardware reset pulse, if wired
+    virtual void sendCommands(const uint8_t* cmds, size_t len) = 0;          // Command stream
+    virtual void sendData(uint8_t* data, size_t len) = 0;                    // GDDRAM data stream
+};
+
+#endif
@@ -0,0 +1,48 @@
+//=========================================================================
+//  I2CDisplayTransport.cpp
+//  Implementation of the SSD1306 I²C transport.
+//=========================================================================
+
+#include "I2CDisplayTransport.h"
+#include <cstring>
+
+I2CDisplayTransport::I2CDisplayTransport(i2c_inst_t* i2c, uint8_t addr)
+    : _i2c(i2c), _addr(addr)
+{
+}
+
+//-------------------------------------------------------------------------
+//  Sets up an I²C bus shared by one or more displays
+//-------------------------------------------------------------------------
+void I2CDisplayTransport::initBus(i2c_inst_t* i2c, uint sdaPin, uint sclPin, uint baudrate) {
+    i2c_init(i2c, baudrate);
+    gpio_set_function(sdaPin, GPIO_FUNC_I2C);
+    gpio_set_function(sclPin, GPIO_FUNC_I2C);
+    gpio_pull_up(sdaPin);
+    gpio_pull_up(sclPin);
+}
+
+//-------------------------------------------------------------------------
+//  Sends commands as one stream per transaction (Co = 0)
+//-------------------------------------------------------------------------
+void I2CDisplayTransport::sendCommands(const uint8_t* cmds, size_t len) {
+    uint8_t buf[32];
+    while (len > 0) {
+        size_t chunk = len < sizeof(buf) - 1 ? len : sizeof(buf) - 1;
+        buf[0] = SSD1306_CTRL_COMMAND;
+        memcpy(buf + 1, cmds, chunk);
+        i2c_write_blocking(_i2c, _addr, buf, chunk + 1, false);
+        cmds += chunk;
+        len -= chunk;
+    }
+}
+
+//-------------------------------------------------------------------------
+//  Sends data using the headroom byte in front of it as the control byte
+//-------------------------------------------------------------------------
+void I2CDisplayTransport::sendData(uint8_t* data, size_t len) {
+    uint8_t saved = data[-1];
+    data[-1] = SSD1306_CTRL_DATA;
+    i2c_write_blocking(_i2c, _addr, data - 1, len + 1, false);
+    data[-1] = saved;
+}
@@ -0,0 +1,40 @@
+//=========================================================================
+//  I2CDisplayTransport.h
+//  SSD1306 transport over I²C (control-byte framing, up to 400 kHz).
+//=========================================================================
+
+#ifndef I2C_DISPLAY_TRANSPORT_H
+#define I2C_DISPLAY_TRANSPORT_H
+
+#include "DisplayTransport.h"
+#include "pico/stdlib.h"                                                     // Raspberry Pi Pico SDK
+#include "hardware/i2c.h"                                                    // I²C interface
+
+//-------------------------------------------------------------------------
+//  Hardware Configuration
+//-------------------------------------------------------------------------
+constexpr uint8_t SSD1306_I2C_ADDR      = 0x3C;                              // Default I²C address (SA0 low)
+constexpr uint8_t SSD1306_I2C_ADDR_ALT  = 0x3D;                              // Alternate I²C address (SA0 high)
+constexpr uint32_t SSD1306_I2C_CLK      = 400 * 1000;                        // I²C clock speed (400 kHz)
+
+constexpr uint8_t SSD1306_CTRL_COMMAND  = 0x00;                              // Control byte: command stream follows
+constexpr uint8_t SSD1306_CTRL_DATA     = 0x40;                              // Control byte: GDDRAM data follows
+
+class I2CDisplayTransport : public DisplayTransport {
+public:
+    I2CDisplayTransport(i2c_inst_t* i2c, uint8_t addr = SSD1306_I2C_ADDR);
+
+    // Sets up an I²C bus once; several displays may then share it by
+    // address, or be split across i2c0 and i2c1.
+    static void initBus(i2c_inst_t* i2c, uint sdaPin, uint sclPin,
+                        uint baudrate = SSD1306_I2C_CLK);
+
+    void sendCommands(const uint8_t* cmds, size_t len) override;
+    void sendData(uint8_t* data, size_t len) override;
+
+private:
+    i2c_inst_t* _i2c;                                                        // I²C instance (i2c0 / i2c1)
+    uint8_t _addr;                                                           // I²C address
+};
+
+#endif
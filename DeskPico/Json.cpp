@@ -0,0 +1,494 @@
+//=========================================================================
+//  Json.cpp
+//  Single pass tokenizer and path queries over the token array.
+//=========================================================================
+
+#include "Json.h"
+#include <cstring>
+
+namespace {
+
+// What the tokenizer accepts next
+enum class Expect : uint8_t {
+    Value,
+    ValueOrClose,                            // After '['
+    Key,                                     // After ',' in an object
+    KeyOrClose,                              // After '{'
+    Colon,
+    CommaOrClose,
+    Done,
+};
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+int hexValue(char c) {
+    if (isDigit(c)) {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Four hex digits at text; -1 if they are not
+long readHex4(const char* text) {
+    long value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hexValue(text[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        value = value << 4 | digit;
+    }
+    return value;
+}
+
+// Number grammar of RFC 8259 over exactly [text, text + length)
+bool isNumber(const char* text, size_t length) {
+    size_t i = 0;
+    if (i < length && text[i] == '-') {
+        i++;
+    }
+    if (i >= length || !isDigit(text[i])) {
+        return false;
+    }
+    if (text[i] == '0') {
+        i++;
+    } else {
+        while (i < length && isDigit(text[i])) {
+            i++;
+        }
+    }
+    if (i < length && text[i] == '.') {
+        i++;
+        if (i >= length || !isDigit(text[i])) {
+            return false;
+        }
+        while (i < length && isDigit(text[i])) {
+            i++;
+        }
+    }
+    if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        if (i < length && (text[i] == '+' || text[i] == '-')) {
+            i++;
+        }
+        if (i >= length || !isDigit(text[i])) {
+            return false;
+        }
+        while (i < length && isDigit(text[i])) {
+            i++;
+        }
+    }
+    return i == length;
+}
+
+} // namespace
+
+JsonDocument::JsonDocument(const char* text, size_t length, JsonToken* tokens, size_t maxTokens)
+    : text(text), tokens(tokens)
+{
+    if (length > MAX_LENGTH || maxTokens > (size_t)INT16_MAX) {
+        _error = length > MAX_LENGTH ? JsonError::Invalid : JsonError::NoMemory;
+        return;
+    }
+    parse(length, maxTokens);
+    if (_error != JsonError::None) {
+        _count = 0;                                                          // Nothing to query
+    }
+}
+
+int JsonDocument::add(JsonType type, size_t start, size_t end, int parent, size_t maxTokens) {
+    if ((size_t)_count >= maxTokens) {
+        _error = JsonError::NoMemory;
+        return -1;
+    }
+    JsonToken& token = tokens[_count];
+    token.type = type;
+    token.start = (uint16_t)start;
+    token.end = (uint16_t)end;
+    token.size = 0;
+    token.parent = (int16_t)parent;
+    if (parent >= 0) {
+        tokens[parent].size++;
+    }
+    return _count++;
+}
+
+//-------------------------------------------------------------------------
+//  One pass over the text. Containers are closed by walking the parent
+//  links, so there is no separate stack; a key is the parent of its value
+//  until the value is complete.
+//-------------------------------------------------------------------------
+void JsonDocument::parse(size_t length, size_t maxTokens) {
+    Expect expect = Expect::Value;
+    int parent = -1;
+    size_t pos = 0;
+
+    // After a complete value: back from its key to the object
+    auto valueDone = [&] {
+        if (parent >= 0 && tokens[parent].type == JsonType::String) {
+            parent = tokens[parent].parent;
+        }
+        expect = parent < 0 ? Expect::Done : Expect::CommaOrClose;
+    };
+
+    while (pos < length && _error == JsonError::None) {
+        char c = text[pos];
+        if (isSpace(c)) {
+            pos++;
+            continue;
+        }
+        if (expect == Expect::Done) {
+            _error = JsonError::Invalid;                                     // Trailing text
+            break;
+        }
+
+        if (c == '{' || c == '[') {
+            if (expect != Expect::Value && expect != Expect::ValueOrClose) {
+                _error = JsonError::Invalid;
+                break;
+            }
+            bool object = c == '{';
+            parent = add(object ? JsonType::Object : JsonType::Array, pos, pos, parent, maxTokens);
+            expect = object ? Expect::KeyOrClose : Expect::ValueOrClose;
+            pos++;
+        } else if (c == '}' || c == ']') {
+            JsonType type = c == '}' ? JsonType::Object : JsonType::Array;
+            bool canClose = expect == Expect::CommaOrClose
+                            || (type == JsonType::Object && expect == Expect::KeyOrClose)
+                            || (type == JsonType::Array && expect == Expect::ValueOrClose);
+            if (!canClose || parent < 0 || tokens[parent].type != type) {
+                _error = JsonError::Invalid;
+                break;
+            }
+            tokens[parent].end = (uint16_t)(pos + 1);
+            parent = tokens[parent].parent;
+            pos++;
+            valueDone();
+        } else if (c == '"') {
+            bool key = expect == Expect::Key || expect == Expect::KeyOrClose;
+            if (!key && expect != Expect::Value && expect != Expect::ValueOrClose) {
+                _error = JsonError::Invalid;
+                break;
+            }
+            size_t start = ++pos;
+            if (!scanString(pos, length)) {
+                break;
+            }
+            int index = add(JsonType::String, start, pos, parent, maxTokens);
+            pos++;                                                           // Closing quote
+            if (key) {
+                parent = index;
+                expect = Expect::Colon;
+            } else {
+                valueDone();
+            }
+        } else if (c == ':') {
+            if (expect != Expect::Colon) {
+                _error = JsonError::Invalid;
+                break;
+            }
+            expect = Expect::Value;
+            pos++;
+        } else if (c == ',') {
+            if (expect != Expect::CommaOrClose) {
+                _error = JsonError::Invalid;
+                break;
+            }
+            expect = tokens[parent].type == JsonType::Object ? Expect::Key : Expect::Value;
+            pos++;
+        } else {
+            if (expect != Expect::Value && expect != Expect::ValueOrClose) {
+                _error = JsonError::Invalid;
+                break;
+            }
+            size_t start = pos;
+            if (!scanPrimitive(pos, length)) {
+                break;
+            }
+            add(JsonType::Primitive, start, pos, parent, maxTokens);
+            valueDone();
+        }
+    }
+
+    if (_error == JsonError::None && expect != Expect::Done) {
+        _error = JsonError::Partial;
+    }
+}
+
+// From just past the opening quote to the closing one
+bool JsonDocument::scanString(size_t& pos, size_t length) {
+    while (pos < length) {
+        unsigned char c = (unsigned char)text[pos];
+        if (c == '"') {
+            return true;
+        }
+        if (c < 0x20) {
+            _error = JsonError::Invalid;                                 // Raw control character
+            return false;
+        }
+        if (c == '\\') {
+            if (pos + 1 >= length) {
+                break;
+            }
+            char e = text[pos + 1];
+            if (e == 'u') {
+                if (pos + 6 > length) {
+                    break;
+                }
+                if (readHex4(text + pos + 2) < 0) {
+                    _error = JsonError::Invalid;
+                    return false;
+                }
+                pos += 6;
+                continue;
+            }
+            if (e == '\0' || !strchr("\"\\/bfnrt", e)) {
+                _error = JsonError::Invalid;
+                return false;
+            }
+            pos += 2;
+            continue;
+        }
+        pos++;
+    }
+    _error = JsonError::Partial;
+    return false;
+}
+
+// A literal or number, up to the next delimiter
+bool JsonDocument::scanPrimitive(size_t& pos, size_t length) {
+    size_t start = pos;
+    while (pos < length && !isSpace(text[pos]) && text[pos] != ',' && text[pos] != ']' && text[pos] != '}'
+           && text[pos] != ':') {
+        pos++;
+    }
+    std::string_view word(text + start, pos - start);
+    if (word == "true" || word == "false" || word == "null" || isNumber(word.data(), word.size())) {
+        return true;
+    }
+    bool prefix = pos == length && (std::string_view("true").substr(0, word.size()) == word
+                                    || std::string_view("false").substr(0, word.size()) == word
+                                    || std::string_view("null").substr(0, word.size()) == word);
+    _error = prefix ? JsonError::Partial : JsonError::Invalid;
+    return false;
+}
+
+//-------------------------------------------------------------------------
+//  Queries
+//-------------------------------------------------------------------------
+int JsonDocument::next(int index) const {
+    int i = index + 1;
+    while (i < _count) {
+        int p = tokens[i].parent;
+        while (p > index) {                                                  // Parents precede children
+            p = tokens[p].parent;
+        }
+        if (p != index) {
+            break;
+        }
+        i++;
+    }
+    return i;
+}
+
+int JsonDocument::child(int object, std::string_view key) const {
+    if (object < 0 || object >= _count || tokens[object].type != JsonType::Object) {
+        return -1;
+    }
+    int i = object + 1;
+    for (uint16_t n = 0; n < tokens[object].size; n++) {
+        if (equals(i, key)) {
+            return i + 1;
+        }
+        i = next(i);
+    }
+    return -1;
+}
+
+int JsonDocument::element(int array, size_t index) const {
+    if (array < 0 || array >= _count || tokens[array].type != JsonType::Array || index >= tokens[array].size) {
+        return -1;
+    }
+    int i = array + 1;
+    for (size_t n = 0; n < index; n++) {
+        i = next(i);
+    }
+    return i;
+}
+
+int JsonDocument::find(std::string_view path, int from) const {
+    int at = from < _count ? from : -1;
+    size_t pos = 0;
+    while (at >= 0 && pos < path.size()) {
+        if (path[pos] == '[') {
+            size_t close = path.find(']', pos);
+            if (close == std::string_view::npos || close == pos + 1) {
+                return -1;
+            }
+            size_t index = 0;
+            for (size_t i = pos + 1; i < close; i++) {
+                if (!isDigit(path[i])) {
+                    return -1;
+                }
+                index = index * 10 + (size_t)(path[i] - '0');
+            }
+            at = element(at, index);
+            pos = close + 1;
+        } else {
+            if (path[pos] == '.') {
+                pos++;
+            }
+            size_t end = path.find_first_of(".[", pos);
+            if (end == std::string_view::npos) {
+                end = path.size();
+            }
+            at = child(at, path.substr(pos, end - pos));
+            pos = end;
+        }
+    }
+    return at;
+}
+
+std::string_view JsonDocument::raw(int index) const {
+    if (index < 0 || index >= _count) {
+        return std::string_view();
+    }
+    return std::string_view(text + tokens[index].start, tokens[index].end - tokens[index].start);
+}
+
+bool JsonDocument::equals(int index, std::string_view expected) const {
+    if (!isString(index) || index >= _count) {
+        return false;
+    }
+    std::string_view value = raw(index);
+    if (value.find('\\') == std::string_view::npos) {
+        return value == expected;                                            // The usual case
+    }
+    char buffer[64];
+    return expected.size() < sizeof(buffer) && getString(index, buffer, sizeof(buffer))
+           && expected == std::string_view(buffer);
+}
+
+bool JsonDocument::getInt(int index, int64_t& value) const {
+    if (index < 0 || index >= _count || tokens[index].type != JsonType::Primitive) {
+        return false;
+    }
+    std::string_view number = raw(index);
+    bool negative = number[0] == '-';
+    size_t i = negative ? 1 : 0;
+    if (i >= number.size() || !isDigit(number[i])) {
+        return false;                                                        // Literal
+    }
+    uint64_t magnitude = 0;
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    for (; i < number.size(); i++) {
+        if (!isDigit(number[i])) {
+            return false;                                                    // Fraction or exponent
+        }
+        uint64_t digit = (uint64_t)(number[i] - '0');
+        if (magnitude > (limit - digit) / 10) {
+            return false;
+        }
+        magnitude = magnitude * 10 + digit;
+    }
+    value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    return true;
+}
+
+bool JsonDocument::getBool(int index, bool& value) const {
+    if (index < 0 || index >= _count || tokens[index].type != JsonType::Primitive) {
+        return false;
+    }
+    std::string_view word = raw(index);
+    if (word != "true" && word != "false") {
+        return false;
+    }
+    value = word == "true";
+    return true;
+}
+
+bool JsonDocument::isNull(int index) const {
+    return index >= 0 && index < _count && tokens[index].type == JsonType::Primitive && raw(index) == "null";
+}
+
+//-------------------------------------------------------------------------
+//  Unescapes into out as UTF-8. Escapes were checked while tokenizing;
+//  a lone surrogate becomes U+FFFD.
+//-------------------------------------------------------------------------
+bool JsonDocument::getString(int index, char* out, size_t size) const {
+    if (!isString(index) || index >= _count || size == 0) {
+        return false;
+    }
+    std::string_view value = raw(index);
+    size_t n = 0;
+    auto put = [&](char c) {
+        if (n + 1 >= size) {
+            return false;
+        }
+        out[n++] = c;
+        return true;
+    };
+
+    for (size_t i = 0; i < value.size(); i++) {
+        char c = value[i];
+        if (c != '\\') {
+            if (!put(c)) {
+                return false;
+            }
+            continue;
+        }
+        char e = value[++i];
+        const char* from = "\"\\/bfnrt";
+        const char* to = "\"\\/\b\f\n\r\t";
+        if (e != 'u') {
+            if (!put(to[strchr(from, e) - from])) {
+                return false;
+            }
+            continue;
+        }
+
+        long code = readHex4(value.data() + i + 1);
+        i += 4;
+        if (code >= 0xd800 && code <= 0xdbff && i + 6 < value.size() && value[i + 1] == '\\'
+            && value[i + 2] == 'u') {
+            long low = readHex4(value.data() + i + 3);
+            if (low >= 0xdc00 && low <= 0xdfff) {
+                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                i += 6;
+            }
+        }
+        if (code >= 0xd800 && code <= 0xdfff) {
+            code = 0xfffd;
+        }
+
+        bool ok;
+        if (code < 0x80) {
+            ok = put((char)code);
+        } else if (code < 0x800) {
+            ok = put((char)(0xc0 | code >> 6)) && put((char)(0x80 | (code & 0x3f)));
+        } else if (code < 0x10000) {
+            ok = put((char)(0xe0 | code >> 12)) && put((char)(0x80 | (code >> 6 & 0x3f)))
+                 && put((char)(0x80 | (code & 0x3f)));
+        } else {
+            ok = put((char)(0xf0 | code >> 18)) && put((char)(0x80 | (code >> 12 & 0x3f)))
+                 && put((char)(0x80 | (code >> 6 & 0x3f))) && put((char)(0x80 | (code & 0x3f)));
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    out[n] = '\0';
+    return true;
+}
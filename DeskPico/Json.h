@@ -0,0 +1,87 @@
+//=========================================================================
+//  Json.h
+//  In-place JSON tokenizer (in the style of jsmn) with a small path query
+//  API. The text is never copied or modified: tokens are offsets into
+//  the caller's buffer (an inbox record, typically) and live in a token
+//  array the caller provides, so parsing uses no heap at all.
+//
+//      JsonToken tokens[16];
+//      JsonDocument doc(text, length, tokens, 16);
+//      int height = doc.find("height");             // -1 if absent
+//      int64_t mm;
+//      if (height >= 0 && doc.getInt(height, mm)) ...
+//
+//  Paths are keys separated by dots with [n] for array elements, e.g.
+//  "desk.tone[1]". Validation is strict (RFC 8259); a document that does
+//  not parse has no tokens to query.
+//  Pure C++, no Pico SDK dependency: builds and tests on the host.
+//=========================================================================
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class JsonType : uint8_t {
+    Object,                                  // size = keys
+    Array,                                   // size = elements
+    String,                                  // Without the quotes, still escaped; a key has size 1
+    Primitive,                               // Number, true, false or null
+};
+
+enum class JsonError : int8_t {
+    None = 0,
+    NoMemory = -1,                           // More tokens than the array holds
+    Invalid = -2,                            // Not JSON
+    Partial = -3,                            // Ends too early
+};
+
+struct JsonToken {
+    uint16_t start;                          // Offsets into the text, end exclusive
+    uint16_t end;
+    uint16_t size;                           // Direct children
+    int16_t parent;                          // Token index, -1 for the root
+    JsonType type;
+};
+
+class JsonDocument {
+public:
+    static constexpr size_t MAX_LENGTH = UINT16_MAX;
+
+    JsonDocument(const char* text, size_t length, JsonToken* tokens, size_t maxTokens);
+
+    bool ok() const { return _error == JsonError::None; }
+    JsonError error() const { return _error; }
+    int count() const { return _count; }
+    const JsonToken& token(int index) const { return tokens[index]; }
+
+    // Token of the value at path below from (the root by default), -1 if absent
+    int find(std::string_view path, int from = 0) const;
+    int child(int object, std::string_view key) const;                       // Value token of a key
+    int element(int array, size_t index) const;
+    int next(int index) const;                                               // Past the token and its subtree
+
+    std::string_view raw(int index) const;                                   // Token text as it is in the buffer
+    bool isString(int index) const { return index >= 0 && tokens[index].type == JsonType::String; }
+    bool equals(int index, std::string_view text) const;                     // String token, unescaped, equals text
+    bool getInt(int index, int64_t& value) const;                            // Integral number
+    bool getBool(int index, bool& value) const;
+    bool isNull(int index) const;
+    // Unescaped and terminated; false if it is not a string or does not fit
+    bool getString(int index, char* out, size_t size) const;
+
+private:
+    void parse(size_t length, size_t maxTokens);
+    int add(JsonType type, size_t start, size_t end, int parent, size_t maxTokens);
+    bool scanString(size_t& pos, size_t length);
+    bool scanPrimitive(size_t& pos, size_t length);
+
+    const char* text;
+    JsonToken* tokens;
+    int _count = 0;
+    JsonError _error = JsonError::None;
+};
+
+#endif
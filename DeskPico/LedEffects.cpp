@@ -0,0 +1,152 @@
+//=========================================================================
+//  LedEffects.cpp
+//  Implementation of the timer-driven NeoPixel effects engine.
+//=========================================================================
+
+#include "LedEffects.h"
+
+//-------------------------------------------------------------------------
+//  Gamma 2.2 correction table: perceived brightness -> PWM level
+//-------------------------------------------------------------------------
+static const uint8_t gamma8[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+// a * b / 255, rounded down, without a division
+static inline uint8_t scale8(uint8_t a, uint8_t b) {
+    return (uint8_t)(((uint16_t)a * (uint16_t)(b + 1)) >> 8);
+}
+
+// Linear interpolation from a to b, t in Q8 (0 = a, 256 = b)
+static inline uint8_t lerp8(uint8_t a, uint8_t b, uint16_t t) {
+    return (uint8_t)(a + ((((int32_t)b - (int32_t)a) * (int32_t)t) >> 8));
+}
+
+LedEffects::LedEffects(NeoPixel& strip) : _strip(strip) {
+    critical_section_init(&_lock);
+    setBrightness(255);
+}
+
+//-------------------------------------------------------------------------
+//  Starts rendering; negative delay keeps a fixed start-to-start rate
+//-------------------------------------------------------------------------
+bool LedEffects::start() {
+    if (_running) return true;
+    _running = add_repeating_timer_ms(-(int32_t)TICK_MS, onTick, this, &_timer);
+    return _running;
+}
+
+void LedEffects::stop() {
+    if (!_running) return;
+    cancel_repeating_timer(&_timer);
+    _running = false;
+}
+
+void LedEffects::solid(LedColor color)                     { set(LedEffect::Solid, color, 1); }
+void LedEffects::blink(LedColor color, uint16_t periodMs)  { set(LedEffect::Blink, color, periodMs); }
+void LedEffects::breathe(LedColor color, uint16_t periodMs){ set(LedEffect::Breathe, color, periodMs); }
+void LedEffects::fadeTo(LedColor color, uint16_t durationMs){ set(LedEffect::Fade, color, durationMs); }
+void LedEffects::pulse(LedColor color, uint16_t periodMs)  { set(LedEffect::Pulse, color, periodMs); }
+
+//-------------------------------------------------------------------------
+//  Rebuilds the output table: gamma first, then global brightness
+//-------------------------------------------------------------------------
+void LedEffects::setBrightness(uint8_t level) {
+    critical_section_enter_blocking(&_lock);
+    for (int i = 0; i < 256; i++) {
+        _lut[i] = scale8(gamma8[i], level);
+    }
+    _rewrite = true;
+    critical_section_exit(&_lock);
+}
+
+void LedEffects::set(LedEffect effect, LedColor color, uint16_t periodMs) {
+    critical_section_enter_blocking(&_lock);
+    _from = _current;                                                       // Fades start where the LED is now
+    _effect = effect;
+    _color = color;
+    _periodMs = periodMs ? periodMs : 1;
+    _elapsedMs = 0;
+    critical_section_exit(&_lock);
+}
+
+bool LedEffects::onTick(repeating_timer_t* rt) {
+    static_cast<LedEffects*>(rt->user_data)->tick();
+    return true;                                                            // Keep repeating
+}
+
+//-------------------------------------------------------------------------
+//  Envelope for periodic effects; phase is Q16 (0x10000 = one period)
+//-------------------------------------------------------------------------
+uint8_t LedEffects::level(uint32_t phase) const {
+    switch (_effect) {
+    case LedEffect::Blink:
+        return phase < 0x8000 ? 255 : 0;
+    case LedEffect::Breathe:                                                // Triangle; gamma makes it look smooth
+        return (uint8_t)((phase < 0x8000 ? phase : 0xFFFF - phase) >> 7);
+    case LedEffect::Pulse: {                                                // Two beats in the first half, then rest
+        uint32_t beat = phase & 0x3FFF;                                     // Position inside a quarter period
+        uint8_t tri = (uint8_t)((beat < 0x2000 ? beat : 0x3FFF - beat) >> 5);
+        if (phase < 0x4000) return tri;
+        if (phase < 0x8000) return scale8(tri, 160);
+        return 0;
+    }
+    default:
+        return 255;
+    }
+}
+
+LedColor LedEffects::scaled(LedColor c, uint8_t lvl) const {
+    return { scale8(c.r, lvl), scale8(c.g, lvl), scale8(c.b, lvl) };
+}
+
+//-------------------------------------------------------------------------
+//  Timer context: render one frame and start DMA only if it changed
+//-------------------------------------------------------------------------
+void LedEffects::tick() {
+    critical_section_enter_blocking(&_lock);
+    LedColor c;
+    if (_effect == LedEffect::Fade) {
+        if (_elapsedMs >= _periodMs) {
+            _effect = LedEffect::Solid;                                     // Fade finished, hold the target
+            c = _color;
+        } else {
+            uint16_t t = (uint16_t)((_elapsedMs << 8) / _periodMs);
+            c = { lerp8(_from.r, _color.r, t), lerp8(_from.g, _color.g, t), lerp8(_from.b, _color.b, t) };
+        }
+    } else if (_effect == LedEffect::Solid) {
+        c = _color;
+    } else {
+        uint32_t phase = ((_elapsedMs % _periodMs) << 16) / _periodMs;
+        c = scaled(_color, level(phase));
+    }
+    _elapsedMs += TICK_MS;
+    _current = c;
+
+    LedColor out = { _lut[c.r], _lut[c.g], _lut[c.b] };
+    if (_rewrite || out.r != _out.r || out.g != _out.g || out.b != _out.b) {
+        _rewrite = false;
+        _out = out;
+        _strip.Fill(out.r, out.g, out.b);
+    }
+    critical_section_exit(&_lock);
+
+    if (_strip.isDirty()) {
+        _strip.Show();                                                      // Retried next tick while busy
+    }
+}
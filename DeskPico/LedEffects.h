@@ -0,0 +1,76 @@
+//=========================================================================
+//  LedEffects.h
+//  Non-blocking effects engine for a NeoPixel strip.
+//  A repeating timer renders the active effect every TICK_MS in the
+//  background, so blinking, breathing and fades cost no main-loop time.
+//  All maths is fixed point; brightness and gamma are lookup tables.
+//=========================================================================
+
+#ifndef LED_EFFECTS_H
+#define LED_EFFECTS_H
+
+#include "NeoPixel.h"
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+#include <cstdint>
+
+struct LedColor {
+    uint8_t r, g, b;
+};
+
+constexpr LedColor LED_OFF    = {0, 0, 0};
+constexpr LedColor LED_RED    = {255, 0, 0};
+constexpr LedColor LED_GREEN  = {0, 255, 0};
+constexpr LedColor LED_YELLOW = {255, 255, 0};
+
+enum class LedEffect : uint8_t {
+    Solid,                                   // Constant colour
+    Blink,                                   // Hard on/off, 50 % duty
+    Breathe,                                 // Smooth triangle swell
+    Fade,                                    // One-shot cross-fade, then Solid
+    Pulse,                                   // Double heartbeat ("starting soon")
+};
+
+class LedEffects {
+public:
+    static constexpr uint32_t TICK_MS = 20;                                  // 50 Hz refresh
+
+    explicit LedEffects(NeoPixel& strip);
+
+    bool start();                                                            // Arm the refresh timer
+    void stop();                                                             // Cancel the refresh timer
+
+    void solid(LedColor color);
+    void blink(LedColor color, uint16_t periodMs = 500);
+    void breathe(LedColor color, uint16_t periodMs = 3000);
+    void fadeTo(LedColor color, uint16_t durationMs = 400);
+    void pulse(LedColor color, uint16_t periodMs = 1200);
+    void setBrightness(uint8_t level);                                       // Global brightness, 0-255
+
+    LedEffect effect() const { return _effect; }
+
+private:
+    static bool onTick(repeating_timer_t* rt);
+    void tick();                                                             // Timer context
+    void set(LedEffect effect, LedColor color, uint16_t periodMs);
+    uint8_t level(uint32_t phase) const;                                     // Q16 phase -> 0-255 envelope
+    LedColor scaled(LedColor c, uint8_t level) const;                        // Envelope, brightness and gamma
+
+    NeoPixel& _strip;
+    repeating_timer_t _timer;
+    critical_section_t _lock;                                                // Guards state shared with tick()
+    bool _running = false;
+
+    LedEffect _effect = LedEffect::Solid;
+    LedColor _color = LED_OFF;                                               // Target colour
+    LedColor _from = LED_OFF;                                                // Fade start colour
+    LedColor _current = LED_OFF;                                             // Last rendered colour, before gamma
+    LedColor _out = LED_OFF;                                                 // Last colour written to the strip
+    bool _rewrite = true;                                                    // Write on next tick even if unchanged
+    uint16_t _periodMs = 1;
+    uint32_t _elapsedMs = 0;
+
+    uint8_t _lut[256];                                                       // gamma(v) * brightness
+};
+
+#endif
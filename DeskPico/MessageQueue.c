@@ -0,0 +1,54 @@
+#include "MessageQueue.h"
+
+#include <string.h>
+
+#if (MESSAGE_QUEUE_LEN & (MESSAGE_QUEUE_LEN - 1)) != 0
+#error "MESSAGE_QUEUE_LEN must be a power of two"
+#endif
+#if MESSAGE_PAYLOAD_MAX > 65535
+#error "MESSAGE_PAYLOAD_MAX must fit message_record_t.length"
+#endif
+
+void message_queue_init(message_queue_t *queue) {
+    memset(queue, 0, sizeof(*queue));
+}
+
+message_record_t *message_queue_reserve(message_queue_t *queue) {
+    uint32_t tail = queue->tail;
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head >= MESSAGE_QUEUE_LEN) {
+        queue->overflows++;
+        return NULL;
+    }
+    return &queue->records[tail % MESSAGE_QUEUE_LEN];
+}
+
+void message_queue_commit(message_queue_t *queue) {
+    uint32_t tail = queue->tail + 1;
+    uint32_t used = tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+    if (used > queue->high_water) {
+        queue->high_water = used;
+    }
+    // Publish the record contents before the new tail
+    __atomic_store_n(&queue->tail, tail, __ATOMIC_RELEASE);
+}
+
+const message_record_t *message_queue_peek(message_queue_t *queue) {
+    uint32_t head = queue->head;
+
+    if (__atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == head) {
+        return NULL;
+    }
+    return &queue->records[head % MESSAGE_QUEUE_LEN];
+}
+
+void message_queue_release(message_queue_t *queue) {
+    // Done reading before the producer may reuse the record
+    __atomic_store_n(&queue->head, queue->head + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t message_queue_count(const message_queue_t *queue) {
+    return __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+}
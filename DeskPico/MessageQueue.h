@@ -0,0 +1,59 @@
+#ifndef MESSAGEQUEUE_H
+#define MESSAGEQUEUE_H
+
+/*
+ * Fixed-capacity single-producer / single-consumer ring of inbound MQTT
+ * messages. The producer (MQTT callbacks) fills a record in place and
+ * commits it; the consumer (the app) reads the record where it lies and
+ * releases it. Neither side locks: head is written only by the consumer,
+ * tail only by the producer, and both are published with acquire/release
+ * atomics, so the two sides may run on different cores.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MESSAGE_QUEUE_LEN
+#define MESSAGE_QUEUE_LEN 8             /* Records, power of two */
+#endif
+#ifndef MESSAGE_PAYLOAD_MAX
+#define MESSAGE_PAYLOAD_MAX 256         /* Payload bytes per record; commands are a few dozen */
+#endif
+
+typedef struct message_record_ {
+    uint8_t topic_id;                   /* Route id (mqtt_add_route) of the publish */
+    uint16_t length;                    /* Payload bytes, excluding the terminator */
+    uint8_t payload[MESSAGE_PAYLOAD_MAX + 1]; /* Always NUL-terminated */
+} message_record_t;
+
+typedef struct message_queue_ {
+    message_record_t records[MESSAGE_QUEUE_LEN];
+    uint32_t head;                      /* Next record to read (consumer) */
+    uint32_t tail;                      /* Next record to write (producer) */
+    uint32_t overflows;                 /* Messages dropped because the ring was full */
+    uint32_t high_water;                /* Most records ever queued at once */
+} message_queue_t;
+
+void message_queue_init(message_queue_t *queue);
+
+/* Producer: free record to fill, or NULL (and an overflow) if full.
+ * Reserving again without a commit hands back the same record. */
+message_record_t *message_queue_reserve(message_queue_t *queue);
+void message_queue_commit(message_queue_t *queue);
+
+/* Consumer: oldest record, or NULL if empty. The record stays valid and
+ * unchanged until message_queue_release(). */
+const message_record_t *message_queue_peek(message_queue_t *queue);
+void message_queue_release(message_queue_t *queue);
+
+uint32_t message_queue_count(const message_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESSAGEQUEUE_H
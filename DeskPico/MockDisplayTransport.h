@@ -0,0 +1,50 @@
+//=========================================================================
+//  MockDisplayTransport.h
+//  Host-side DisplayTransport that records everything OLEDDisplay sends.
+//  Has no Pico SDK dependency, so OLEDDisplay can be exercised off-target.
+//=========================================================================
+
+#ifndef MOCK_DISPLAY_TRANSPORT_H
+#define MOCK_DISPLAY_TRANSPORT_H
+
+#include "DisplayTransport.h"
+#include <vector>
+
+class MockDisplayTransport : public DisplayTransport {
+public:
+    void reset() override { resets++; }
+
+    void sendCommands(const uint8_t* cmds, size_t len) override {
+        commands.insert(commands.end(), cmds, cmds + len);
+        commandTransfers++;
+    }
+
+    // Uses the headroom byte like the I2C transport does, and restores it
+    void sendData(uint8_t* data, size_t len) override {
+        uint8_t saved = data[-1];
+        data[-1] = 0x40;
+        lastData.assign(data, data + len);
+        data[-1] = saved;
+        transfers.push_back(lastData);
+        dataBytes += len;
+        dataTransfers++;
+    }
+
+    void clearLog() {
+        commands.clear();
+        lastData.clear();
+        transfers.clear();
+        resets = commandTransfers = dataTransfers = 0;
+        dataBytes = 0;
+    }
+
+    std::vector<uint8_t> commands;                                           // Every command byte, in order
+    std::vector<uint8_t> lastData;                                           // Payload of the latest data transfer
+    std::vector<std::vector<uint8_t>> transfers;                             // Every data transfer, in order
+    unsigned resets = 0;
+    unsigned commandTransfers = 0;
+    unsigned dataTransfers = 0;
+    size_t dataBytes = 0;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "hardware/structs/rosc.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <time.h>
 #include "pico/stdlib.h"
@@ -18,12 +19,53 @@
 
 #include "tusb.h"
 
+#include "MqttClient.h"
+
 #define DEBUG_printf printf
 
-#define MQTT_TLS 0 // needs to be 1 for AWS IoT. Also set published QoS to 0 or 1
+#ifndef MQTT_TLS
+#define MQTT_TLS 0 // needs to be 1 for AWS IoT (DESKPICO_MQTT_TLS). Also set published QoS to 0 or 1
+#endif
 #define CRYPTO_MOSQUITTO_TEST
+#ifndef MQTT_SERVER_HOST
 #define MQTT_SERVER_HOST "broker.hivemq.com"   //broker.hivemq.com
+#endif
+#ifndef MQTT_SERVER_PORT
+#if MQTT_TLS
+#define MQTT_SERVER_PORT 8883  // MQTT over TLS
+#else
 #define MQTT_SERVER_PORT 1883
+#endif
+#endif
+#ifndef MQTT_KEEP_ALIVE_S
+#define MQTT_KEEP_ALIVE_S 10   // Heartbeat: PINGREQ after this much idle. After 1.5x without one the broker
+#endif                         // publishes our will, and lwIP drops the session after 1.5x without a reply
+
+#if MQTT_PUB_INFLIGHT_MAX >= MQTT_REQ_MAX_IN_FLIGHT
+#error "MQTT_PUB_INFLIGHT_MAX must leave lwIP request slots for subscriptions"
+#endif
+
+#if MQTT_TLS && MQTT_TLS_SESSION_FLASH
+#include "hardware/flash.h"
+#include "pico/flash.h"
+
+#define TLS_SESSION_MAGIC 0x31534c54u                                    // "TLS1"
+#define TLS_SESSION_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)   // Last sector, past the image
+#define TLS_SESSION_STORED ((const tls_session_record_t *)(XIP_BASE + TLS_SESSION_OFFSET))
+#define TLS_SESSION_FLASH_TIMEOUT_MS 100
+
+#if MQTT_TLS_SESSION_MAX % FLASH_PAGE_SIZE
+#error "MQTT_TLS_SESSION_MAX must be whole flash pages"
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t length;
+    uint8_t data[MQTT_TLS_SESSION_MAX - 8];
+} tls_session_record_t;
+
+static tls_session_record_t tls_record;
+#endif
 
 #if MQTT_TLS
 #ifdef CRYPTO_CERT
@@ -37,17 +79,6 @@ const char *key = CRYPTO_KEY;
 #endif
 #endif
 
-typedef struct MQTT_CLIENT_T_ {
-    ip_addr_t remote_addr;
-    mqtt_client_t *mqtt_client;
-    u32_t received;
-    u32_t counter;
-    u32_t reconnect;
-    char message[1025];
-} MQTT_CLIENT_T;
- 
-err_t mqtt_test_connect(MQTT_CLIENT_T *state);
-
 // Perform initialisation
     MQTT_CLIENT_T* mqtt_client_init(void) {
     MQTT_CLIENT_T *state = calloc(1, sizeof(MQTT_CLIENT_T));
@@ -56,17 +87,28 @@ err_t mqtt_test_connect(MQTT_CLIENT_T *state);
         return NULL;
     }
     state->received = 0;
+    message_queue_init(&state->inbox);
+    state->rx_record = NULL;
     return state;
 }
 
 void dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_arg) {
     MQTT_CLIENT_T *state = (MQTT_CLIENT_T*)callback_arg;
+    if (ipaddr == NULL) {
+        DEBUG_printf("DNS query for %s failed.\n", name);
+        state->dns_failed = true;
+        return;
+    }
     DEBUG_printf("DNS query finished with resolved addr of %s.\n", ip4addr_ntoa(ipaddr));
     state->remote_addr = *ipaddr;
 }
 
-void run_dns_lookup(MQTT_CLIENT_T *state) {
+// Starts the broker lookup without waiting. ERR_OK: address already known,
+// ERR_INPROGRESS: dns_found() fills in remote_addr later.
+err_t mqtt_start_dns_lookup(MQTT_CLIENT_T *state) {
     DEBUG_printf("Running DNS query for %s.\n", MQTT_SERVER_HOST);
+    ip_addr_set_zero(&state->remote_addr);      // Looked up again on every reconnect
+    state->dns_failed = false;
 
     cyw43_arch_lwip_begin();
     err_t err = dns_gethostbyname(MQTT_SERVER_HOST, &(state->remote_addr), dns_found, state);
@@ -74,11 +116,17 @@ void run_dns_lookup(MQTT_CLIENT_T *state) {
 
     if (err == ERR_ARG) {
         DEBUG_printf("failed to start DNS query\n");
-        return;
     }
 
     if (err == ERR_OK) {
-        DEBUG_printf("no lookup needed");
+        DEBUG_printf("no lookup needed\n");
+    }
+
+    return err;
+}
+
+void run_dns_lookup(MQTT_CLIENT_T *state) {
+    if (mqtt_start_dns_lookup(state) != ERR_INPROGRESS) {
         return;
     }
 
@@ -88,44 +136,305 @@ void run_dns_lookup(MQTT_CLIENT_T *state) {
     }
 }
 
-u32_t data_in = 0;
+//-------------------------------------------------------------------------
+//  Routing. Each route is a subscription filter plus the handler for what
+//  arrives on it; inbox records carry the route id, so the receive path
+//  never needs to know what a channel means.
+//-------------------------------------------------------------------------
+
+// MQTT filter match: + is one level, # the rest (including none), and
+// wildcards in the first level never match $SYS-style topics. Walks both
+// strings in place.
+bool mqtt_topic_matches(const char *filter, const char *topic) {
+    if (topic[0] == '$' && (filter[0] == '+' || filter[0] == '#')) {
+        return false;
+    }
+    while (*filter != '\0') {
+        if (*filter == '#') {
+            return true;
+        }
+        if (*filter == '+') {
+            filter++;
+            while (*topic != '\0' && *topic != '/') {
+                topic++;
+            }
+        } else {
+            while (*filter != '\0' && *filter != '/') {
+                if (*filter++ != *topic++) {
+                    return false;
+                }
+            }
+        }
+        if (*filter != *topic) {
+            return *topic == '\0' && strcmp(filter, "/#") == 0;   // "a/#" also matches "a"
+        }
+        if (*filter == '\0') {
+            return true;
+        }
+        filter++;
+        topic++;
+    }
+    return *topic == '\0';
+}
 
-u8_t buffer[1025];
-u8_t data_len = 0;
+// Route id of the first route whose filter matches, MQTT_ROUTE_NONE if none
+uint8_t mqtt_route_topic(const MQTT_CLIENT_T *state, const char *topic) {
+    uint8_t count = state->route_count;
+    for (uint8_t i = 0; i < count; i++) {
+        if (mqtt_topic_matches(state->routes[i].filter, topic)) {
+            return i + 1;
+        }
+    }
+    return MQTT_ROUTE_NONE;
+}
+
+// This board's MAC in lowercase hex with colons, as the backend stores it.
+// False if it does not fit.
+bool mqtt_board_mac(char *out, size_t size) {
+    uint8_t mac[6];
+    cyw43_wifi_get_mac(&cyw43_state, CYW43_ITF_STA, mac);
+    int n = snprintf(out, size, "%02x:%02x:%02x:%02x:%02x:%02x",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return n > 0 && (size_t)n < size;
+}
 
+// MQTT client id of this board, "desk-" and the MAC without colons. False
+// if it does not fit.
+bool mqtt_client_id(char *out, size_t size) {
+    uint8_t mac[6];
+    cyw43_wifi_get_mac(&cyw43_state, CYW43_ITF_STA, mac);
+    int n = snprintf(out, size, "desk-%02x%02x%02x%02x%02x%02x",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return n > 0 && (size_t)n < size;
+}
+
+// "{mac}/channel" for this board. False if it does not fit.
+bool mqtt_desk_topic(char *out, size_t size, const char *channel) {
+    char mac[18];
+    mqtt_board_mac(mac, sizeof(mac));
+    int n = snprintf(out, size, "%s/%s", mac, channel);
+    return n > 0 && (size_t)n < size;
+}
+
+// Adds an inbound channel; subscribed at once when the session is up,
+// otherwise with the rest by mqtt_subscribe_to_topics(). Call from the
+// network context. Returns the route id, MQTT_ROUTE_NONE if the table is
+// full or the filter too long.
+uint8_t mqtt_add_route(MQTT_CLIENT_T *state, const char *filter, uint8_t qos, mqtt_route_handler_t handler, void *arg) {
+    if (state->route_count >= MQTT_ROUTES_MAX || strlen(filter) >= MQTT_FILTER_MAX) {
+        DEBUG_printf("Cannot add route %s\n", filter);
+        return MQTT_ROUTE_NONE;
+    }
+    mqtt_route_t *route = &state->routes[state->route_count];
+    strcpy(route->filter, filter);
+    route->qos = qos;
+    route->handler = handler;
+    route->arg = arg;
+    state->route_count++;                       // Published last: the entry is complete
+
+    if (state->mqtt_client != NULL && mqtt_client_is_connected(state->mqtt_client)) {
+        mqtt_pump_subscriptions(state);
+    }
+    return state->route_count;
+}
+
+// QoS 1 delivery is at least once: after a lost PUBACK the broker sends the
+// message again with DUP set and the same packet id. Ids are reused once
+// acknowledged, so only a DUP publish whose id was taken recently is a
+// copy. lwIP acknowledges either way.
+static bool mqtt_is_redelivery(const MQTT_CLIENT_T *state, u16_t id, u8_t flags) {
+    if (id == 0 || !(flags & MQTT_INPUB_FLAG_DUP)) {
+        return false;                           // QoS 0, or a first delivery
+    }
+    for (int i = 0; i < MQTT_DEDUPE_WINDOW; i++) {
+        if (state->rx_seen[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Only once the message is in the inbox: a copy of one that was dropped
+// must still get through
+static void mqtt_remember_id(MQTT_CLIENT_T *state, u16_t id) {
+    if (id == 0) {
+        return;
+    }
+    state->rx_seen[state->rx_seen_next] = id;
+    state->rx_seen_next = (uint8_t)((state->rx_seen_next + 1) % MQTT_DEDUPE_WINDOW);
+}
+
+// Start of a publish: claim an inbox slot for the whole payload up front,
+// so the fragments can be written straight into it. Unrouted and oversize
+// messages, redeliveries, and messages that find the inbox full, are
+// skipped to their last fragment.
 static void mqtt_pub_start_cb(void *arg, const char *topic, u32_t tot_len) {
+    MQTT_CLIENT_T *state = (MQTT_CLIENT_T *)arg;
     DEBUG_printf("mqtt_pub_start_cb: topic %s\n", topic);
 
-    if (tot_len > 1024) {
-        DEBUG_printf("Message length exceeds buffer size, discarding");
-    } else {
-        data_in = tot_len;
-        data_len = 0;
+    u8_t flags;
+    state->rx_record = NULL;
+    state->rx_topic = mqtt_route_topic(state, topic);
+    state->rx_length = 0;
+    state->rx_remaining = tot_len;
+    // see mqtt-inpub-info.patch for this call
+    mqtt_get_inpub_info(state->mqtt_client, &state->rx_packet_id, &flags);
+
+    if (mqtt_is_redelivery(state, state->rx_packet_id, flags)) {
+        state->rx_duplicates++;
+        DEBUG_printf("Redelivery on %s, skipping\n", topic);
+        return;
+    }
+    if (state->rx_topic == MQTT_ROUTE_NONE) {
+        state->rx_unrouted++;
+        DEBUG_printf("No route for %s, skipping\n", topic);
+        return;
+    }
+    if (tot_len > MESSAGE_PAYLOAD_MAX) {
+        state->rx_oversize++;
+        DEBUG_printf("Message of %u bytes exceeds %u, skipping\n", tot_len, MESSAGE_PAYLOAD_MAX);
+        return;
+    }
+    state->rx_record = message_queue_reserve(&state->inbox);
+    if (state->rx_record == NULL) {
+        state->rx_lost += (state->rx_packet_id != 0);
+        DEBUG_printf("Inbox full, message dropped (%u so far)\n", state->inbox.overflows);
     }
 }
 
 static void mqtt_pub_data_cb(void *arg, const u8_t *data, u16_t len, u8_t flags) {
     MQTT_CLIENT_T *state = (MQTT_CLIENT_T *)arg;
-    if (data_in > 0) {
-        data_in -= len;
-        memcpy(&buffer[data_len], data, len);
-        data_len += len;
+    message_record_t *record = state->rx_record;
+
+    if (len > state->rx_remaining) {
+        len = (u16_t)state->rx_remaining;   // Never trust a fragment past the announced length
+    }
+    state->rx_remaining -= len;
 
-        if (data_in == 0) {
-            buffer[data_len] = 0;
-            DEBUG_printf("Message received: %s\n", &buffer);
+    if (record != NULL) {
+        memcpy(&record->payload[state->rx_length], data, len);
+        state->rx_length += len;
+    }
 
-            strcpy(state->message, (const char*)buffer);
-        }
+    if (!(flags & MQTT_DATA_FLAG_LAST) && state->rx_remaining > 0) {
+        return;
+    }
+    state->rx_record = NULL;
+    if (record == NULL) {
+        return;
+    }
+
+    record->payload[state->rx_length] = 0;
+    record->topic_id = state->rx_topic;
+    record->length = (uint16_t)state->rx_length;
+    DEBUG_printf("Message received: %u bytes\n", state->rx_length);
+    message_queue_commit(&state->inbox);
+    mqtt_remember_id(state, state->rx_packet_id);
+    if (state->on_message != NULL) {
+        state->on_message(state->on_message_arg);
     }
 }
 
+#if MQTT_TLS
+#if MQTT_TLS_SESSION_FLASH
+static void tls_session_write(void *param) {
+    flash_range_erase(TLS_SESSION_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(TLS_SESSION_OFFSET, (const uint8_t *)param, sizeof(tls_session_record_t));
+}
+#endif
+
+// The session stored by an earlier boot, if there is one that still loads
+static void mqtt_tls_restore_session(MQTT_CLIENT_T *state) {
+#if MQTT_TLS_SESSION_FLASH
+    const tls_session_record_t *stored = TLS_SESSION_STORED;
+    if (stored->magic != TLS_SESSION_MAGIC || stored->length > sizeof(stored->data)) {
+        return;                                                     // Erased or never written
+    }
+    struct altcp_tls_session *session = altcp_tls_alloc_session();
+    // see tls-session.patch for this call
+    if (session != NULL && altcp_tls_session_load(session, stored->data, stored->length) == ERR_OK) {
+        state->tls_session = session;
+        DEBUG_printf("TLS session restored from flash.\n");
+    }
+    else {
+        altcp_tls_free_session(session);
+    }
+#else
+    (void)state;
+#endif
+}
+
+// Takes the session of the connection that just came up, for the next
+// connect to resume. With flash persistence the first one of each boot is
+// written too, unless it is the one already there (resumed from flash):
+// at most one sector erase per boot, not per reconnect. A stored session
+// the broker no longer resumes is replaced by the next boot's full one.
+static void mqtt_tls_keep_session(MQTT_CLIENT_T *state) {
+    struct altcp_tls_session *session = altcp_tls_alloc_session();
+    if (session == NULL) {
+        return;
+    }
+    if (altcp_tls_get_session(state->mqtt_client->conn, session) != ERR_OK) {
+        altcp_tls_free_session(session);
+        return;
+    }
+    altcp_tls_free_session(state->tls_session);
+    state->tls_session = session;
+#if MQTT_TLS_SESSION_FLASH
+    if (state->tls_stored) {
+        return;
+    }
+    size_t length = 0;
+    // see tls-session.patch for this call
+    if (altcp_tls_session_save(session, tls_record.data, sizeof(tls_record.data), &length) != ERR_OK) {
+        return;
+    }
+    const tls_session_record_t *stored = TLS_SESSION_STORED;
+    if (stored->magic == TLS_SESSION_MAGIC && stored->length == length &&
+        memcmp(stored->data, tls_record.data, length) == 0) {
+        state->tls_stored = true;
+        return;
+    }
+    tls_record.magic = TLS_SESSION_MAGIC;
+    tls_record.length = length;
+    state->tls_stored = flash_safe_execute(tls_session_write, &tls_record, TLS_SESSION_FLASH_TIMEOUT_MS) == PICO_OK;
+#endif
+}
+#endif
+
+// Runs on CONNACK, on a refused or failed connect and when an open session
+// is lost (keepalive timeout, TCP error), but not on mqtt_disconnect(). lwIP
+// has dropped its pending requests by then, without their callbacks.
 static void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status) {
+    MQTT_CLIENT_T *state = (MQTT_CLIENT_T *)arg;
+    state->tx_inflight = 0;
+#if MQTT_TLS
+    if (status == MQTT_CONNECT_ACCEPTED && mqtt_client_is_connected(client)) {
+        mqtt_tls_keep_session(state);
+    }
+    else if (state->tls_offered) {                                  // Not resumable after all: full handshake next
+        altcp_tls_free_session(state->tls_session);
+        state->tls_session = NULL;
+    }
+    state->tls_offered = false;
+#endif
+    if (status == MQTT_CONNECT_ACCEPTED && mqtt_client_is_connected(client)) {
+        // see mqtt-session.patch for this call
+        state->session_present = mqtt_client_session_present(client);
+        if (!state->session_present) {
+            memset(state->rx_seen, 0, sizeof(state->rx_seen));   // New session: nothing to redeliver
+            state->rx_seen_next = 0;
+        }
+    }
     if (status != 0) {
         DEBUG_printf("Error during connection: err %d.\n", status);
-    } else {
+    } else if (mqtt_client_is_connected(client)) {
         DEBUG_printf("MQTT connected.\n");
+    } else {
+        DEBUG_printf("MQTT disconnected.\n");
     }
+    state->connect_status = status;
+    state->connect_done = true;
 }
 
 
@@ -159,51 +468,119 @@ err_t mqtt_test_publish(MQTT_CLIENT_T *state)
   return err; 
 }
 
+static void mqtt_publish_done_cb(void *arg, err_t err) {
+    MQTT_CLIENT_T *state = (MQTT_CLIENT_T *)arg;
+    if (err != ERR_OK) {
+        DEBUG_printf("Publish failed: err %d\n", err);
+        state->tx_failed++;
+    }
+}
+
+// PUBACK, or ERR_TIMEOUT when lwIP gave up waiting for it
+static void mqtt_publish_acked_cb(void *arg, err_t err) {
+    MQTT_CLIENT_T *state = (MQTT_CLIENT_T *)arg;
+    if (state->tx_inflight > 0) {
+        state->tx_inflight--;
+    }
+    if (err == ERR_OK) {
+        state->tx_acked++;
+    } else {
+        DEBUG_printf("Publish not acknowledged: err %d\n", err);
+        state->tx_failed++;
+    }
+}
+
+// Presence: MQTT_STATUS_ONLINE, retained, on the topic the will (see
+// mqtt_test_connect) overwrites with MQTT_STATUS_OFFLINE when the desk
+// goes silent. Call once per session; ERR_MEM as for mqtt_publish_message.
+err_t mqtt_publish_status(MQTT_CLIENT_T *state) {
+    return mqtt_publish_message(state, state->status_topic, MQTT_STATUS_ONLINE, strlen(MQTT_STATUS_ONLINE), 1, 1);
+}
+
+// Queues a publish. ERR_MEM means lwIP's output ring or request queue is
+// full, or MQTT_PUB_INFLIGHT_MAX QoS 1 publishes still await their PUBACK:
+// nothing was sent, try again later. Payloads are copied into the ring, so
+// the caller's buffer is free on return.
+err_t mqtt_publish_message(MQTT_CLIENT_T *state, const char *topic, const void *payload, uint16_t length,
+                           uint8_t qos, uint8_t retain) {
+    err_t err = ERR_MEM;
+    if (qos == 0 || state->tx_inflight < MQTT_PUB_INFLIGHT_MAX) {
+        state->tx_inflight += (qos > 0);        // Counted first: the PUBACK may beat the return
+        cyw43_arch_lwip_begin();
+        err = mqtt_publish(state->mqtt_client, topic, payload, length, qos, retain,
+                           qos > 0 ? mqtt_publish_acked_cb : mqtt_publish_done_cb, state);
+        cyw43_arch_lwip_end();
+        if (err != ERR_OK) {
+            state->tx_inflight -= (qos > 0);
+        }
+    }
+
+    if (err == ERR_OK) {
+        state->tx_published++;
+    } else if (err == ERR_MEM) {
+        state->tx_backpressure++;
+    } else {
+        DEBUG_printf("Publish to %s: err %d\n", topic, err);
+        state->tx_failed++;
+    }
+    return err;
+}
+
 err_t mqtt_test_connect(MQTT_CLIENT_T *state) {
     struct mqtt_connect_client_info_t ci;
     err_t err;
 
     memset(&ci, 0, sizeof(ci));
 
-    ci.client_id = "PicoW";
+    char mac[18];
+    mqtt_board_mac(mac, sizeof(mac));
+    snprintf(state->status_topic, sizeof(state->status_topic), "desks/%s/status", mac);
+    mqtt_client_id(state->client_id, sizeof(state->client_id));
+    ci.client_id = state->client_id;
     ci.client_user = NULL;
     ci.client_pass = NULL;
-    ci.keep_alive = 0;
-    ci.will_topic = NULL;
-    ci.will_msg = NULL;
-    ci.will_retain = 0;
-    ci.will_qos = 0;
+    ci.keep_alive = MQTT_KEEP_ALIVE_S;
+    ci.will_topic = state->status_topic;       // Retained, so a late subscriber still sees the desk is gone
+    ci.will_msg = MQTT_STATUS_OFFLINE;
+    ci.will_msg_len = strlen(MQTT_STATUS_OFFLINE);
+    ci.will_retain = 1;
+    ci.will_qos = 1;
+    ci.keep_session = MQTT_PERSISTENT_SESSION;   // see mqtt-session.patch
 
     #if MQTT_TLS
 
-    struct altcp_tls_config *tls_config;
-  
+    // Once: parsing the certificates is slow, and lwIP has no call to free a config
+    struct altcp_tls_config *tls_config = state->tls_config;
+    if (tls_config == NULL) {
     #if defined(CRYPTO_CA) && defined(CRYPTO_KEY) && defined(CRYPTO_CERT)
-    
-    DEBUG_printf("Setting up TLS with 2wayauth.\n");
-    tls_config = altcp_tls_create_config_client_2wayauth(
-        (const u8_t *)ca, 1 + strlen((const char *)ca),
-        (const u8_t *)key, 1 + strlen((const char *)key),
-        (const u8_t *)"", 0,
-        (const u8_t *)cert, 1 + strlen((const char *)cert)
-    );
-
-    // enable SNI on request
-    // see mqtt-sni.patch for changes to support this.
-    altcp_tls_set_server_name(tls_config, MQTT_SERVER_HOST);
+
+        DEBUG_printf("Setting up TLS with 2wayauth.\n");
+        tls_config = altcp_tls_create_config_client_2wayauth(
+            (const u8_t *)ca, 1 + strlen((const char *)ca),
+            (const u8_t *)key, 1 + strlen((const char *)key),
+            (const u8_t *)"", 0,
+            (const u8_t *)cert, 1 + strlen((const char *)cert)
+        );
+
+        // enable SNI on request
+        // see mqtt-sni.patch for changes to support this.
+        altcp_tls_set_server_name(tls_config, MQTT_SERVER_HOST);
 
     #elif defined(CRYPTO_CERT)
-    DEBUG_printf("Setting up TLS with cert.\n");
-    tls_config = altcp_tls_create_config_client((const u8_t *) cert, 1 + strlen((const char *) cert));
+        DEBUG_printf("Setting up TLS with cert.\n");
+        tls_config = altcp_tls_create_config_client((const u8_t *) cert, 1 + strlen((const char *) cert));
 
-    // enable SNI on request
-    // see mqtt-sni.patch for changes to support this.
-    altcp_tls_set_server_name(tls_config, MQTT_SERVER_HOST);
+        // enable SNI on request
+        // see mqtt-sni.patch for changes to support this.
+        altcp_tls_set_server_name(tls_config, MQTT_SERVER_HOST);
     #endif
 
-    if (tls_config == NULL) {
-        DEBUG_printf("Failed to initialize config\n");
-        return -1;
+        if (tls_config == NULL) {
+            DEBUG_printf("Failed to initialize config\n");
+            return -1;
+        }
+        state->tls_config = tls_config;
+        mqtt_tls_restore_session(state);
     }
 
     ci.tls_config = tls_config;
@@ -211,12 +588,22 @@ err_t mqtt_test_connect(MQTT_CLIENT_T *state) {
 
     const struct mqtt_connect_client_info_t *client_info = &ci;
 
+    state->connect_done = false;
+
     err = mqtt_client_connect(state->mqtt_client, &(state->remote_addr), MQTT_SERVER_PORT, mqtt_connection_cb, state, client_info);
     
     if (err != ERR_OK) {
         DEBUG_printf("mqtt_connect return %d\n", err);
     }
 
+    #if MQTT_TLS
+    // The handshake starts once TCP is up, so the session can still be set:
+    // an abbreviated handshake (ticket or session id) instead of a full one
+    if (err == ERR_OK && state->tls_session != NULL) {
+        state->tls_offered = altcp_tls_set_session(state->mqtt_client->conn, state->tls_session) == ERR_OK;
+    }
+    #endif
+
     return err;
 }
 
@@ -233,7 +620,7 @@ void mqtt_run_test(MQTT_CLIENT_T *state) {
     if (mqtt_test_connect(state) == ERR_OK) {
         absolute_time_t timeout = nil_time;
         bool subscribed = false;
-        mqtt_set_inpub_callback(state->mqtt_client, mqtt_pub_start_cb, mqtt_pub_data_cb, 0);
+        mqtt_set_inpub_callback(state->mqtt_client, mqtt_pub_start_cb, mqtt_pub_data_cb, (void *)state);
 
         while (true) {
             cyw43_arch_poll();
@@ -263,21 +650,66 @@ void mqtt_run_test(MQTT_CLIENT_T *state) {
     }
 }
 
-void mqtt_subscribe_to_topics(MQTT_CLIENT_T *state) {
+static void mqtt_route_suback_cb(void *arg, err_t err) {
+    MQTT_CLIENT_T *state = (MQTT_CLIENT_T *)arg;
+    if (err != ERR_OK) {
+        DEBUG_printf("Subscription refused: err %d\n", err);
+        state->sub_failed++;
+    }
+    if (state->sub_pending > 0) {
+        state->sub_pending--;
+    }
+    mqtt_pump_subscriptions(state);             // A request slot is free again
+}
 
-    const char* topics[] = { "f1:50:c2:b8:bf:22/led" };
-    
+// Sends SUBSCRIBEs for the routes not yet subscribed this session without
+// waiting for each SUBACK. When lwIP's request queue or output buffer is
+// full it stops; the next SUBACK, or the next call, carries on.
+void mqtt_pump_subscriptions(MQTT_CLIENT_T *state) {
     cyw43_arch_lwip_begin();
-    for (size_t i = 0; i < sizeof(topics)/sizeof(topics[0]); ++i) {
-        err_t e = mqtt_sub_unsub(state->mqtt_client, topics[i], 0, mqtt_sub_request_cb, 0, 1);
-        if (e == ERR_INPROGRESS) {
+    while (state->sub_next < state->route_count) {
+        const mqtt_route_t *route = &state->routes[state->sub_next];
+        err_t err = mqtt_sub_unsub(state->mqtt_client, route->filter, route->qos, mqtt_route_suback_cb, state, 1);
+        if (err == ERR_MEM) {
             break;
-        } else if (e != ERR_OK) {
-            DEBUG_printf("Subscribe failed for %s: %d\n", topics[i], e);
         }
+        if (err != ERR_OK) {
+            DEBUG_printf("Subscribe failed for %s: %d\n", route->filter, err);
+            state->sub_failed++;
+        } else {
+            state->sub_pending++;
+        }
+        state->sub_next++;
     }
     cyw43_arch_lwip_end();
-        
+}
+
+// Subscribes every route; call once per session. A resumed session still
+// has them, but subscribing again is what makes the broker send the
+// retained state, so the desk is current one round trip after connecting.
+void mqtt_subscribe_to_topics(MQTT_CLIENT_T *state) {
+    state->sub_next = 0;
+    state->sub_pending = 0;
+    mqtt_pump_subscriptions(state);
+}
+
+// Hands inbox records to their route handlers, releasing each after its
+// handler returns, until a handler returns true. False once the inbox is
+// empty.
+bool mqtt_dispatch(MQTT_CLIENT_T *state) {
+    const message_record_t *record;
+    while ((record = message_queue_peek(&state->inbox)) != NULL) {
+        bool act = false;
+        if (record->topic_id != MQTT_ROUTE_NONE && record->topic_id <= state->route_count) {
+            const mqtt_route_t *route = &state->routes[record->topic_id - 1];
+            act = route->handler(route->arg, record->payload, record->length);
+        }
+        message_queue_release(&state->inbox);
+        if (act) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void mqtt_create_client(MQTT_CLIENT_T *state) {
@@ -293,6 +725,23 @@ void mqtt_create_client(MQTT_CLIENT_T *state) {
     } 
 }
 
+// Ends the session, if any, so the client can connect again. A payload
+// that was being reassembled is abandoned; its inbox slot was never committed.
+// Closes the session, or the connect still in progress, without a
+// DISCONNECT: the broker publishes the will. mqtt_disconnect() runs no
+// callback, so what mqtt_connection_cb would reset is reset here.
+void mqtt_close_session(MQTT_CLIENT_T *state) {
+    cyw43_arch_lwip_begin();
+    mqtt_disconnect(state->mqtt_client);
+    cyw43_arch_lwip_end();
+    state->rx_record = NULL;
+    state->rx_remaining = 0;
+    state->tx_inflight = 0;
+#if MQTT_TLS
+    state->tls_offered = false;
+#endif
+}
+
 void mqtt_wait_for_connection(MQTT_CLIENT_T *state) {
     while (!mqtt_client_is_connected(state->mqtt_client)) {
         cyw43_arch_poll();
@@ -2,6 +2,8 @@
 #define MQTTCLIENT_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include "lwip/err.h"
 #include "lwip/ip_addr.h"
 
@@ -9,15 +11,93 @@
 extern "C" {
 #endif
 #include <lwip/apps/mqtt.h>
+#include "MessageQueue.h"
+
+#ifndef MQTT_ROUTES_MAX
+#define MQTT_ROUTES_MAX 8               /* Inbound channels (topic filters) */
+#endif
+#define MQTT_FILTER_MAX 64              /* Longest topic filter, including the terminator */
+#ifndef MQTT_DEDUPE_WINDOW
+#define MQTT_DEDUPE_WINDOW 8            /* Recent QoS 1 packet ids remembered to drop redeliveries */
+#endif
+#ifndef MQTT_PUB_INFLIGHT_MAX
+#define MQTT_PUB_INFLIGHT_MAX 2         /* Own QoS 1 publishes awaiting PUBACK; the rest of lwIP's */
+#endif                                  /* request slots stay free for subscriptions */
+#ifndef MQTT_COMMAND_QOS
+#define MQTT_COMMAND_QOS 1              /* Subscription QoS of the desk command routes */
+#endif
+#ifndef MQTT_TELEMETRY_QOS
+#define MQTT_TELEMETRY_QOS 0
+#endif
+#ifndef MQTT_PERSISTENT_SESSION
+#define MQTT_PERSISTENT_SESSION 1       /* Clean session 0: the broker keeps subscriptions and queues QoS 1 */
+#endif                                  /* commands while the desk is away */
+#define MQTT_CLIENT_ID_MAX 24           /* "desk-" and the MAC in hex, with room to spare */
+#define MQTT_STATUS_ONLINE "online"     /* Retained on desks/{mac}/status once connected */
+#define MQTT_STATUS_OFFLINE "offline"   /* The will: the broker publishes it when the desk goes silent */
+#define MQTT_ROUTE_NONE 0               /* Route id of nothing; real ids start at 1 */
+#ifndef MQTT_TLS_SESSION_FLASH
+#define MQTT_TLS_SESSION_FLASH 0        /* Keep the TLS session in the last flash sector across reboots */
+#endif
+#define MQTT_TLS_SESSION_MAX 1024       /* Flash record: header and serialized session, whole pages */
+
+struct altcp_tls_config;
+struct altcp_tls_session;
+
+/* Handles one inbound message of a route, in the context that calls
+ * mqtt_dispatch(). The payload is read where it lies in the inbox (NUL-
+ * terminated) and is gone after the return. Returns true if it produced
+ * something the caller should act on before the next message. */
+typedef bool (*mqtt_route_handler_t)(void *arg, const uint8_t *payload, uint16_t length);
+
+typedef struct mqtt_route_ {
+	char filter[MQTT_FILTER_MAX];   /* Subscription; may contain + and # */
+	uint8_t qos;
+	mqtt_route_handler_t handler;
+	void *arg;
+} mqtt_route_t;
 
 //typedef struct MQTT_CLIENT_T_ MQTT_CLIENT_T;
 typedef struct MQTT_CLIENT_T_ {
 	ip_addr_t remote_addr;
 	mqtt_client_t *mqtt_client;
+	char client_id[MQTT_CLIENT_ID_MAX]; /* Unique per board; a shared id makes the broker kick the other desk */
+	bool session_present;           /* The broker resumed our session on the last connect */
+	char status_topic[MQTT_FILTER_MAX]; /* desks/{mac}/status: will and presence */
+	struct altcp_tls_config *tls_config;   /* Made on the first connect and reused */
+	struct altcp_tls_session *tls_session; /* Of the last session that got up, offered on the next connect */
+	bool tls_offered;               /* The connect in progress offered tls_session */
+	bool tls_stored;                /* Flash holds this boot's session; until then the next one is written */
 	uint32_t received;
 	uint32_t counter;
-	uint32_t reconnect;
-	char message[1025];
+	uint32_t reconnect;             /* Sessions that were up and got lost */
+	volatile bool connect_done;     /* mqtt_connection_cb ran since the last connect attempt */
+	mqtt_connection_status_t connect_status; /* Its status */
+	volatile bool dns_failed;       /* Lookup finished without an address */
+	message_queue_t inbox;          /* Complete inbound messages, read by the app */
+	message_record_t *rx_record;    /* Inbox slot the current publish is written into, NULL = skip it */
+	uint32_t rx_remaining;          /* Payload bytes of the current publish still to come */
+	uint32_t rx_length;             /* Payload bytes written to rx_record so far */
+	uint8_t rx_topic;               /* Route id of the current publish */
+	uint16_t rx_packet_id;          /* Of the current publish, 0 for QoS 0 */
+	uint32_t rx_oversize;           /* Publishes skipped for exceeding MESSAGE_PAYLOAD_MAX */
+	uint32_t rx_unrouted;           /* Publishes no route matched */
+	uint16_t rx_seen[MQTT_DEDUPE_WINDOW]; /* Last QoS 1 packet ids taken this session, 0 = empty */
+	uint8_t rx_seen_next;           /* Oldest entry, overwritten next */
+	uint32_t rx_duplicates;         /* Redeliveries (DUP) of a message already taken */
+	uint32_t rx_lost;               /* QoS 1 publishes dropped with the inbox full, though lwIP acknowledged them */
+	mqtt_route_t routes[MQTT_ROUTES_MAX]; /* Route id n is routes[n - 1]; only ever appended to */
+	volatile uint8_t route_count;
+	uint8_t sub_next;               /* Next route to subscribe this session */
+	uint8_t sub_pending;            /* SUBSCRIBEs waiting for their SUBACK */
+	uint32_t sub_failed;            /* Subscriptions refused or not sent */
+	uint32_t tx_published;          /* Publishes handed to lwIP */
+	uint32_t tx_backpressure;       /* Publishes refused with ERR_MEM (output full), to be retried */
+	uint32_t tx_failed;             /* Publishes that failed otherwise */
+	uint8_t tx_inflight;            /* QoS 1 publishes awaiting PUBACK */
+	uint32_t tx_acked;              /* QoS 1 publishes the broker acknowledged */
+	void (*on_message)(void *arg);  /* Optional, called after each inbox commit */
+	void *on_message_arg;
 } MQTT_CLIENT_T;
 
 /* Public API exported by MqttClient.c */
@@ -25,10 +105,23 @@ MQTT_CLIENT_T* mqtt_client_init(void);
 err_t mqtt_test_connect(MQTT_CLIENT_T *state);
 err_t mqtt_test_publish(MQTT_CLIENT_T *state);
 void run_dns_lookup(MQTT_CLIENT_T *state);
+err_t mqtt_start_dns_lookup(MQTT_CLIENT_T *state);
 void mqtt_run_test(MQTT_CLIENT_T *state);
 void mqtt_create_client(MQTT_CLIENT_T *state);
 void mqtt_subscribe_to_topics(MQTT_CLIENT_T *state);
+void mqtt_pump_subscriptions(MQTT_CLIENT_T *state);
+uint8_t mqtt_add_route(MQTT_CLIENT_T *state, const char *filter, uint8_t qos, mqtt_route_handler_t handler, void *arg);
+uint8_t mqtt_route_topic(const MQTT_CLIENT_T *state, const char *topic);
+bool mqtt_topic_matches(const char *filter, const char *topic);
+bool mqtt_board_mac(char *out, size_t size);
+bool mqtt_client_id(char *out, size_t size);
+bool mqtt_desk_topic(char *out, size_t size, const char *channel);
+err_t mqtt_publish_message(MQTT_CLIENT_T *state, const char *topic, const void *payload, uint16_t length,
+                           uint8_t qos, uint8_t retain);
+err_t mqtt_publish_status(MQTT_CLIENT_T *state);
+bool mqtt_dispatch(MQTT_CLIENT_T *state);
 void mqtt_wait_for_connection(MQTT_CLIENT_T *state);
+void mqtt_close_session(MQTT_CLIENT_T *state);
 
 /* Non-static callbacks / helpers (declared because they are non-static in the .c)
 	Keep these here only if other translation units need to reference them. */
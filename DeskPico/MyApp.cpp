@@ -6,6 +6,7 @@
 #include <string>
 #include <time.h>
 #include "pico/cyw43_arch.h"
+#include "pico/rand.h"
 #include "lwip/pbuf.h"
 #include "lwip/tcp.h"
 #include "lwip/dns.h"
@@ -17,42 +18,91 @@
 #include "tusb.h"
 #include "MqttClient.h"
 #include "NeoPixel.h"
+#include "DeskMessages.h"
+#include <algorithm>
+#include <malloc.h>
+#ifdef DESKPICO_DUAL_CORE
+#include "pico/multicore.h"
+#endif
+#if MQTT_TLS_SESSION_FLASH
+#include "pico/flash.h"
+#endif
+
+#ifndef DESKPICO_DUAL_CORE
+//-------------------------------------------------------------------------
+//  Pending-work marker on the cyw43 async context. Setting it releases
+//  cyw43_arch_wait_for_work_until(), so interrupt-side events (button,
+//  timeline alarms) end the scheduler's idle without waiting for the
+//  deadline. The work itself is done by the tasks.
+//-------------------------------------------------------------------------
+static async_when_pending_worker_t wakeWorker = {
+    .next = nullptr,
+    .do_work = [](async_context_t*, async_when_pending_worker_t*) {},
+    .work_pending = false,
+    .user_data = nullptr,
+};
+#else
+//-------------------------------------------------------------------------
+//  Dual-core mode: core 1 owns cyw43/lwIP/MQTT and fills the inbox, core 0
+//  runs the desk and UI tasks. The multicore FIFO is only a doorbell; the
+//  messages themselves travel through the lock-free inbox ring.
+//-------------------------------------------------------------------------
+static MyApp* core1App = nullptr;
+
+// Core 0 idle: sleep until an interrupt, a doorbell or the deadline
+static void idleCore0(absolute_time_t until) {
+    best_effort_wfe_or_timeout(until);
+    multicore_fifo_drain();
+}
+
+// Core 1, after each inbox commit. A FIFO push also raises the event that
+// ends core 0's WFE; a full FIFO means a wake-up is already pending.
+static void ringDoorbell(void*) {
+    if (multicore_fifo_wready()) {
+        multicore_fifo_push_blocking(0);
+    }
+    else {
+        __sev();
+    }
+}
+#endif
 
 
 MyApp::MyApp()
-        : display(i2c_default, 0x3C, 128, 32),
-          RGBLed(6, 1),
+        : displayBus(i2c_default, SSD1306_I2C_ADDR),
+          display(displayBus),
+          RGBLed(6),
+          ledEffects(RGBLed),
           RLed(7),
           buzzer(20),
-          button(10)
+          button(10),
+          networkTask(*this),
+          telemetryTask(*this),
+          deskTask(*this),
+          uiTask(*this),
+#ifdef DESKPICO_DUAL_CORE
+          scheduler(idleCore0),
+          networkScheduler(cyw43_arch_wait_for_work_until)
+#else
+          scheduler(cyw43_arch_wait_for_work_until)                        // Idle: sleep until wifi work, an event or a deadline
+#endif
 
 {
     stdio_init_all();
-    
-    if (cyw43_arch_init()) {
-        printf("failed to initialise\n");
-        //return 1;
-    }
-
-    cyw43_arch_enable_sta_mode();
 
-    printf("Connecting to WiFi...\n");
-    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
-        printf("failed to  connect.\n");
-        //return 1;
-    } else {
-        printf("Connected.\n");
-    }
+#ifndef DESKPICO_DUAL_CORE
+    startNetwork();                                                        // Core 1 does this in dual-core mode
+#endif
+    button.setNotify(notify, this);
+    timeline.setNotify(notify, this);
 
 
-    i2c_init(i2c_default, 400 * 1000);                                     
-    gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);            
-    gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);            
-    gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);                                
-    gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
+    I2CDisplayTransport::initBus(i2c_default, PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN);
 
     display.init();                                                        
-    display.clear();                                                       
+    showScreen(desk.output().screen);                                      // OFFLINE until the broker session is up
+
+    ledEffects.start();                                                     // LED refresh runs off a repeating timer
 }
 
 qrcodegen::QrCode MyApp::generateQRCode(std::string address) {
@@ -60,96 +110,472 @@ qrcodegen::QrCode MyApp::generateQRCode(std::string address) {
     return qr;
 }
 
-void MyApp::changePositionEvent(std::string text) {
-    RLed.on();
-    displayText(text);
-    buzzer.buzzTone(1000, 300);
-    sleep_ms(5000);
-    RLed.off();
+//-------------------------------------------------------------------------
+//  Sit/stand prompt: red LED and a beep, then back to Occupied after 5.3 s.
+//  Runs on the timeline so the loop keeps polling meanwhile.
+//-------------------------------------------------------------------------
+void MyApp::changePositionEvent() {
+    static const TimelineStep prompt[] = {
+        {    0, [](void* app) { static_cast<MyApp*>(app)->RLed.on(); } },
+        {    0, [](void* app) { static_cast<MyApp*>(app)->buzzer.buzzTone(1000, 300); } },
+        { 5300, [](void* app) { static_cast<MyApp*>(app)->RLed.off(); } },
+        { 5300, [](void* app) { static_cast<MyApp*>(app)->handleCommand(DeskCommand::PromptDone); } },
+    };
+    timeline.start(prompt, sizeof(prompt) / sizeof(prompt[0]), this);
 }
-void MyApp::displayText(std::string text) {
+
+void MyApp::displayText(std::string text, const char* detail) {
     display.clear();
-    display.writeText(5,16,text.c_str());
+    if (*detail == '\0') {
+        display.writeText(5,16,text.c_str());
+    }
+    else {
+        display.writeText(5,4,text.c_str());
+        display.writeText(0,20,detail);                                     // 16 characters fit, the rest is cut
+    }
     display.render();
 }
 
+void MyApp::handleCommand(DeskCommand command) {
+    uint8_t changed = desk.handle(command);
+
+    if (screenTextChanged) {                                                // Same screen, new booking text
+        changed |= DeskStateMachine::CHANGED_SCREEN;
+        screenTextChanged = false;
+    }
+    if (changed & DeskStateMachine::CHANGED_SCREEN) {
+        showScreen(desk.output().screen);
+    }
+    if (changed & DeskStateMachine::CHANGED_LED) {
+        showLed(desk.output().led);
+    }
+    if (changed & DeskStateMachine::START_PROMPT) {
+        changePositionEvent();
+    }
+}
+
+void MyApp::showScreen(DeskScreen screen) {
+    switch (screen) {
+        case DeskScreen::Offline:  displayText("OFFLINE");  break;
+        case DeskScreen::Reserved: displayText("RESERVED", screenText); break;
+        case DeskScreen::Occupied: displayText("OCCUPIED", screenText); break;
+        case DeskScreen::SitDown:  displayText("SIT DOWN"); break;
+        case DeskScreen::StandUp:  displayText("STAND UP"); break;
+        case DeskScreen::QrCode:
+            if (!qr) {                                                      // Only shown once online: the MAC is known
+                char mac[18];
+                mqtt_board_mac(mac, sizeof(mac));                           // Same identity as the topics
+                qr = generateQRCode(mac);
+            }
+            display.clear();
+            display.drawQRCode(20,0, *qr, 1);
+            display.renderRaw();
+            break;
+    }
+}
+
+// A booking command (free / occupied / reserved) brings its own text, or
+// none: the old one never stays on a new booking. Sit and stand keep it.
+void MyApp::setScreenText(DeskCommand command, const char* text) {
+    if (command != DeskCommand::Free && command != DeskCommand::Occupy && command != DeskCommand::Reserve) {
+        return;
+    }
+    if (strcmp(screenText, text) != 0) {
+        snprintf(screenText, sizeof(screenText), "%s", text);
+        screenTextChanged = true;
+    }
+}
+
+void MyApp::showLed(DeskLed led) {
+    switch (led) {
+        case DeskLed::Off:      ledEffects.fadeTo(LED_OFF);     break;
+        case DeskLed::Free:     ledEffects.fadeTo(LED_GREEN);   break;  // Free
+        case DeskLed::Reserved: ledEffects.pulse(LED_YELLOW);   break;  // Booked - starting soon
+        case DeskLed::Occupied: ledEffects.fadeTo(LED_RED);     break;
+    }
+}
+
+void MyApp::startNetwork() {
+    if (cyw43_arch_init()) {
+        printf("failed to initialise\n");
+        //return 1;
+    }
+
+#ifndef DESKPICO_DUAL_CORE
+    async_context_add_when_pending_worker(cyw43_arch_async_context(), &wakeWorker);
+#endif
+
+    cyw43_arch_enable_sta_mode();                                           // The network task joins, and rejoins
+}
+
+void MyApp::notify(void*) {
+#ifdef DESKPICO_DUAL_CORE
+    __sev();                                                                // Core 0 idles in WFE
+#else
+    async_context_set_work_pending(cyw43_arch_async_context(), &wakeWorker);
+#endif
+}
+
+//-------------------------------------------------------------------------
+//  Brings up the MQTT client and hands the loop to the scheduler. The core
+//  sleeps whenever every task is waiting.
+//-------------------------------------------------------------------------
 void MyApp::run() {
 
-    
-    MQTT_CLIENT_T *state = mqtt_client_init();
+    mqtt = mqtt_client_init();
+    if (mqtt == nullptr) {
+        return;
+    }
+
+#ifdef DESKPICO_DUAL_CORE
+    mqtt->on_message = ringDoorbell;
+    core1App = this;
+#if MQTT_TLS_SESSION_FLASH
+    flash_safe_execute_core_init();                                         // Core 1 writes the TLS session to flash
+#endif
+    multicore_launch_core1(core1Main);
 
-    run_dns_lookup(state);
-    
+    scheduler.add(deskTask);
+    scheduler.add(uiTask);
+    scheduler.run();
+#else
+    scheduler.add(networkTask);
+    scheduler.add(telemetryTask);
+    scheduler.add(deskTask);
+    scheduler.add(uiTask);
+    scheduler.run();
+
+    cyw43_arch_deinit();
+#endif
+}
+
+#ifdef DESKPICO_DUAL_CORE
+void MyApp::core1Main() {
+    MyApp& app = *core1App;
+
+    app.startNetwork();                                                     // cyw43 belongs to the core that initialised it
+    app.networkScheduler.add(app.networkTask);
+    app.networkScheduler.add(app.telemetryTask);
+    app.networkScheduler.run();
+
+    cyw43_arch_deinit();
+}
+#endif
+
+//-------------------------------------------------------------------------
+//  Connection supervisor: WiFi join, DNS, MQTT connect and subscribe, then
+//  watch the link and the session. Any failed step, and any loss later,
+//  starts over from the top after a jittered, growing delay (Backoff), so
+//  a fleet that lost the broker does not reconnect in lockstep. The MQTT
+//  keepalive makes lwIP notice a broker that vanished without a FIN.
+//-------------------------------------------------------------------------
+TaskState MyApp::NetworkTask::run() {
+    cyw43_arch_poll();                                                      // Every pass: drive the wifi chip and lwIP
+    MQTT_CLIENT_T* state = app.mqtt;
+
+    TASK_BEGIN();
     mqtt_create_client(state);
+    app.addRoutes();
+
+    while (true) {
+        if (!wifiUp()) {
+            printf("Connecting to WiFi...\n");
+            cyw43_arch_wifi_connect_async(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
+            TASK_AWAIT_FOR(wifiUp() || wifiFailed(), JOIN_TIMEOUT_MS);
+            if (!wifiUp()) {
+                printf("WiFi join failed (%d)\n", cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA));
+                TASK_SLEEP_MS(retryDelay());
+                continue;
+            }
+            printf("Connected.\n");
+        }
+
+        if (mqtt_start_dns_lookup(state) == ERR_INPROGRESS) {
+            TASK_AWAIT_FOR(state->remote_addr.addr != 0 || state->dns_failed, DNS_TIMEOUT_MS);
+        }
+        if (state->remote_addr.addr == 0) {
+            printf("DNS lookup failed\n");
+            TASK_SLEEP_MS(retryDelay());
+            continue;
+        }
 
-    mqtt_test_connect(state);
+        if (mqtt_test_connect(state) == ERR_OK) {
+            TASK_AWAIT_FOR(state->connect_done, CONNECT_TIMEOUT_MS);
+        }
+        if (!mqtt_client_is_connected(state->mqtt_client)) {
+            printf("MQTT connect failed (%d)\n", state->connect_done ? (int)state->connect_status : -1);
+            mqtt_close_session(state);
+            TASK_SLEEP_MS(retryDelay());
+            continue;
+        }
+        printf(state->session_present ? "MQTT connected, session resumed\n" : "MQTT connected!\n");
 
-    mqtt_wait_for_connection(state);
+        announced = mqtt_publish_status(state) == ERR_OK;                   // Replaces the will's "offline"
+        mqtt_subscribe_to_topics(state);                                    // Every time: brings the retained state
+        backoff.reset();
+        app.online = true;
+        notify(nullptr);                                                    // Desk task may be on the other core
 
-    mqtt_subscribe_to_topics(state);
-        
-    std::string message = "free";
-    const qrcodegen::QrCode qr = generateQRCode("f1:50:c2:b8:bf:22");
-    
-    bool occupied = false; //false = qr code show, true = booked state
+        while (mqtt_client_is_connected(state->mqtt_client) && wifiUp()) {
+            if (state->sub_next < state->route_count || !announced) {       // lwIP had no room for them yet
+                TASK_SLEEP_MS(SUBSCRIBE_RETRY_MS);
+                if (!announced) {
+                    announced = mqtt_publish_status(state) == ERR_OK;
+                }
+                mqtt_pump_subscriptions(state);
+            }
+            else {
+                TASK_AWAIT(state->sub_next < state->route_count
+                           || !mqtt_client_is_connected(state->mqtt_client) || !wifiUp());
+            }
+        }
+        printf(wifiUp() ? "MQTT session lost\n" : "WiFi link lost\n");
+        state->reconnect++;
+        app.online = false;
+        notify(nullptr);
+        mqtt_close_session(state);
+        TASK_SLEEP_MS(retryDelay());                                        // Even the first retry is jittered
+    }
+    TASK_END();
+}
 
-    //bool prevButtonState = false;
+bool MyApp::NetworkTask::wifiUp() const {
+    return cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP;
+}
+
+bool MyApp::NetworkTask::wifiFailed() const {
+    return cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) < 0;     // CYW43_LINK_FAIL, _NONET, _BADAUTH
+}
+
+uint32_t MyApp::NetworkTask::retryDelay() {
+    uint32_t ms = backoff.next(get_rand_32());
+    printf("Retrying in %u ms (attempt %u)\n", ms, backoff.attempts());
+    return ms;
+}
+
+//-------------------------------------------------------------------------
+//  Telemetry: readings every PERIOD_MS, plus whatever was recorded since,
+//  go out as one batch on desks/{mac}/telemetry; a half-full ring flushes
+//  early. Batches are rate-limited, and when lwIP's output ring is full
+//  the samples stay queued and the publish is retried. Offline, samples
+//  wait in the ring (the oldest giving way) until the session is back.
+//-------------------------------------------------------------------------
+TaskState MyApp::TelemetryTask::run() {
+    TASK_BEGIN();
+    {
+        char mac[18];
+        mqtt_board_mac(mac, sizeof(mac));
+        snprintf(topic, sizeof(topic), "desks/%s/telemetry", mac);
+    }
+    nextSample = make_timeout_time_ms(PERIOD_MS);
 
     while (true) {
+        TASK_AWAIT_FOR(app.online && app.telemetry.pending() >= FLUSH_AT, msToNextSample());
+        if (time_reached(nextSample)) {
+            sample();
+            nextSample = make_timeout_time_ms(PERIOD_MS);
+        }
+
+        while (app.online && app.telemetry.pending() > 0) {
+            length = app.telemetry.encode(batch, sizeof(batch), seq, end);
+            if (length == 0) {
+                break;
+            }
+            result = mqtt_publish_message(app.mqtt, topic, batch, (uint16_t)length, MQTT_TELEMETRY_QOS, 0);
+            if (result == ERR_MEM) {
+                TASK_SLEEP_MS(RETRY_MS);                                    // Backpressure: samples stay queued
+                continue;
+            }
+            if (result != ERR_OK) {
+                break;                                                      // Session gone; the supervisor reconnects
+            }
+            app.telemetry.consume(end);
+            seq++;
+            TASK_SLEEP_MS(MIN_INTERVAL_MS);
+        }
+    }
+    TASK_END();
+}
 
-    cyw43_arch_poll();
+#if PICO_ON_DEVICE
+extern char __StackLimit, __bss_end__;                                      // Heap bounds from the linker script
+#endif
 
-    if (state != nullptr && state->message[0] != '\0') {
-        message.assign(state->message);
-        state->message[0] = '\0';
+void MyApp::TelemetryTask::sample() {
+    int32_t rssi;
+
+    app.telemetry.record(TelemetryKind::Uptime, to_ms_since_boot(get_absolute_time()) / 1000);
+    if (app.online && cyw43_wifi_get_rssi(&cyw43_state, &rssi) == 0) {
+        app.telemetry.record(TelemetryKind::Rssi, rssi);
     }
-    else {
-        message.clear();
-        continue;
+    app.telemetry.record(TelemetryKind::LoopLatency, app.scheduler.takeLongestPassUs());
+#if PICO_ON_DEVICE
+    app.telemetry.record(TelemetryKind::HeapFree, (&__StackLimit - &__bss_end__) - mallinfo().uordblks);
+#endif
+}
+
+uint32_t MyApp::TelemetryTask::msToNextSample() const {
+    int64_t us = absolute_time_diff_us(get_absolute_time(), nextSample);
+    return us > 0 ? (uint32_t)((us + 999) / 1000) : 0;
+}
+
+TaskState MyApp::DeskTask::run() {
+    TASK_BEGIN();
+    while (true) {
+        TASK_AWAIT(app.nextCommand(command));
+        app.handleCommand(command);
     }
+    TASK_END();
+}
 
-    if(message == "red") {
-        occupied = true;
+TaskState MyApp::UiTask::run() {
+    TASK_BEGIN();
+    while (true) {
+        TASK_AWAIT(app.timeline.isDue());
+        app.timeline.poll();
     }
-    else if(message == "green") {
-        occupied = false;
-    } 
-    
-    if(occupied) {  
-        if(message == "sit") {
-            changePositionEvent("SIT DOWN");
+    TASK_END();
+}
+
+//-------------------------------------------------------------------------
+//  Inbound channels. Topics are built from the board's MAC; a new command
+//  channel is one more route and a handler. Commands are subscribed at
+//  MQTT_COMMAND_QOS, 1 by default like the backend publishes them, so a
+//  state change survives a lost packet; MqttClient.c drops redeliveries.
+//-------------------------------------------------------------------------
+void MyApp::addRoutes() {
+    char topic[MQTT_FILTER_MAX];
+
+    if (mqtt_desk_topic(topic, sizeof(topic), "led")) {
+        mqtt_add_route(mqtt, topic, MQTT_COMMAND_QOS, onLedMessage, this);
+    }
+    if (mqtt_desk_topic(topic, sizeof(topic), "buzzer")) {
+        mqtt_add_route(mqtt, topic, MQTT_COMMAND_QOS, onBuzzerMessage, this);
+    }
+    if (mqtt_desk_topic(topic, sizeof(topic), "state")) {
+        mqtt_add_route(mqtt, topic, MQTT_COMMAND_QOS, onStateMessage, this);
+    }
+}
+
+// A CBOR or JSON message, as opposed to a bare command word
+static bool isStructured(const uint8_t* payload, uint16_t length) {
+    return isDeskMessage(payload, length) || isDeskJson(payload, length);
+}
+
+static bool decodeStructured(const uint8_t* payload, uint16_t length, DeskMessage& message) {
+    return isDeskMessage(payload, length) ? decodeDeskMessage(payload, length, message)
+                                          : decodeDeskJson(payload, length, message);
+}
+
+// {mac}/led: a desk command for the state machine, as a CBOR or JSON
+// message (DeskMessages.h) or as the bare word (red / green / reserved /
+// sit / stand). A message's text goes under RESERVED / OCCUPIED; its
+// height and until are checked but not used, this desk has no motor and
+// no booking timer.
+bool MyApp::onLedMessage(void* arg, const uint8_t* payload, uint16_t length) {
+    MyApp* app = static_cast<MyApp*>(arg);
+    DeskMessage message;
+
+    if (!isStructured(payload, length)) {
+        app->inbound = parseDeskCommand(std::string_view((const char*)payload, length));
+    }
+    else if (decodeStructured(payload, length, message)) {
+        app->inbound = toDeskCommand(message.command);
+    }
+    else {
+        app->inbound = DeskCommand::Unknown;
+    }
+    app->setScreenText(app->inbound, message.text);                         // Empty unless a message had one
+    return app->inbound != DeskCommand::Unknown;
+}
+
+// {mac}/state: the desk's booking state, retained by the broker, so a desk
+// that (re)connects shows it straight after subscribing instead of at the
+// backend's next broadcast. Only free / occupied / reserved are taken:
+// replaying a retained sit or stand would move the desk on every boot.
+bool MyApp::onStateMessage(void* arg, const uint8_t* payload, uint16_t length) {
+    MyApp* app = static_cast<MyApp*>(arg);
+    DeskMessage message;
+    WireCommand command = WireCommand::None;
+
+    if (!isStructured(payload, length)) {
+        command = parseWireCommand(std::string_view((const char*)payload, length));
+        if (command == WireCommand::None) {
+            command = parseDeskState(std::string_view((const char*)payload, length));
         }
-        else if(message == "stand") {
-            changePositionEvent("STAND UP");
+    }
+    else if (decodeStructured(payload, length, message)) {
+        command = message.command;
+    }
+
+    bool state = command == WireCommand::Free || command == WireCommand::Occupy || command == WireCommand::Reserve;
+    app->inbound = state ? toDeskCommand(command) : DeskCommand::Unknown;
+    app->setScreenText(app->inbound, message.text);
+    return state;
+}
+
+// {mac}/buzzer: "buzz" is the backend's reminder to change position; a
+// CBOR or JSON buzz command may choose the tone
+bool MyApp::onBuzzerMessage(void* arg, const uint8_t* payload, uint16_t length) {
+    static const BuzzerNote reminder[] = {
+        { 1000, 150, 255 },
+        {    0, 100,   0 },
+        { 1000, 150, 255 },
+    };
+    MyApp* app = static_cast<MyApp*>(arg);
+    DeskMessage message;
+
+    if (!isStructured(payload, length)) {
+        if (std::string_view((const char*)payload, length) == "buzz") {
+            app->buzzer.play(reminder, sizeof(reminder) / sizeof(reminder[0]));
         }
-        displayText("OCCUPIED");
-        RGBLed.setPixelColor(0,255,0,0);
     }
-    else {
-        if(message == "green") {
-            display.clear();
-            display.drawQRCode(20,0, qr, 1);
-            display.renderRaw();
-            RGBLed.setPixelColor(0,0,255,0); //Free
+    else if (decodeStructured(payload, length, message) && message.command == WireCommand::Buzz) {
+        if (!(message.fields & DeskMessage::HAS_TONE)) {
+            app->buzzer.play(reminder, sizeof(reminder) / sizeof(reminder[0]));
+            return false;
         }
-        /*else if (message == "reserved") { // Is reserved - Yellow
-            displayText("RESERVED");
-            RGBLed.setPixelColor(0,255,255,0); //Booked - Green
-        }*/
-    }
-    
-    //bool btn = button.read();
-
-    /* if (btn && !prevButtonState) {
-        sleep_ms(50);
-        if (button.read()) {
-            occupied = !occupied;
-            sleep_ms(150);
+        unsigned repeat = std::clamp<unsigned>(message.toneRepeat, 1, Buzzer::QUEUE_LEN / 2);
+        for (unsigned i = 0; i < repeat; i++) {
+            app->buzzer.buzzTone(message.toneHz, message.toneMs);
+            app->buzzer.rest(message.toneMs / 2);
         }
-    } */
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------------
+//  Next input for the state machine. Inbox payloads go to their route's
+//  handler where they lie in the queue, so the record can be released
+//  straight away.
+//-------------------------------------------------------------------------
+bool MyApp::nextCommand(DeskCommand& command) {
+    if (online != linkUp) {
+        linkUp = online;
+        command = linkUp ? DeskCommand::Connected : DeskCommand::Disconnected;
+        return true;
+    }
 
-    //prevButtonState = btn;
-    message = "";
+    if (mqtt_dispatch(mqtt)) {
+        command = inbound;
+        return true;
+    }
+
+    if (buttonPressed()) {
+        telemetry.record(TelemetryKind::Button, 1);
+        command = DeskCommand::Button;                                      // Check-in / check-out at the desk
+        return true;
+    }
+    return false;
 }
-    cyw43_arch_deinit();
+
+bool MyApp::buttonPressed() {
+    ButtonEvent buttonEvent;
+
+    while (button.pollEvent(buttonEvent)) {
+        if (buttonEvent.type == ButtonEventType::Press) {
+            return true;
+        }
+    }
+    return false;
 }
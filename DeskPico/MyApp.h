@@ -13,12 +13,22 @@
 //-------------------------------------------------------------------------
 
 #include "OLEDDisplay.h"
+#include "I2CDisplayTransport.h"
 #include "MqttClient.h"
 #include "NeoPixel.h"
+#include "LedEffects.h"
 #include "RedLed.h"
 #include "Buzzer.h"
 #include "Button.h"
+#include "Timeline.h"
+#include "Scheduler.h"
+#include "DeskStateMachine.h"
+#include "DeskMessages.h"
+#include "Backoff.h"
+#include "Telemetry.h"
+#include <optional>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <iomanip>
 #include <ios>
@@ -29,15 +39,107 @@ public:
     MyApp();                                                               
     void run();                                                            
     qrcodegen::QrCode generateQRCode(std::string address);
-    void changePositionEvent(std::string text);
-    void displayText(std::string text);                                          
+    void changePositionEvent();                                            // Red LED and beep for the sit/stand prompt
+    void displayText(std::string text, const char* detail = "");           // detail: a second, smaller line
+    void handleCommand(DeskCommand command);                               // Drives only the outputs that changed
+
+    // Read-only views for diagnostics (host replay tool)
+    const MQTT_CLIENT_T* client() const { return mqtt; }
+    const DeskStateMachine& deskState() const { return desk; }
 
 private:                                                   
-    OLEDDisplay display;                                                 
-    NeoPixel RGBLed;
+    //---------------------------------------------------------------------
+    //  Main-loop tasks, run by the scheduler (see Scheduler.h)
+    //---------------------------------------------------------------------
+    struct NetworkTask : Task {                                            // cyw43/lwIP polling, connection supervisor
+        static constexpr uint32_t JOIN_TIMEOUT_MS = 30000;
+        static constexpr uint32_t DNS_TIMEOUT_MS = 10000;
+        static constexpr uint32_t CONNECT_TIMEOUT_MS = 10000;
+        static constexpr uint32_t SUBSCRIBE_RETRY_MS = 100;
+
+        explicit NetworkTask(MyApp& app) : Task("network"), app(app) {}
+        TaskState run() override;
+        bool wifiUp() const;
+        bool wifiFailed() const;                                           // Join gave up (bad auth, no AP, ...)
+        uint32_t retryDelay();                                             // Next backoff delay, logged
+        MyApp& app;
+        Backoff backoff{1000, 60000};                                      // 1 s doubling to 60 s, equal jitter
+        bool announced = false;                                            // Retained "online" queued this session
+    };
+    struct TelemetryTask : Task {                                          // Samples, batched publishes
+        static constexpr uint32_t PERIOD_MS = 30000;                       // Periodic readings and flush
+        static constexpr uint32_t MIN_INTERVAL_MS = 2000;                  // At most one batch per interval
+        static constexpr uint32_t RETRY_MS = 250;                          // After lwIP's output ring was full
+        static constexpr size_t FLUSH_AT = Telemetry::CAPACITY / 2;        // Pending samples that flush early
+        static constexpr size_t BATCH_MAX = 512;
+
+        explicit TelemetryTask(MyApp& app) : Task("telemetry"), app(app) {}
+        TaskState run() override;
+        void sample();                                                     // Uptime, RSSI, loop latency, heap
+        uint32_t msToNextSample() const;
+        MyApp& app;
+        absolute_time_t nextSample = nil_time;
+        uint32_t seq = 0;                                                  // Batch number since boot
+        uint32_t end = 0;                                                  // Ring position after the batch
+        size_t length = 0;
+        err_t result = ERR_OK;
+        char topic[MQTT_FILTER_MAX] = {};                                  // desks/{mac}/telemetry
+        uint8_t batch[BATCH_MAX];
+    };
+    struct DeskTask : Task {                                               // MQTT commands and the button
+        explicit DeskTask(MyApp& app) : Task("desk"), app(app) {}
+        TaskState run() override;
+        MyApp& app;
+        DeskCommand command = DeskCommand::Unknown;
+    };
+    struct UiTask : Task {                                                 // Timeline steps that fell due
+        explicit UiTask(MyApp& app) : Task("ui"), app(app) {}
+        TaskState run() override;
+        MyApp& app;
+    };
+
+    void addRoutes();                                                      // MQTT channels and their handlers
+    static bool onLedMessage(void* arg, const uint8_t* payload, uint16_t length);
+    static bool onBuzzerMessage(void* arg, const uint8_t* payload, uint16_t length);
+    static bool onStateMessage(void* arg, const uint8_t* payload, uint16_t length);
+    bool nextCommand(DeskCommand& command);                                // Link change, MQTT command or button press
+    bool buttonPressed();                                                  // Drains button events, true on a press
+    void showScreen(DeskScreen screen);
+    void setScreenText(DeskCommand command, const char* text);
+    void showLed(DeskLed led);
+    static void notify(void* arg);                                         // IRQ-safe: wake the idle main loop
+    void startNetwork();                                                   // cyw43 init, on the network core
+#ifdef DESKPICO_DUAL_CORE
+    static void core1Main();                                               // Network scheduler on core 1
+#endif
+
+
+    I2CDisplayTransport displayBus;
+    OLEDDisplay128x32 display;                                           
+    NeoPixelStrip<1> RGBLed;
+    LedEffects ledEffects;
     RedLed RLed;
     Buzzer buzzer;
     Button button;
+    Timeline timeline;                                                     // Timed actuator sequences (prompts)
+    DeskStateMachine desk;
+    Telemetry telemetry;
+    volatile bool online = false;                                          // MQTT session up (set by the network task)
+    bool linkUp = false;                                                   // Last value of online seen by the desk task
+    DeskCommand inbound = DeskCommand::Unknown;                            // Set by onLedMessage for nextCommand
+    char screenText[DeskMessage::TEXT_MAX + 1] = {};                       // Under RESERVED / OCCUPIED, from the booking
+    bool screenTextChanged = false;
+    std::optional<qrcodegen::QrCode> qr;                                   // Board MAC, built once cyw43 is up
+
+    MQTT_CLIENT_T* mqtt = nullptr;
+    NetworkTask networkTask;
+    TelemetryTask telemetryTask;
+    DeskTask deskTask;
+    UiTask uiTask;
+    Scheduler scheduler;
+#ifdef DESKPICO_DUAL_CORE
+    Scheduler networkScheduler;                                            // Runs on core 1
+#endif
 };
 
 #endif
@@ -1,82 +1,184 @@
 #include "NeoPixel.h"
 #include "ws2812.pio.h"
+#include "hardware/dma.h"
 #include <cstddef>
 #include <cstdint>
 #include <pico/time.h>
-#include "ws2812.pio.h"
+
+/*****************************
+PROGRAM REGISTRY
+******************************/
+// The ws2812 program is loaded at most once per PIO block; every strip on
+// that block runs the same instructions from its own state machine.
+struct Ws2812ProgramSlot {
+    uint offset;                            // Where the program sits in instruction memory
+    uint users;                             // Strips using it; unloaded when this drops to 0
+};
+static Ws2812ProgramSlot programSlots[NUM_PIOS];
+
+// Returns the program offset on pio, loading it on first use
+static bool acquireProgram(PIO pio, uint* offset) {
+    Ws2812ProgramSlot& slot = programSlots[pio_get_index(pio)];
+    if (slot.users == 0) {
+        if (!pio_can_add_program(pio, &ws2812_program)) {
+            return false;
+        }
+        slot.offset = pio_add_program(pio, &ws2812_program);
+    }
+    slot.users++;
+    *offset = slot.offset;
+    return true;
+}
+
+static void releaseProgram(PIO pio) {
+    Ws2812ProgramSlot& slot = programSlots[pio_get_index(pio)];
+    if (slot.users > 0 && --slot.users == 0) {
+        pio_remove_program(pio, &ws2812_program, slot.offset);
+    }
+}
 
 /*****************************
 NEOPIXEL LIBRARY
 ******************************/
-// Constructor: Initializes NeoPixel with given pin number and number of LEDs
-NeoPixel::NeoPixel(uint8_t pinNumber, uint16_t numberOfPixels) {
-    this->pixelSm = 0;                         // Use state machine 0 of the PIO
-    this->pixelPio = pio0;                     // Use PIO0 hardware
+// Constructor: Initializes NeoPixel with given pin number and number of LEDs.
+// storage must hold numberOfPixels words and outlive the NeoPixel.
+// Takes the first PIO block with a free state machine and room for (or an
+// existing copy of) the program.
+NeoPixel::NeoPixel(uint8_t pinNumber, uint32_t* storage, uint16_t numberOfPixels) {
+    this->pixelWords = storage;                // Caller-owned pixel storage
+    this->pixelPio = nullptr;
+    for (uint i = 0; i < NUM_PIOS && this->pixelPio == nullptr; i++) {
+        PIO pio = pio_get_instance(i);
+        int sm = pio_claim_unused_sm(pio, false);
+        if (sm < 0) {
+            continue;
+        }
+        if (!acquireProgram(pio, &this->pixelOffset)) {
+            pio_sm_unclaim(pio, (uint)sm);     // No room for the program here
+            continue;
+        }
+        this->pixelPio = pio;
+        this->pixelSm = (uint)sm;
+    }
+    if (this->pixelPio == nullptr) {
+        panic("NeoPixel: no free PIO state machine");
+    }
     this->Init(pinNumber, numberOfPixels);     // Call initialization function
-} 
+}
 
+// Constructor: Initializes NeoPixel on a caller-chosen PIO and state machine
+NeoPixel::NeoPixel(uint8_t pinNumber, uint32_t* storage, uint16_t numberOfPixels, PIO pio, uint sm) {
+    this->pixelWords = storage;                // Caller-owned pixel storage
+    this->pixelPio = pio;
+    this->pixelSm = sm;
+    pio_sm_claim(pio, sm);                     // Panics if another driver owns it
+    if (!acquireProgram(pio, &this->pixelOffset)) {
+        panic("NeoPixel: no room for ws2812 program");
+    }
+    this->Init(pinNumber, numberOfPixels);     // Call initialization function
+}
 
+// Destructor: stops the strip and hands its resources back
+NeoPixel::~NeoPixel() {
+    dma_channel_abort(this->dmaChannel);
+    dma_channel_unclaim(this->dmaChannel);
+    pio_sm_set_enabled(this->pixelPio, this->pixelSm, false);
+    pio_sm_unclaim(this->pixelPio, this->pixelSm);
+    releaseProgram(this->pixelPio);
+}
 
 
-// Initializes the PIO program for controlling WS2812 LEDs (NeoPixel)
+// Initializes the state machine and DMA channel for controlling WS2812 LEDs (NeoPixel)
 void NeoPixel::Init(uint8_t pinNumber, uint16_t numberOfPixels) {
-    uint offset = pio_add_program(this->pixelPio, &ws2812_program); // Load WS2812 PIO program
-    ws2812_program_init(this->pixelPio, this->pixelSm, offset, pinNumber, 800000, false); // Initialize with 800kHz
+    ws2812_program_init(this->pixelPio, this->pixelSm, this->pixelOffset, pinNumber, WS2812_FREQ, false); // Initialize with 800kHz
+
+    // DMA channel paced by the state machine's TX FIFO: 32-bit words from
+    // the pixel storage into a fixed FIFO register.
+    this->dmaChannel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(this->dmaChannel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(this->pixelPio, this->pixelSm, true));
+    dma_channel_configure(this->dmaChannel, &c, &this->pixelPio->txf[this->pixelSm],
+                          this->pixelWords, 0, false);
 
     this->actual_number_of_pixels = numberOfPixels; // Store number of LEDs
+    this->latchedAt = get_absolute_time();
 
     // Initialize all pixel colors to off (0,0,0)
     for (uint16_t i = 0; i < this->actual_number_of_pixels; i++) {
-        this->pixelBuffer[i][0] = 0; // Red
-        this->pixelBuffer[i][1] = 0; // Green
-        this->pixelBuffer[i][2] = 0; // Blue
+        this->pixelWords[i] = 0;
     }
 
     this->Show();  // Update LEDs to reflect buffer
-    sleep_ms(1);      // Short delay to stabilize
 }
 
-// Sets the RGB color of a specific LED and updates the strip
+// Sets the RGB color of a specific LED; call Show() to send it.
+// Out-of-range pixel numbers are ignored.
 void NeoPixel::setPixelColor(uint16_t pixelNumber, uint8_t r, uint8_t g, uint8_t b) {
-    this->pixelBuffer[pixelNumber][0] = r;  // Set red value
-    this->pixelBuffer[pixelNumber][1] = g;  // Set green value
-    this->pixelBuffer[pixelNumber][2] = b;  // Set blue value
-    this->Show();                           // Send updated colors to LED strip
+    if (pixelNumber >= this->actual_number_of_pixels) {
+        return;
+    }
+    this->pixelWords[pixelNumber] = encode(r, g, b);
+    this->dirty = true;
 }
 
-// Fills all LEDs with the same RGB color and updates the strip
+// Fills all LEDs with the same RGB color; call Show() to send it
 void NeoPixel::Fill(uint8_t r, uint8_t g, uint8_t b) {
+    uint32_t word = encode(r, g, b);
     for (uint16_t i = 0; i < this->actual_number_of_pixels; i++) {
-        this->pixelBuffer[i][0] = r;  // Set red
-        this->pixelBuffer[i][1] = g;  // Set green
-        this->pixelBuffer[i][2] = b;  // Set blue
+        this->pixelWords[i] = word;
     }
-    this->Show(); // Update all pixels at once
+    this->dirty = true;
 }
 
-// Sends the RGB data of each pixel to the NeoPixel strip
-void NeoPixel::Show(void) {
-    for (uint16_t i = 0; i < this->actual_number_of_pixels; i++) {
-        this->putPixel(                  // Send encoded pixel color
-            urgb_u32(                    // Convert RGB values to 24-bit GRB format
-                pixelBuffer[i][0],       // Red
-                pixelBuffer[i][1],       // Green
-                pixelBuffer[i][2]        // Blue
-            )
-        );
+// Hands the already-encoded pixel words to DMA. Returns immediately; the
+// state machine shifts the frame out in the background. Pixels written
+// while a frame is in flight are picked up by the next Show().
+bool NeoPixel::Show(void) {
+    if (!this->prepareShow()) {
+        return false;                    // Previous frame still going out, keep dirty
     }
+    dma_channel_transfer_from_buffer_now(this->dmaChannel, this->pixelWords,
+                                         this->actual_number_of_pixels);
+    return true;
 }
 
-// Converts individual RGB values into a single 24-bit GRB value
-uint32_t NeoPixel::urgb_u32(uint8_t r, uint8_t g, uint8_t b) {
-    return
-        ((uint32_t)(r) << 8) |          // Red in bits 15-8
-        ((uint32_t)(g) << 16) |         // Green in bits 23-16
-        (uint32_t)(b);                  // Blue in bits 7-0
+// Arms the DMA channel of every eligible strip, then triggers them together
+uint NeoPixel::ShowAll(NeoPixel* const* strips, size_t count) {
+    uint32_t mask = 0;
+    uint started = 0;
+    for (size_t i = 0; i < count; i++) {
+        NeoPixel* strip = strips[i];
+        if (!strip->dirty || !strip->prepareShow()) {
+            continue;
+        }
+        dma_channel_set_read_addr(strip->dmaChannel, strip->pixelWords, false);
+        dma_channel_set_trans_count(strip->dmaChannel, strip->actual_number_of_pixels, false);
+        mask |= 1u << strip->dmaChannel;
+        started++;
+    }
+    if (mask) {
+        dma_start_channel_mask(mask);
+    }
+    return started;
+}
+
+// Clears the dirty flag and computes when the new frame will have latched;
+// false if the strip cannot take a frame yet.
+bool NeoPixel::prepareShow(void) {
+    if (this->isBusy()) {
+        return false;
+    }
+    this->dirty = false;
+    this->latchedAt = make_timeout_time_us(
+        this->actual_number_of_pixels * WS2812_US_PER_PIXEL + WS2812_RESET_US);
+    return true;
 }
 
-// Sends a single pixel's GRB data to the PIO state machine
-void NeoPixel::putPixel(uint32_t pixel_grb) {
-    pio_sm_put_blocking(this->pixelPio, this->pixelSm,
-                        pixel_grb << 8u); // Shift data to match 24-bit WS2812 format
-}
\ No newline at end of file
+// The strip accepts a new frame once DMA is done and the line has been
+// held low for the reset time.
+bool NeoPixel::isBusy(void) const {
+    return dma_channel_is_busy(this->dmaChannel) || !time_reached(this->latchedAt);
+}
@@ -9,26 +9,78 @@
 #include <hardware/pio.h>
 
 
+constexpr uint32_t WS2812_FREQ          = 800000;   // Bit rate of the WS2812 data line
+constexpr uint32_t WS2812_US_PER_PIXEL  = 30;       // 24 bits at 800 kHz
+constexpr uint32_t WS2812_RESET_US      = 300;      // Low time that latches a frame (WS2812B rev. 5 needs 280 us)
+
+
+//-------------------------------------------------------------------------
+//  NeoPixel: one WS2812 strip on its own PIO state machine and DMA channel.
+//  The ws2812 program is loaded once per PIO block and shared by every
+//  strip on it; state machines are claimed from pio0 first, then pio1.
+//-------------------------------------------------------------------------
 class NeoPixel {
 public:
-    NeoPixel(uint8_t pinNumber, uint16_t numberOfPixels);                         // Constructor using default PIO
-    NeoPixel(uint8_t pinNumber, uint16_t numberOfPixels, PIO pio, uint sm);      // Constructor using specific PIO and state machine
-    virtual ~NeoPixel(){};                                                    // Destructor
+    NeoPixel(uint8_t pinNumber, uint32_t* storage, uint16_t numberOfPixels);                    // Constructor claiming any free PIO state machine
+    NeoPixel(uint8_t pinNumber, uint32_t* storage, uint16_t numberOfPixels, PIO pio, uint sm); // Constructor using specific PIO and state machine
+    virtual ~NeoPixel();                                                      // Destructor: releases SM, DMA channel and program
+    NeoPixel(const NeoPixel&) = delete;
+    NeoPixel& operator=(const NeoPixel&) = delete;
 
     void Init(uint8_t pinNumber, uint16_t numberOfPixels);                       // Initialize LED strip
-    void setPixelColor(uint16_t pixel_number, uint8_t r=0, uint8_t g=0, uint8_t b=0); // Set specific LED color
-    void Fill(uint8_t r=0, uint8_t g=0, uint8_t b=0);                          // Fill entire strip with a color
-    void Show(void);                                                          // Push buffer to LEDs
+    void setPixelColor(uint16_t pixel_number, uint8_t r=0, uint8_t g=0, uint8_t b=0); // Set specific LED color (marks buffer dirty)
+    void Fill(uint8_t r=0, uint8_t g=0, uint8_t b=0);                          // Fill entire strip with a color (marks buffer dirty)
+    bool Show(void);                                                          // Start a DMA transfer of the buffer; false if still busy
+    bool isBusy(void) const;                                                  // Transfer or reset latch still in progress
+    bool isDirty(void) const { return dirty; }                                // Buffer changed since the last Show()
+    uint16_t size(void) const { return actual_number_of_pixels; }             // Number of LEDs
+
+    // Starts every strip that is dirty and idle with a single DMA trigger,
+    // so their refresh times overlap instead of adding up. Returns the
+    // number of strips started.
+    static uint ShowAll(NeoPixel* const* strips, size_t count);
+
+    // Encodes a colour as the word the ws2812 program shifts out: GRB in
+    // the top 24 bits, MSB first.
+    static constexpr uint32_t encode(uint8_t r, uint8_t g, uint8_t b) {
+        return ((uint32_t)g << 24) | ((uint32_t)r << 16) | ((uint32_t)b << 8);
+    }
 
 private:
+    bool prepareShow(void);                  // Common bookkeeping before a transfer is triggered
+
     PIO pixelPio;                            // PIO to use
     uint pixelOffset;                       // Offset for the PIO program
     uint pixelSm;                           // PIO state machine
+    uint dmaChannel;                        // DMA channel feeding the state machine TX FIFO
     uint16_t actual_number_of_pixels;       // Number of LEDs
-    uint8_t pixelBuffer[1024][3];           // RGB values for each LED
+    volatile bool dirty;                    // Set by setPixelColor/Fill, cleared by Show
+    absolute_time_t latchedAt;              // When the last frame has been shifted out and latched
+    uint32_t* pixelWords;                   // Caller-owned, pre-encoded wire words, streamed as-is by DMA
+};
+
+//-------------------------------------------------------------------------
+//  NeoPixelStrip: a NeoPixel that owns exactly Capacity pixels of storage.
+//  The storage base is listed first so it exists before NeoPixel::Init
+//  clears it.
+//-------------------------------------------------------------------------
+template <uint16_t Capacity>
+struct NeoPixelStorage {
+    uint32_t storage[Capacity];
+};
+
+template <uint16_t Capacity>
+class NeoPixelStrip : private NeoPixelStorage<Capacity>, public NeoPixel {
+    static_assert(Capacity > 0, "A strip needs at least one pixel");
+
+public:
+    explicit NeoPixelStrip(uint8_t pinNumber, uint16_t numberOfPixels = Capacity)
+        : NeoPixelStorage<Capacity>(),
+          NeoPixel(pinNumber, this->storage, numberOfPixels < Capacity ? numberOfPixels : Capacity) {}
 
-    uint32_t urgb_u32(uint8_t r, uint8_t g, uint8_t b); // Convert RGB to 24-bit GRB format
-    void putPixel(uint32_t pixel_grb);                 // Send GRB pixel to PIO
+    NeoPixelStrip(uint8_t pinNumber, uint16_t numberOfPixels, PIO pio, uint sm)
+        : NeoPixelStorage<Capacity>(),
+          NeoPixel(pinNumber, this->storage, numberOfPixels < Capacity ? numberOfPixels : Capacity, pio, sm) {}
 };
 
-#endif
\ No newline at end of file
+#endif
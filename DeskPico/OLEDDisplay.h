@@ -1,14 +1,16 @@
 //=========================================================================  
 //  OLEDDisplay.h                                                          
 //  Header file for OLEDDisplay class.                                     
-//  Provides initialization and control of SSD1306 OLED displays over I²C. 
+//  Provides initialization and control of SSD1306 OLED displays over any
+//  DisplayTransport (I²C, SPI or a host mock). Panel geometry is a
+//  template parameter so the frame buffer is sized statically and the init
+//  sequence matches the panel at compile time.
 //=========================================================================  
 
 #ifndef OLED_DISPLAY_H
 #define OLED_DISPLAY_H
 
-#include "pico/stdlib.h"                                                     // Raspberry Pi Pico SDK
-#include "hardware/i2c.h"                                                    // I²C interface
+#include "DisplayTransport.h"                                                // Bus backend
 #include "qrcodegen.hpp"
 #include <cstdint>                                                           // Fixed-width integer types
 #include <cstring>                                                           // For memcpy / memset
@@ -16,10 +18,8 @@
 //-------------------------------------------------------------------------
 //  Hardware Configuration                                                  
 //-------------------------------------------------------------------------
-constexpr uint8_t SSD1306_I2C_ADDR      = 0x3C;                              // Default I²C address
-constexpr uint32_t SSD1306_I2C_CLK      = 400 * 1000;                        // I²C clock speed (400 kHz)
-constexpr uint16_t SSD1306_WIDTH        = 128;                               // Display width in pixels
-constexpr uint16_t SSD1306_HEIGHT       = 32;                                // Display height in pixels
+constexpr uint16_t SSD1306_WIDTH        = 128;                               // Default display width in pixels
+constexpr uint16_t SSD1306_HEIGHT       = 32;                                // Default display height in pixels
 
 //-------------------------------------------------------------------------
 //  SSD1306 Command Set (from datasheet)                                    
@@ -47,17 +47,32 @@ constexpr uint8_t SSD1306_SET_COM_PIN_CFG       = 0xDA;
 constexpr uint8_t SSD1306_SET_VCOM_DESEL        = 0xDB;
 
 constexpr uint8_t SSD1306_PAGE_HEIGHT           = 8;
-constexpr uint8_t SSD1306_NUM_PAGES             = SSD1306_HEIGHT / SSD1306_PAGE_HEIGHT;
-constexpr uint16_t SSD1306_BUF_LEN              = SSD1306_NUM_PAGES * SSD1306_WIDTH;
 
 //-------------------------------------------------------------------------
 //  OLEDDisplay class                                                      
 //  Encapsulates all functionality for communicating with SSD1306 OLED.    
+//  Width/Height select the panel; supported geometries are instantiated
+//  at the bottom of OLEDDisplay.cpp.
 //-------------------------------------------------------------------------
+template <uint16_t Width = SSD1306_WIDTH, uint16_t Height = SSD1306_HEIGHT>
 class OLEDDisplay {
+    static_assert(Width > 0 && Width <= 128, "SSD1306 supports at most 128 columns");
+    static_assert(Height >= 16 && Height <= 64, "SSD1306 supports 16 to 64 rows");
+    static_assert(Height % SSD1306_PAGE_HEIGHT == 0, "Height must be a multiple of the page height");
+
 public:
-    OLEDDisplay(i2c_inst_t* i2c, uint8_t addr = SSD1306_I2C_ADDR,
-                uint width = SSD1306_WIDTH, uint height = SSD1306_HEIGHT);   // Constructor
+    static constexpr uint16_t WIDTH     = Width;                             // Display width in pixels
+    static constexpr uint16_t HEIGHT    = Height;                            // Display height in pixels
+    static constexpr uint8_t  NUM_PAGES = Height / SSD1306_PAGE_HEIGHT;      // 8-row pages in GDDRAM
+    static constexpr uint16_t BUF_LEN   = NUM_PAGES * Width;                 // Frame buffer size in bytes
+
+    // COM pin hardware configuration: sequential for panels up to 32 rows,
+    // alternative (interleaved) for taller panels such as 128x64.
+    static constexpr uint8_t COM_PIN_CFG = (Height > 32) ? 0x12 : 0x02;
+
+    explicit OLEDDisplay(DisplayTransport& transport);                       // Constructor
+    OLEDDisplay(const OLEDDisplay&) = delete;                                // _buffer points into _frame
+    OLEDDisplay& operator=(const OLEDDisplay&) = delete;
 
     void init();                                                             // Initialize display
     void clear();                                                            // Clear display buffer
@@ -71,14 +86,14 @@ public:
 private:
     void sendCommand(uint8_t cmd);                                           // Send one command
     void sendCommandList(const uint8_t* cmds, int count);                    // Send command list
-    void sendBuffer(uint8_t* buf, int len);                                  // Send data buffer
     void writeChar(int x, int y, char c);                                    // Write a single character
 
-    i2c_inst_t* _i2c;                                                        // I²C instance (i2c0 / i2c1)
-    uint8_t _addr;                                                           // I²C address
-    uint _width;                                                             // Display width
-    uint _height;                                                            // Display height
-    uint8_t* _buffer;                                                        // Frame buffer pointer
+    DisplayTransport& _transport;                                            // I²C / SPI / mock backend
+    uint8_t _frame[BUF_LEN + 1];                                             // Transport headroom + frame buffer
+    uint8_t* const _buffer = _frame + 1;                                     // Frame buffer (pixel data)
 };
 
+using OLEDDisplay128x32 = OLEDDisplay<128, 32>;
+using OLEDDisplay128x64 = OLEDDisplay<128, 64>;
+
 #endif
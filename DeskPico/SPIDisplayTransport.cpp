@@ -0,0 +1,60 @@
+//=========================================================================
+//  SPIDisplayTransport.cpp
+//  Implementation of the SSD1306 4-wire SPI transport.
+//=========================================================================
+
+#include "SPIDisplayTransport.h"
+
+SPIDisplayTransport::SPIDisplayTransport(spi_inst_t* spi, uint csPin, uint dcPin, uint resetPin)
+    : _spi(spi), _cs(csPin), _dc(dcPin), _reset(resetPin)
+{
+    gpio_init(_cs);
+    gpio_set_dir(_cs, GPIO_OUT);
+    gpio_put(_cs, 1);                                                       // Deselected
+    gpio_init(_dc);
+    gpio_set_dir(_dc, GPIO_OUT);
+    if (_reset != SSD1306_NO_PIN) {
+        gpio_init(_reset);
+        gpio_set_dir(_reset, GPIO_OUT);
+        gpio_put(_reset, 1);
+    }
+}
+
+//-------------------------------------------------------------------------
+//  Sets up an SPI bus shared by one or more displays (mode 0, MSB first)
+//-------------------------------------------------------------------------
+void SPIDisplayTransport::initBus(spi_inst_t* spi, uint sckPin, uint mosiPin, uint baudrate) {
+    spi_init(spi, baudrate);
+    spi_set_format(spi, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_set_function(sckPin, GPIO_FUNC_SPI);
+    gpio_set_function(mosiPin, GPIO_FUNC_SPI);
+}
+
+//-------------------------------------------------------------------------
+//  Pulses RES low; the controller needs >= 3 us, then time to come up
+//-------------------------------------------------------------------------
+void SPIDisplayTransport::reset() {
+    if (_reset == SSD1306_NO_PIN) return;
+    gpio_put(_reset, 0);
+    sleep_us(10);
+    gpio_put(_reset, 1);
+    sleep_us(10);
+}
+
+void SPIDisplayTransport::transfer(bool data, const uint8_t* buf, size_t len) {
+    gpio_put(_dc, data);
+    gpio_put(_cs, 0);
+    spi_write_blocking(_spi, buf, len);
+    gpio_put(_cs, 1);
+}
+
+void SPIDisplayTransport::sendCommands(const uint8_t* cmds, size_t len) {
+    transfer(false, cmds, len);
+}
+
+//-------------------------------------------------------------------------
+//  D/C carries the framing on SPI, so the headroom byte is not needed
+//-------------------------------------------------------------------------
+void SPIDisplayTransport::sendData(uint8_t* data, size_t len) {
+    transfer(true, data, len);
+}
@@ -0,0 +1,41 @@
+//=========================================================================
+//  SPIDisplayTransport.h
+//  SSD1306 transport over 4-wire SPI (D/C pin framing, up to 10 MHz).
+//=========================================================================
+
+#ifndef SPI_DISPLAY_TRANSPORT_H
+#define SPI_DISPLAY_TRANSPORT_H
+
+#include "DisplayTransport.h"
+#include "pico/stdlib.h"                                                     // Raspberry Pi Pico SDK
+#include "hardware/spi.h"                                                    // SPI interface
+
+//-------------------------------------------------------------------------
+//  Hardware Configuration
+//-------------------------------------------------------------------------
+constexpr uint32_t SSD1306_SPI_CLK      = 10 * 1000 * 1000;                  // SPI clock (datasheet max 10 MHz)
+constexpr uint SSD1306_NO_PIN           = 0xFFFFFFFFu;                       // Marks an unconnected RES pin
+
+class SPIDisplayTransport : public DisplayTransport {
+public:
+    SPIDisplayTransport(spi_inst_t* spi, uint csPin, uint dcPin,
+                        uint resetPin = SSD1306_NO_PIN);
+
+    // Sets up an SPI bus once; panels on the same bus differ by CS pin.
+    static void initBus(spi_inst_t* spi, uint sckPin, uint mosiPin,
+                        uint baudrate = SSD1306_SPI_CLK);
+
+    void reset() override;
+    void sendCommands(const uint8_t* cmds, size_t len) override;
+    void sendData(uint8_t* data, size_t len) override;
+
+private:
+    void transfer(bool data, const uint8_t* buf, size_t len);                // D/C select + CS framing
+
+    spi_inst_t* _spi;                                                        // SPI instance (spi0 / spi1)
+    uint _cs;                                                                // Chip select (active low)
+    uint _dc;                                                                // Data/command select
+    uint _reset;                                                             // Reset (active low), optional
+};
+
+#endif
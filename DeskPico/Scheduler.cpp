@@ -0,0 +1,74 @@
+//=========================================================================
+//  Scheduler.cpp
+//  Implementation of the cooperative task scheduler.
+//=========================================================================
+
+#include "Scheduler.h"
+
+Scheduler::Scheduler(IdleHook idle)
+    : idle(idle)
+{
+}
+
+bool Scheduler::add(Task& task) {
+    if (count >= MAX_TASKS) {
+        return false;
+    }
+    tasks[count++] = &task;
+    return true;
+}
+
+bool Scheduler::runOnce() {
+    uint32_t start = time_us_32();
+    bool ready = false;
+    for (size_t i = 0; i < count; i++) {
+        Task* task = tasks[i];
+        if (task->_state == TaskState::Done) {
+            continue;
+        }
+        task->_state = task->run();
+        ready |= task->_state == TaskState::Ready;
+    }
+    uint32_t elapsed = time_us_32() - start;
+    uint32_t longest = longestPassUs.load(std::memory_order_relaxed);
+    while (elapsed > longest &&
+           !longestPassUs.compare_exchange_weak(longest, elapsed, std::memory_order_relaxed)) {
+    }
+    return ready;
+}
+
+absolute_time_t Scheduler::nextWake() const {
+    absolute_time_t wake = make_timeout_time_ms(MAX_IDLE_MS);
+    for (size_t i = 0; i < count; i++) {
+        const Task* task = tasks[i];
+        if (task->_state == TaskState::Waiting && absolute_time_diff_us(task->_wakeAt, wake) > 0) {
+            wake = task->_wakeAt;
+        }
+    }
+    return wake;
+}
+
+//-------------------------------------------------------------------------
+//  Runs passes back to back while a task is ready, otherwise idles until
+//  the earliest deadline. Events that should cut the idle short must wake
+//  the idle hook (see MyApp::notify).
+//-------------------------------------------------------------------------
+void Scheduler::run() {
+    while (active() > 0) {
+        if (!runOnce() && idle != nullptr) {
+            idle(nextWake());
+        }
+    }
+}
+
+size_t Scheduler::active() const {
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        n += tasks[i]->_state != TaskState::Done;
+    }
+    return n;
+}
+
+uint32_t Scheduler::takeLongestPassUs() {
+    return longestPassUs.exchange(0, std::memory_order_relaxed);
+}
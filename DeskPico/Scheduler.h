@@ -0,0 +1,104 @@
+//=========================================================================
+//  Scheduler.h
+//  Cooperative, stackless task runtime for the main loop (protothreads).
+//
+//  A task is a class whose run() body is written between TASK_BEGIN()
+//  and TASK_END() and suspends with TASK_AWAIT / TASK_SLEEP_MS /
+//  TASK_YIELD. Each suspension point returns to the scheduler; the next
+//  pass resumes right after it. Locals do not survive a suspension, so
+//  keep state in members.
+//
+//  When every task is waiting the scheduler hands the earliest deadline to
+//  an idle hook (cyw43_arch_wait_for_work_until on the Pico W), which sleeps
+//  the core until network work, a notified event or the deadline.
+//=========================================================================
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "pico/stdlib.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum class TaskState : uint8_t {
+    Ready,                                   // Wants another pass straight away
+    Waiting,                                 // Blocked on a condition or deadline
+    Done,                                    // Returned from TASK_END()
+};
+
+class Task {
+public:
+    explicit Task(const char* name) : _name(name) {}
+    virtual ~Task() = default;
+
+    const char* name() const { return _name; }
+    TaskState state() const { return _state; }
+    absolute_time_t wakeAt() const { return _wakeAt; }                       // Deadline while sleeping
+
+protected:
+    virtual TaskState run() = 0;                                             // Protothread body
+
+    uint16_t _resume = 0;                                                    // Line to resume at, 0 = start
+    absolute_time_t _wakeAt = at_the_end_of_time;
+
+private:
+    friend class Scheduler;
+    const char* _name;
+    TaskState _state = TaskState::Ready;
+};
+
+//-------------------------------------------------------------------------
+//  Protothread macros, only valid inside Task::run()
+//-------------------------------------------------------------------------
+#define TASK_BEGIN()        switch (_resume) { case 0:
+#define TASK_END()          } _resume = 0; return TaskState::Done
+
+// Give the other tasks a pass, then continue
+#define TASK_YIELD()                                                        \
+    do { _resume = __LINE__; return TaskState::Ready; case __LINE__:; } while (0)
+
+// Suspend until cond holds; it is re-checked on every scheduler pass
+#define TASK_AWAIT(cond)                                                    \
+    do { _resume = __LINE__; case __LINE__:                                 \
+         if (!(cond)) return TaskState::Waiting; } while (0)
+
+// Suspend until cond holds or ms have passed, whichever comes first
+#define TASK_AWAIT_FOR(cond, ms)                                            \
+    do { _wakeAt = make_timeout_time_ms(ms); _resume = __LINE__; case __LINE__: \
+         if (!(cond) && !time_reached(_wakeAt)) return TaskState::Waiting;  \
+         _wakeAt = at_the_end_of_time; } while (0)
+
+#define TASK_SLEEP_MS(ms)   TASK_AWAIT_FOR(false, ms)
+
+class Scheduler {
+public:
+    static constexpr size_t MAX_TASKS = 8;
+    static constexpr uint32_t MAX_IDLE_MS = 1000;                            // Re-check conditions at least this often
+
+    using IdleHook = void (*)(absolute_time_t until);
+
+    explicit Scheduler(IdleHook idle);
+
+    bool add(Task& task);                                                    // False when MAX_TASKS are registered
+
+    // One pass over every live task in registration order. True if a task
+    // asked to run again at once; otherwise nextWake() says when to come back.
+    bool runOnce();
+    absolute_time_t nextWake() const;
+
+    void run();                                                              // Loop until every task is done
+    size_t active() const;
+
+    // Longest single pass since the last call, in us: how long the loop
+    // was unable to react. Safe to call from the other core.
+    uint32_t takeLongestPassUs();
+
+private:
+    IdleHook idle;
+    Task* tasks[MAX_TASKS] = {};
+    size_t count = 0;
+    std::atomic<uint32_t> longestPassUs{0};                                  // Taken from the other core
+};
+
+#endif
@@ -0,0 +1,88 @@
+//=========================================================================
+//  Telemetry.cpp
+//  Implementation of the telemetry sample ring and its batch encoding.
+//=========================================================================
+
+#include "Telemetry.h"
+#include "Cbor.h"
+#include "DeskMessages.h"
+
+static_assert((Telemetry::CAPACITY & (Telemetry::CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+Telemetry::Telemetry() {
+    critical_section_init(&lock);
+}
+
+void Telemetry::record(TelemetryKind kind, int32_t value) {
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    critical_section_enter_blocking(&lock);
+    if (tail - head == CAPACITY) {
+        head++;                                                              // Newest wins
+        _dropped++;
+    }
+    samples[tail % CAPACITY] = { now, value, kind };
+    tail++;
+    critical_section_exit(&lock);
+}
+
+size_t Telemetry::pending() const {
+    critical_section_enter_blocking(&lock);
+    size_t n = tail - head;
+    critical_section_exit(&lock);
+    return n;
+}
+
+size_t Telemetry::encode(uint8_t* out, size_t size, uint32_t seq, uint32_t& end) const {
+    critical_section_enter_blocking(&lock);
+    uint32_t first = head;
+    uint32_t last = tail;
+    uint32_t dropped = _dropped;
+    critical_section_exit(&lock);
+
+    CborWriter writer(out, size);
+    writer.map(3);
+    writer.unsignedInt(TELEMETRY_SEQ);
+    writer.unsignedInt(seq);
+    writer.unsignedInt(TELEMETRY_DROPPED);
+    writer.unsignedInt(dropped);
+    writer.unsignedInt(TELEMETRY_SAMPLES);
+    writer.beginArray();
+
+    size_t written = 0;
+    uint32_t i = first;
+    for (; i != last; i++) {
+        TelemetrySample sample;
+        critical_section_enter_blocking(&lock);
+        bool overwritten = (int32_t)(i - head) < 0;
+        sample = samples[i % CAPACITY];
+        critical_section_exit(&lock);
+        if (overwritten) {
+            continue;                                                        // Lost while encoding; consume() skips it too
+        }
+
+        size_t mark = writer.mark();
+        writer.array(3);
+        writer.unsignedInt((uint8_t)sample.kind);
+        writer.unsignedInt(sample.atMs);
+        writer.integer(sample.value);
+        if (!writer.ok() || writer.size() >= size) {                         // Keep a byte for the break
+            writer.rewind(mark);
+            break;                                                           // The rest goes in the next batch
+        }
+        written++;
+    }
+    writer.end();
+    if (written == 0 || !writer.ok()) {
+        return 0;                                                            // Not even one sample fits
+    }
+    end = i;
+    return writer.size();
+}
+
+void Telemetry::consume(uint32_t end) {
+    critical_section_enter_blocking(&lock);
+    if ((int32_t)(end - head) > 0) {                                         // May already be overwritten past end
+        head = end;
+    }
+    critical_section_exit(&lock);
+}
@@ -0,0 +1,60 @@
+//=========================================================================
+//  Telemetry.h
+//  Ring of typed samples (button presses, uptime, RSSI, loop latency,
+//  free heap) that the network side publishes in batches. Recording is
+//  cheap and never blocks on the network: when the ring is full the
+//  oldest sample gives way. Batches are taken in two steps, encode() then
+//  consume(), so a publish that lwIP refuses leaves the samples in place
+//  for the next try.
+//=========================================================================
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+#include <cstddef>
+#include <cstdint>
+
+enum class TelemetryKind : uint8_t {        // Sent as numbers: never renumber
+    Button = 0,                              // Press at the desk, value 1
+    Uptime = 1,                              // Seconds since boot
+    Rssi = 2,                                // dBm
+    LoopLatency = 3,                         // Longest scheduler pass, us
+    HeapFree = 4,                            // Bytes
+};
+
+struct TelemetrySample {
+    uint32_t atMs;                           // Since boot
+    int32_t value;
+    TelemetryKind kind;
+};
+
+class Telemetry {
+public:
+    static constexpr size_t CAPACITY = 32;                                   // Samples, power of two
+
+    Telemetry();
+
+    // Any core, also from interrupts
+    void record(TelemetryKind kind, int32_t value);
+
+    // Writes the oldest pending samples as one CBOR batch into out, as many
+    // as fit (schema in DeskMessages.h). Returns the length (0 when nothing
+    // is pending or out is too small) and in end the position to hand to
+    // consume() once it is sent.
+    size_t encode(uint8_t* out, size_t size, uint32_t seq, uint32_t& end) const;
+    void consume(uint32_t end);
+
+    size_t pending() const;
+    uint32_t dropped() const { return _dropped; }                            // Overwritten before they were sent
+
+private:
+    mutable critical_section_t lock;
+    TelemetrySample samples[CAPACITY];
+    uint32_t head = 0;                                                       // Oldest pending
+    uint32_t tail = 0;                                                       // Next to write
+    uint32_t _dropped = 0;
+};
+
+#endif
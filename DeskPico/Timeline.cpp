@@ -0,0 +1,76 @@
+//=========================================================================
+//  Timeline.cpp
+//  Implementation of the alarm-driven action timeline.
+//=========================================================================
+
+#include "Timeline.h"
+
+Timeline::Timeline(alarm_pool_t* pool)
+    : pool(pool ? pool : alarm_pool_get_default())
+{
+}
+
+bool Timeline::start(const TimelineStep* newSteps, size_t newCount, void* newContext) {
+    if (newCount > MAX_STEPS) {
+        return false;
+    }
+    cancel();
+    for (size_t i = 0; i < newCount; i++) {
+        steps[i] = newSteps[i];
+    }
+    context = newContext;
+    origin = get_absolute_time();
+    next = 0;
+    count = newCount;
+    poll();                                                                 // Steps at 0 ms run right away
+    return true;
+}
+
+void Timeline::cancel() {
+    if (alarm > 0) {
+        alarm_pool_cancel_alarm(pool, alarm);
+        alarm = 0;
+    }
+    count = next = 0;
+    due = false;
+    generation++;
+}
+
+//-------------------------------------------------------------------------
+//  Main-loop context: run every step whose time has come, then re-arm.
+//  An action may start another timeline; that stops this pass.
+//-------------------------------------------------------------------------
+void Timeline::poll() {
+    if (next >= count) {
+        return;
+    }
+    due = false;
+    uint32_t startedAs = generation;
+    while (next < count && time_reached(delayed_by_ms(origin, steps[next].at_ms))) {
+        TimelineAction action = steps[next++].action;
+        action(context);
+        if (generation != startedAs) {
+            return;                                                         // Replaced by the action
+        }
+    }
+    if (alarm == 0) {
+        arm();
+    }
+}
+
+void Timeline::arm() {
+    if (next >= count) {
+        return;
+    }
+    alarm = alarm_pool_add_alarm_at(pool, delayed_by_ms(origin, steps[next].at_ms), onAlarm, this, true);
+}
+
+int64_t Timeline::onAlarm(alarm_id_t id, void* user_data) {
+    Timeline* self = static_cast<Timeline*>(user_data);
+    self->alarm = 0;
+    self->due = true;
+    if (self->notify) {
+        self->notify(self->notifyArg);
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+//=========================================================================
+//  Timeline.h
+//  Runs a short list of timed actions (LED on, text, tone, LED off, ...)
+//  without blocking. An alarm from the pico alarm pool marks each step
+//  due; poll() then runs it from the main loop, where blocking work such
+//  as an I²C display flush is safe.
+//=========================================================================
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "pico/stdlib.h"
+#include <cstddef>
+#include <cstdint>
+
+using TimelineAction = void (*)(void* context);
+
+struct TimelineStep {
+    uint32_t at_ms;                         // Offset from start(), ascending
+    TimelineAction action;
+};
+
+class Timeline {
+public:
+    static constexpr size_t MAX_STEPS = 8;
+
+    explicit Timeline(alarm_pool_t* pool = nullptr);                         // nullptr = default alarm pool
+
+    // Replaces whatever is running. Steps are copied; context is passed to
+    // every action. False if there are more than MAX_STEPS steps.
+    bool start(const TimelineStep* steps, size_t count, void* context);
+    void cancel();
+    void poll();                                                             // Run the steps that are due
+    bool isRunning() const { return next < count; }
+    bool isDue() const { return due; }                                       // A step is waiting for poll()
+
+    // Called from the alarm when a step falls due (wakes the main loop)
+    void setNotify(void (*handler)(void* arg), void* arg) { notifyArg = arg; notify = handler; }
+
+private:
+    static int64_t onAlarm(alarm_id_t id, void* user_data);
+    void arm();                                                              // Alarm for the next pending step
+
+    alarm_pool_t* pool;
+    TimelineStep steps[MAX_STEPS];
+    size_t count = 0;
+    size_t next = 0;
+    void* context = nullptr;
+    absolute_time_t origin;
+    uint32_t generation = 0;                                                 // Bumped by start()/cancel()
+    volatile alarm_id_t alarm = 0;                                           // Pending alarm, 0 when none
+    volatile bool due = false;
+    void (*volatile notify)(void* arg) = nullptr;
+    void* notifyArg = nullptr;
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * HostHal.h
+ * Host side of the pico SDK stand-in (host/include). The firmware sources
+ * compile unchanged against those headers; this file is what host tools and
+ * tests use to drive inputs, observe outputs and run the clock.
+ *
+ * Everything runs on one thread. Alarms, repeating timers and GPIO edge
+ * interrupts fire synchronously from the "poll points": sleeps, WFE,
+ * cyw43_arch_poll() and cyw43_arch_wait_for_work_until().
+ */
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include "pico/types.h"
+#include "pico/time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------------
+ *  Clock and alarms (HostTime.cpp)
+ *-------------------------------------------------------------------------*/
+
+/* Fires every alarm that is due; true if any fired */
+bool host_run_alarms(void);
+
+/* Time of the earliest pending alarm, at_the_end_of_time if none */
+absolute_time_t host_next_alarm(void);
+
+/* Sleeps until target, firing alarms on the way */
+void host_wait_until(absolute_time_t target);
+
+/* Virtual clock: time stands still while the firmware runs and jumps to
+ * the next alarm or deadline whenever it sleeps or idles, so a run is
+ * repeatable and takes no wall time. Select it before anything reads the
+ * clock. host_time_advance_to() never moves time backwards. */
+void host_time_set_virtual(bool enabled);
+bool host_time_is_virtual(void);
+void host_time_advance_to(absolute_time_t target);
+
+/* Seeds get_rand_32()/get_rand_64(); the default seed is fixed */
+void host_rand_seed(uint64_t seed);
+
+/* Event register: set by __sev() and by anything that runs "in interrupt
+ * context" (alarms, GPIO edges); cleared by WFE like on the chip. */
+void host_signal_event(void);
+bool host_event_pending(void);
+bool host_take_event(void);
+
+/*---------------------------------------------------------------------------
+ *  Peripherals (HostHardware.cpp)
+ *-------------------------------------------------------------------------*/
+
+/* Drives an input pin; raises the enabled edge interrupts like the pad would */
+void host_gpio_drive(uint gpio, bool level);
+
+/* Observers; pass NULL to remove. Each gets the data the firmware wrote. */
+typedef void (*host_gpio_hook_t)(uint gpio, bool level);
+typedef void (*host_i2c_hook_t)(uint bus, uint8_t addr, const uint8_t *src, size_t len);
+typedef void (*host_spi_hook_t)(uint bus, const uint8_t *src, size_t len);
+typedef void (*host_pio_hook_t)(uint pio, uint sm, uint32_t word);
+typedef void (*host_pwm_hook_t)(uint slice, bool enabled, uint32_t frequency_hz, uint16_t level, uint16_t wrap);
+
+void host_set_gpio_hook(host_gpio_hook_t hook);
+void host_set_i2c_hook(host_i2c_hook_t hook);
+void host_set_spi_hook(host_spi_hook_t hook);
+void host_set_pio_hook(host_pio_hook_t hook);
+void host_set_pwm_hook(host_pwm_hook_t hook);
+
+/* Flash (hardware/flash.h) starts erased. host_flash_reset() erases it all
+ * again and zeroes the count of sectors erased since. */
+void host_flash_reset(void);
+uint32_t host_flash_erases(void);
+
+/*---------------------------------------------------------------------------
+ *  Network (HostNetwork.cpp, HostMqtt.cpp)
+ *-------------------------------------------------------------------------*/
+
+/* Station MAC reported by cyw43; defaults to f1:50:c2:b8:bf:22 or $DESKPICO_MAC */
+void host_set_mac(const uint8_t mac[6]);
+
+/* Access point in range. Taking it away drops the link at once
+ * (CYW43_LINK_DOWN); joins fail with CYW43_LINK_NONET until it is back. */
+void host_wifi_set_available(bool available);
+
+/* Loopback broker up or down. While down, sessions are dropped at the next
+ * poll (MQTT_CONNECT_DISCONNECTED) and new connections are refused. A
+ * session that ends any other way without a DISCONNECT (the WiFi link
+ * going away included) gets its will published. */
+void host_mqtt_set_broker_up(bool up);
+
+/* Services every MQTT client socket without blocking */
+void host_mqtt_service(void);
+
+/* Waits up to timeout_us for MQTT socket activity; true if there is some */
+bool host_mqtt_wait(int64_t timeout_us);
+
+/* Loopback: clients that connect from now on talk to an in-process broker
+ * instead of a socket. It accepts every session and subscription (+ and #
+ * filters, QoS 0 or 1 granted), hands publishes to the publish hook and
+ * delivers what host_mqtt_deliver() injects, as a QoS 0 publish, to
+ * matching clients. Returns how many clients it was delivered to.
+ * host_mqtt_deliver_qos() sends at the lower of qos and the granted QoS,
+ * with packet_id (0: the broker picks one) and the DUP flag of a
+ * redelivery, so duplicates can be staged. */
+typedef void (*host_mqtt_publish_hook_t)(const char *topic, const uint8_t *payload, size_t len, uint8_t qos, bool retain);
+
+void host_mqtt_set_loopback(bool enabled);
+void host_mqtt_set_publish_hook(host_mqtt_publish_hook_t hook);
+int host_mqtt_deliver(const char *topic, const void *payload, size_t len);
+int host_mqtt_deliver_qos(const char *topic, const void *payload, size_t len, uint8_t qos, uint16_t packet_id,
+                          bool dup);
+
+/* The loopback broker's retained message for topic (empty payload clears
+ * it): sent after the SUBACK of every later matching subscription and, at
+ * QoS 1, to current subscribers at once. Kept sessions (clean session 0)
+ * get back their subscriptions and the QoS 1 messages they missed when
+ * they reconnect. host_mqtt_reset_broker() forgets both. */
+int host_mqtt_retain(const char *topic, const void *payload, size_t len);
+size_t host_mqtt_retained(const char *topic, void *out, size_t size);  /* Copied length, 0 if none */
+void host_mqtt_reset_broker(void);
+
+/* TLS against the loopback broker (MqttClient.c built with MQTT_TLS): it
+ * resumes any session it issued and does a full handshake otherwise.
+ * host_tls_expire_sessions() forgets them all, like a broker restart or an
+ * expired ticket key; host_tls_full_handshakes() counts the full ones.
+ * host_mqtt_reset_broker() does both and zeroes the count. */
+void host_tls_expire_sessions(void);
+uint32_t host_tls_full_handshakes(void);
+
+/* Called at each network poll point (cyw43_arch_poll() and
+ * cyw43_arch_wait_for_work_until()) before anything else happens there */
+typedef void (*host_poll_hook_t)(void);
+void host_set_poll_hook(host_poll_hook_t hook);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,565 @@
+//=========================================================================
+//  HostHardware.cpp
+//  Host models of GPIO, I2C, SPI, PIO, DMA, PWM and flash.
+//  Nothing is timed: transfers complete at once and are handed to the
+//  observer hooks from HostHal.h, which is where tools look at the output.
+//=========================================================================
+
+#include "HostHal.h"
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/pwm.h"
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+i2c_inst_t i2c0_inst = { 0, 0 };
+i2c_inst_t i2c1_inst = { 1, 0 };
+spi_inst_t spi0_inst = { 0, 0 };
+spi_inst_t spi1_inst = { 1, 0 };
+pio_hw_t pio0_hw_inst;
+pio_hw_t pio1_hw_inst;
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+namespace {
+
+struct Pin {
+    bool out = false;
+    bool level = false;
+    uint32_t irqEnabled = 0;
+    uint32_t irqPending = 0;
+};
+
+struct RawHandler {
+    uint32_t mask;
+    irq_handler_t handler;
+};
+
+struct PioBlock {
+    uint32_t usedInstructions = 0;                                           // One bit per instruction slot
+    uint8_t claimedSms = 0;
+    bool enabled[NUM_PIO_STATE_MACHINES] = {};
+};
+
+struct DmaChannel {
+    bool claimed = false;
+    bool readIncrement = true;
+    bool writeIncrement = false;
+    uint32_t size = DMA_SIZE_32;
+    volatile void* write = nullptr;
+    const volatile void* read = nullptr;
+    uint32_t count = 0;
+};
+
+struct PwmSlice {
+    bool enabled = false;
+    float divider = 1.0f;
+    uint16_t wrap = 0xffff;
+    uint16_t level[2] = {};
+};
+
+Pin pins[NUM_BANK0_GPIOS];
+RawHandler rawHandlers[8];
+size_t rawHandlerCount = 0;
+PioBlock pioBlocks[NUM_PIOS];
+DmaChannel dmaChannels[NUM_DMA_CHANNELS];
+PwmSlice pwmSlices[NUM_PWM_SLICES];
+
+host_gpio_hook_t gpioHook = nullptr;
+host_i2c_hook_t i2cHook = nullptr;
+host_spi_hook_t spiHook = nullptr;
+host_pio_hook_t pioHook = nullptr;
+host_pwm_hook_t pwmHook = nullptr;
+uint32_t flashErases = 0;
+const bool flashErased = (host_flash_reset(), true);                         // A new chip
+
+} // namespace
+
+void host_set_gpio_hook(host_gpio_hook_t hook) { gpioHook = hook; }
+void host_set_i2c_hook(host_i2c_hook_t hook) { i2cHook = hook; }
+void host_set_spi_hook(host_spi_hook_t hook) { spiHook = hook; }
+void host_set_pio_hook(host_pio_hook_t hook) { pioHook = hook; }
+void host_set_pwm_hook(host_pwm_hook_t hook) { pwmHook = hook; }
+
+bool stdio_init_all(void) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    return true;
+}
+
+void panic(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fputs("*** PANIC ***\n", stderr);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    abort();
+}
+
+//-------------------------------------------------------------------------
+//  GPIO
+//-------------------------------------------------------------------------
+void gpio_init(uint gpio) {
+    pins[gpio] = Pin{};
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    pins[gpio].out = out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    if (pins[gpio].level == value && pins[gpio].out) {
+        return;
+    }
+    pins[gpio].level = value;
+    if (gpioHook) {
+        gpioHook(gpio, value);
+    }
+}
+
+bool gpio_get(uint gpio) {
+    return pins[gpio].level;
+}
+
+void gpio_pull_up(uint gpio) {
+    if (!pins[gpio].out) {
+        pins[gpio].level = true;
+    }
+}
+
+void gpio_pull_down(uint gpio) {
+    if (!pins[gpio].out) {
+        pins[gpio].level = false;
+    }
+}
+
+void gpio_disable_pulls(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    if (enabled) {
+        pins[gpio].irqEnabled |= event_mask;
+    } else {
+        pins[gpio].irqEnabled &= ~event_mask;
+    }
+}
+
+// Like the SDK, a pin may belong to one raw handler only
+void gpio_add_raw_irq_handler_masked(uint32_t gpio_mask, irq_handler_t handler) {
+    for (size_t i = 0; i < rawHandlerCount; i++) {
+        if (rawHandlers[i].mask & gpio_mask) {
+            panic("host: GPIO mask 0x%08x already has a raw IRQ handler", rawHandlers[i].mask & gpio_mask);
+        }
+    }
+    if (rawHandlerCount == sizeof(rawHandlers) / sizeof(rawHandlers[0])) {
+        panic("host: too many raw GPIO IRQ handlers");
+    }
+    rawHandlers[rawHandlerCount++] = { gpio_mask, handler };
+}
+
+void gpio_remove_raw_irq_handler_masked(uint32_t gpio_mask, irq_handler_t handler) {
+    for (size_t i = 0; i < rawHandlerCount; i++) {
+        if (rawHandlers[i].mask == gpio_mask && rawHandlers[i].handler == handler) {
+            rawHandlers[i] = rawHandlers[--rawHandlerCount];
+            return;
+        }
+    }
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+    return pins[gpio].irqPending & pins[gpio].irqEnabled;
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask) {
+    pins[gpio].irqPending &= ~event_mask;
+}
+
+void host_gpio_drive(uint gpio, bool level) {
+    Pin& pin = pins[gpio];
+    if (pin.level == level) {
+        return;
+    }
+    pin.level = level;
+    pin.irqPending |= level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if (!(pin.irqPending & pin.irqEnabled)) {
+        return;
+    }
+    for (size_t i = 0; i < rawHandlerCount; i++) {
+        if (rawHandlers[i].mask & (1u << gpio)) {
+            rawHandlers[i].handler();
+        }
+    }
+    host_signal_event();
+}
+
+//-------------------------------------------------------------------------
+//  I2C / SPI
+//-------------------------------------------------------------------------
+uint i2c_init(i2c_inst_t* i2c, uint baudrate) {
+    i2c->baudrate = baudrate;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop) {
+    (void)nostop;
+    if (i2cHook) {
+        i2cHook(i2c->index, addr, src, len);
+    }
+    return (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t* i2c, uint8_t addr, uint8_t* dst, size_t len, bool nostop) {
+    (void)i2c;
+    (void)addr;
+    (void)nostop;
+    memset(dst, 0, len);
+    return (int)len;
+}
+
+uint spi_init(spi_inst_t* spi, uint baudrate) {
+    spi->baudrate = baudrate;
+    return baudrate;
+}
+
+void spi_set_format(spi_inst_t* spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {
+    (void)spi;
+    (void)data_bits;
+    (void)cpol;
+    (void)cpha;
+    (void)order;
+}
+
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len) {
+    if (spiHook) {
+        spiHook(spi->index, src, len);
+    }
+    return (int)len;
+}
+
+//-------------------------------------------------------------------------
+//  PIO: instruction memory and state-machine bookkeeping, TX words out
+//-------------------------------------------------------------------------
+static int findProgramSlot(const PioBlock& block, const pio_program_t* program) {
+    uint32_t mask = (1u << program->length) - 1;
+    int first = program->origin >= 0 ? program->origin : PIO_INSTRUCTION_COUNT - program->length;
+    int last = program->origin >= 0 ? program->origin : 0;
+    for (int offset = first; offset >= last; offset--) {
+        if (!(block.usedInstructions & (mask << offset))) {
+            return offset;
+        }
+    }
+    return -1;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t* program) {
+    return findProgramSlot(pioBlocks[pio_get_index(pio)], program) >= 0;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t* program) {
+    PioBlock& block = pioBlocks[pio_get_index(pio)];
+    int offset = findProgramSlot(block, program);
+    if (offset < 0) {
+        panic("host: no program space");
+    }
+    block.usedInstructions |= ((1u << program->length) - 1) << offset;
+    return (uint)offset;
+}
+
+void pio_remove_program(PIO pio, const pio_program_t* program, uint loaded_offset) {
+    pioBlocks[pio_get_index(pio)].usedInstructions &= ~(((1u << program->length) - 1) << loaded_offset);
+}
+
+void pio_sm_claim(PIO pio, uint sm) {
+    PioBlock& block = pioBlocks[pio_get_index(pio)];
+    if (block.claimedSms & (1u << sm)) {
+        panic("host: PIO %u SM %u already claimed", pio_get_index(pio), sm);
+    }
+    block.claimedSms |= 1u << sm;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    PioBlock& block = pioBlocks[pio_get_index(pio)];
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!(block.claimedSms & (1u << sm))) {
+            block.claimedSms |= 1u << sm;
+            return (int)sm;
+        }
+    }
+    if (required) {
+        panic("host: no PIO state machines available");
+    }
+    return -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm) {
+    pioBlocks[pio_get_index(pio)].claimedSms &= ~(1u << sm);
+}
+
+bool pio_sm_is_claimed(PIO pio, uint sm) {
+    return pioBlocks[pio_get_index(pio)].claimedSms & (1u << sm);
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    gpio_set_function(pin, pio_get_index(pio) ? GPIO_FUNC_PIO1 : GPIO_FUNC_PIO0);
+}
+
+int pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pins_base, uint pin_count, bool is_out) {
+    (void)pio;
+    (void)sm;
+    for (uint i = 0; i < pin_count; i++) {
+        gpio_set_dir(pins_base + i, is_out);
+    }
+    return 0;
+}
+
+int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config) {
+    (void)initial_pc;
+    (void)config;
+    pioBlocks[pio_get_index(pio)].enabled[sm] = false;
+    return 0;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    pioBlocks[pio_get_index(pio)].enabled[sm] = enabled;
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+    pio->txf[sm] = data;
+    if (pioHook) {
+        pioHook(pio_get_index(pio), sm, data);
+    }
+}
+
+//-------------------------------------------------------------------------
+//  DMA: synchronous copies; a PIO TX FIFO as destination feeds the PIO hook
+//-------------------------------------------------------------------------
+static bool pioTxTarget(volatile void* addr, uint& pio, uint& sm) {
+    for (pio = 0; pio < NUM_PIOS; pio++) {
+        volatile uint32_t* txf = pio_get_instance(pio)->txf;
+        if (addr >= (volatile void*)txf && addr < (volatile void*)(txf + NUM_PIO_STATE_MACHINES)) {
+            sm = (uint)((volatile uint32_t*)addr - txf);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void runTransfer(DmaChannel& ch) {
+    size_t width = 1u << ch.size;
+    const volatile uint8_t* src = static_cast<const volatile uint8_t*>(ch.read);
+    volatile uint8_t* dst = static_cast<volatile uint8_t*>(ch.write);
+    uint pio, sm;
+    bool toPio = pioTxTarget(ch.write, pio, sm);
+
+    for (uint32_t i = 0; i < ch.count; i++) {
+        uint32_t word = 0;
+        memcpy(&word, const_cast<const uint8_t*>(src), width);
+        if (toPio) {
+            pio_sm_put_blocking(pio_get_instance(pio), sm, word);
+        } else {
+            memcpy(const_cast<uint8_t*>(dst), &word, width);
+        }
+        if (ch.readIncrement) src += width;
+        if (ch.writeIncrement) dst += width;
+    }
+    ch.read = src;
+    ch.write = dst;
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (uint i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (!dmaChannels[i].claimed) {
+            dmaChannels[i].claimed = true;
+            return (int)i;
+        }
+    }
+    if (required) {
+        panic("host: no DMA channels available");
+    }
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+    dmaChannels[channel] = DmaChannel{};
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config c = { 0 };
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    return c;
+}
+
+// ctrl bits: [1:0] size, [2] read increment, [3] write increment
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size) {
+    c->ctrl = (c->ctrl & ~3u) | (uint32_t)size;
+}
+
+void channel_config_set_read_increment(dma_channel_config* c, bool incr) {
+    c->ctrl = incr ? (c->ctrl | 4u) : (c->ctrl & ~4u);
+}
+
+void channel_config_set_write_increment(dma_channel_config* c, bool incr) {
+    c->ctrl = incr ? (c->ctrl | 8u) : (c->ctrl & ~8u);
+}
+
+void channel_config_set_dreq(dma_channel_config* c, uint dreq) {
+    (void)c;
+    (void)dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger) {
+    DmaChannel& ch = dmaChannels[channel];
+    ch.size = config->ctrl & 3u;
+    ch.readIncrement = config->ctrl & 4u;
+    ch.writeIncrement = config->ctrl & 8u;
+    ch.write = write_addr;
+    ch.read = read_addr;
+    ch.count = transfer_count;
+    if (trigger) {
+        runTransfer(ch);
+    }
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger) {
+    dmaChannels[channel].read = read_addr;
+    if (trigger) {
+        runTransfer(dmaChannels[channel]);
+    }
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    dmaChannels[channel].count = trans_count;
+    if (trigger) {
+        runTransfer(dmaChannels[channel]);
+    }
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void* read_addr, uint32_t transfer_count) {
+    dmaChannels[channel].read = read_addr;
+    dmaChannels[channel].count = transfer_count;
+    runTransfer(dmaChannels[channel]);
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+    for (uint i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (chan_mask & (1u << i)) {
+            runTransfer(dmaChannels[i]);
+        }
+    }
+}
+
+bool dma_channel_is_busy(uint channel) {
+    (void)channel;
+    return false;
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+    (void)channel;
+}
+
+void dma_channel_abort(uint channel) {
+    (void)channel;
+}
+
+//-------------------------------------------------------------------------
+//  PWM: report the resulting tone whenever a slice setting changes
+//-------------------------------------------------------------------------
+static void reportPwm(uint slice_num) {
+    if (!pwmHook) {
+        return;
+    }
+    const PwmSlice& s = pwmSlices[slice_num];
+    uint32_t hz = (uint32_t)(clock_get_hz(clk_sys) / (s.divider * ((uint32_t)s.wrap + 1)));
+    pwmHook(slice_num, s.enabled, hz, s.level[0] ? s.level[0] : s.level[1], s.wrap);
+}
+
+void pwm_set_clkdiv(uint slice_num, float divider) {
+    pwmSlices[slice_num].divider = divider;
+}
+
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract) {
+    pwmSlices[slice_num].divider = integer + fract / 16.0f;
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap) {
+    pwmSlices[slice_num].wrap = wrap;
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level) {
+    pwmSlices[slice_num].level[chan] = level;
+    if (pwmSlices[slice_num].enabled) {
+        reportPwm(slice_num);
+    }
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level) {
+    pwm_set_chan_level(pwm_gpio_to_slice_num(gpio), pwm_gpio_to_channel(gpio), level);
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled) {
+    if (pwmSlices[slice_num].enabled == enabled) {
+        return;
+    }
+    pwmSlices[slice_num].enabled = enabled;
+    reportPwm(slice_num);
+}
+
+void pwm_set_counter(uint slice_num, uint16_t c) {
+    (void)slice_num;
+    (void)c;
+}
+
+//-------------------------------------------------------------------------
+//  Flash: NOR semantics, erase sets bits and programming clears them
+//-------------------------------------------------------------------------
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if (flash_offs % FLASH_SECTOR_SIZE != 0 || count % FLASH_SECTOR_SIZE != 0 ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        panic("host: flash erase of %u bytes at 0x%x is not whole sectors", (unsigned)count, flash_offs);
+    }
+    memset(&host_flash[flash_offs], 0xff, count);
+    flashErases += (uint32_t)(count / FLASH_SECTOR_SIZE);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count) {
+    if (flash_offs % FLASH_PAGE_SIZE != 0 || count % FLASH_PAGE_SIZE != 0 ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        panic("host: flash program of %u bytes at 0x%x is not whole pages", (unsigned)count, flash_offs);
+    }
+    for (size_t i = 0; i < count; i++) {
+        host_flash[flash_offs + i] &= data[i];
+    }
+}
+
+int flash_safe_execute(void (*func)(void*), void* param, uint32_t enter_exit_timeout_ms) {
+    (void)enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
+
+void host_flash_reset(void) {
+    memset(host_flash, 0xff, sizeof(host_flash));
+    flashErases = 0;
+}
+
+uint32_t host_flash_erases(void) {
+    return flashErases;
+}
@@ -0,0 +1,1005 @@
+//=========================================================================
+//  HostMqtt.cpp
+//  The lwIP MQTT client API (lwip/apps/mqtt.h) over non-blocking POSIX
+//  sockets: MQTT 3.1.1, QoS 0/1, no TLS. Callbacks run from
+//  host_mqtt_service() with the same order and arguments lwIP uses, so
+//  MqttClient.c cannot tell the difference. In loopback mode the socket
+//  is replaced by a small in-process broker fed straight from tx; it
+//  keeps retained messages and, for clean session 0, the subscriptions
+//  and missed QoS 1 messages of clients that are away, and publishes the
+//  will of a client that goes without a DISCONNECT. Against it a connect
+//  with a tls_config gets a TLS session, resumed or new, but nothing is
+//  encrypted (altcp_tls.h).
+//=========================================================================
+
+#include "HostHal.h"
+#include "lwip/apps/mqtt.h"
+#include "lwip/apps/mqtt_priv.h"
+#include "lwip/altcp_tls.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum PacketType : uint8_t {
+    CONNECT     = 0x10,
+    CONNACK     = 0x20,
+    PUBLISH     = 0x30,
+    PUBACK      = 0x40,
+    SUBSCRIBE   = 0x82,
+    SUBACK      = 0x90,
+    UNSUBSCRIBE = 0xa2,
+    UNSUBACK    = 0xb0,
+    PINGREQ     = 0xc0,
+    PINGRESP    = 0xd0,
+    DISCONNECT  = 0xe0,
+};
+
+struct Subscription {
+    std::string filter;
+    uint8_t qos;                                                             // Granted: 0 or 1
+};
+
+struct Request {
+    uint16_t id;                                                             // 0: QoS 0 publish, done once sent
+    mqtt_request_cb_t cb;
+    void* arg;
+};
+
+void putU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+void putString(std::vector<uint8_t>& out, const char* text, size_t len) {
+    putU16(out, (uint16_t)len);
+    out.insert(out.end(), text, text + len);
+}
+
+void putString(std::vector<uint8_t>& out, const char* text) {
+    putString(out, text, strlen(text));
+}
+
+} // namespace
+
+// The connection under a client. Only what the TLS session calls need:
+// there is no encryption, just the session the handshake ended up with.
+struct altcp_pcb {
+    bool tls = false;                                                        // Connected with a tls_config
+    uint32_t offered = 0;                                                    // Set with altcp_tls_set_session()
+    uint32_t session = 0;                                                    // Of the handshake, 0 until done
+};
+
+struct altcp_tls_config {
+    std::string serverName;
+};
+
+struct altcp_tls_session {
+    uint32_t id = 0;
+};
+
+namespace {
+
+// The firmware sees only conn of it (lwip/apps/mqtt_priv.h)
+struct HostClient : mqtt_client_s {
+    HostClient() { conn = &pcb; }
+
+    altcp_pcb pcb;
+    int fd = -1;
+    bool open = false;                                                       // Socket or loopback session exists
+    bool loopback = false;
+    std::vector<Subscription> filters;                                       // Loopback subscriptions
+    bool connecting = false;                                                 // TCP handshake in progress
+    bool connected = false;                                                  // CONNACK accepted
+    mqtt_connection_cb_t connectCb = nullptr;
+    void* connectArg = nullptr;
+    mqtt_incoming_publish_cb_t pubCb = nullptr;
+    mqtt_incoming_data_cb_t dataCb = nullptr;
+    void* inpubArg = nullptr;
+    uint16_t inpubPacketId = 0;                                              // Of the publish being delivered
+    uint8_t inpubFlags = 0;
+    uint16_t keepAlive = 0;
+    bool sessionPresent = false;                                             // From the last CONNACK
+    std::string clientId;                                                    // Loopback broker's view
+    bool keepSession = false;
+    bool hasWill = false;                                                    // Until a DISCONNECT discards it
+    std::string willTopic;
+    std::vector<uint8_t> willMessage;
+    uint8_t willQos = 0;
+    bool willRetain = false;
+    absolute_time_t lastSent = nil_time;
+    absolute_time_t lastReceived = nil_time;                                 // Server watchdog, like lwIP's
+    uint16_t nextId = 1;
+    std::vector<Request> requests;
+    std::vector<uint8_t> tx;
+    std::vector<uint8_t> rx;
+};
+
+HostClient* toHost(mqtt_client_t* client) {
+    return static_cast<HostClient*>(client);
+}
+
+// Broker side of a kept session while its client is away
+struct BrokerSession {
+    std::vector<Subscription> filters;
+    std::vector<std::vector<uint8_t>> queued;                                // Framed QoS 1 publishes
+};
+
+struct RetainedMessage {
+    std::string topic;
+    std::vector<uint8_t> payload;
+};
+
+std::vector<HostClient*> clients;
+bool loopbackMode = false;
+bool brokerUp = true;
+host_mqtt_publish_hook_t publishHook = nullptr;
+std::map<std::string, BrokerSession> sessions;
+std::vector<RetainedMessage> retained;
+uint16_t brokerId = 0;
+std::set<uint32_t> tlsSessions;                                              // Issued and still resumable
+uint32_t tlsNextSession = 0;
+uint32_t tlsFullHandshakes = 0;
+
+uint16_t takePacketId(HostClient* client) {
+    uint16_t id = client->nextId++;
+    if (client->nextId == 0) {
+        client->nextId = 1;
+    }
+    return id;
+}
+
+// Appends a packet: fixed header with remaining length, then body
+void appendPacket(std::vector<uint8_t>& out, uint8_t header, const std::vector<uint8_t>& body) {
+    out.push_back(header);
+    size_t len = body.size();
+    do {
+        uint8_t digit = len % 128;
+        len /= 128;
+        out.push_back(len > 0 ? (uint8_t)(digit | 0x80) : digit);
+    } while (len > 0);
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+void queuePacket(HostClient* client, uint8_t header, const std::vector<uint8_t>& body) {
+    appendPacket(client->tx, header, body);
+}
+
+// Finds the complete packet at pos; false if more bytes are needed
+bool framePacket(const std::vector<uint8_t>& buf, size_t pos, size_t& bodyAt, size_t& len) {
+    len = 0;
+    bodyAt = pos + 1;
+    for (int shift = 0; bodyAt < buf.size() && shift <= 21; shift += 7) {
+        uint8_t digit = buf[bodyAt++];
+        len |= (size_t)(digit & 0x7f) << shift;
+        if ((digit & 0x80) == 0) {
+            return buf.size() - bodyAt >= len;
+        }
+    }
+    return false;
+}
+
+// MQTT filter match: '+' is one level, a trailing '#' any number of them
+bool topicMatches(const std::string& filter, const char* topic) {
+    size_t f = 0;
+    const char* t = topic;
+    while (f < filter.size()) {
+        if (filter[f] == '#') {
+            return true;
+        }
+        if (filter[f] == '+') {
+            while (*t != '\0' && *t != '/') {
+                t++;
+            }
+            f++;
+        }
+        else {
+            if (*t != filter[f]) {
+                return false;
+            }
+            t++;
+            f++;
+        }
+        if (f == filter.size()) {
+            return *t == '\0';
+        }
+        if (*t == '\0') {
+            return filter.compare(f, std::string::npos, "/#") == 0;         // "a/#" also matches "a"
+        }
+    }
+    return *t == '\0';
+}
+
+// QoS 0 when id is 0; dup marks a redelivery, retain one from the store
+void appendPublish(std::vector<uint8_t>& out, const char* topic, const void* payload, size_t len,
+                   uint16_t id = 0, bool dup = false, bool retain = false) {
+    std::vector<uint8_t> body;
+    putString(body, topic);
+    if (id != 0) {
+        putU16(body, id);
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(payload);
+    body.insert(body.end(), bytes, bytes + len);
+    appendPacket(out, (uint8_t)(PUBLISH | (id != 0 ? 0x02 : 0) | (dup ? 0x08 : 0) | (retain ? 0x01 : 0)), body);
+}
+
+// Highest QoS granted to a subscription matching topic, -1 if none
+int grantedQos(const std::vector<Subscription>& filters, const char* topic) {
+    int qos = -1;
+    for (const Subscription& sub : filters) {
+        if (topicMatches(sub.filter, topic)) {
+            qos = std::max<int>(qos, sub.qos);
+        }
+    }
+    return qos;
+}
+
+void parse(HostClient* client);
+
+// Resumes the offered session if the broker still has it (in its cache,
+// or a ticket it can still decrypt); otherwise a full handshake issues a
+// new one
+void tlsHandshake(altcp_pcb& pcb) {
+    if (pcb.offered != 0 && tlsSessions.count(pcb.offered) != 0) {
+        pcb.session = pcb.offered;
+        return;
+    }
+    pcb.session = ++tlsNextSession;
+    tlsSessions.insert(pcb.session);
+    tlsFullHandshakes++;
+}
+
+// Packet id for a broker to client publish at qos; 0 for QoS 0
+uint16_t brokerPacketId(int qos, uint16_t chosen) {
+    if (qos <= 0) {
+        return 0;
+    }
+    if (chosen != 0) {
+        return chosen;
+    }
+    if (++brokerId == 0) {
+        brokerId = 1;
+    }
+    return brokerId;
+}
+
+// Sends a publish to every connected loopback subscriber (parsed at once
+// if now, else at their next service) and queues QoS 1 ones for away
+// sessions. Returns how many connected clients got it.
+int brokerPublish(const char* topic, const uint8_t* payload, size_t len, uint8_t qos, uint16_t id, bool dup,
+                  bool now) {
+    int delivered = 0;
+    std::vector<HostClient*> snapshot = clients;
+    for (HostClient* client : snapshot) {
+        if (std::find(clients.begin(), clients.end(), client) == clients.end() ||
+            !client->loopback || !client->connected) {
+            continue;
+        }
+        int granted = grantedQos(client->filters, topic);
+        if (granted < 0) {
+            continue;
+        }
+        appendPublish(client->rx, topic, payload, len, brokerPacketId(std::min<int>(granted, qos), id), dup);
+        if (now) {
+            parse(client);
+        }
+        delivered++;
+    }
+    for (auto& [clientId, session] : sessions) {
+        if (std::min<int>(grantedQos(session.filters, topic), qos) > 0) {
+            session.queued.emplace_back();
+            appendPublish(session.queued.back(), topic, payload, len, brokerPacketId(1, 0));
+        }
+    }
+    return delivered;
+}
+
+void storeRetained(const std::string& topic, const uint8_t* payload, size_t len) {
+    retained.erase(std::remove_if(retained.begin(), retained.end(),
+                                  [&](const RetainedMessage& m) { return m.topic == topic; }),
+                   retained.end());
+    if (len > 0) {                                                           // Empty clears
+        retained.push_back({ topic, std::vector<uint8_t>(payload, payload + len) });
+    }
+}
+
+void closeClient(HostClient* client) {
+    bool will = client->loopback && client->connected && client->hasWill && brokerUp;
+    if (client->loopback && client->connected && client->keepSession) {
+        sessions[client->clientId] = { client->filters, {} };                // Kept until the client is back
+    }
+    if (client->fd >= 0) {
+        close(client->fd);
+    }
+    client->fd = -1;
+    client->open = false;
+    client->filters.clear();
+    client->connecting = false;
+    client->connected = false;
+    client->tx.clear();
+    client->rx.clear();
+    client->requests.clear();
+    client->hasWill = false;
+    if (will) {                                                              // At once, as if the broker saw a reset
+        if (publishHook) {
+            publishHook(client->willTopic.c_str(), client->willMessage.data(), client->willMessage.size(),
+                        client->willQos, client->willRetain);
+        }
+        if (client->willRetain) {
+            storeRetained(client->willTopic, client->willMessage.data(), client->willMessage.size());
+        }
+        brokerPublish(client->willTopic.c_str(), client->willMessage.data(), client->willMessage.size(),
+                      client->willQos, 0, false, false);
+    }
+}
+
+// Connection lost: lwIP reports it through the connection callback
+void dropClient(HostClient* client, mqtt_connection_status_t status) {
+    closeClient(client);
+    if (client->connectCb) {
+        client->connectCb(client, client->connectArg, status);
+    }
+}
+
+void completeRequest(HostClient* client, uint16_t id, err_t err) {
+    for (size_t i = 0; i < client->requests.size(); i++) {
+        if (client->requests[i].id == id) {
+            Request request = client->requests[i];
+            client->requests.erase(client->requests.begin() + i);
+            if (request.cb) {
+                request.cb(request.arg, err);
+            }
+            return;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+//  Loopback broker: answers everything the client sent, into its rx
+//-------------------------------------------------------------------------
+void loopbackBroker(HostClient* client) {
+    size_t pos = 0;
+    size_t at;
+    size_t len;
+    while (framePacket(client->tx, pos, at, len)) {
+        uint8_t header = client->tx[pos];
+        const uint8_t* body = client->tx.data() + at;
+        pos = at + len;
+
+        std::vector<uint8_t> reply;
+        switch (header & 0xf0) {
+        case CONNECT: {
+            if (client->pcb.tls) {                                           // Handshake and CONNECT at once
+                tlsHandshake(client->pcb);
+            }
+            size_t idLen = (size_t)(body[10] << 8 | body[11]);
+            client->clientId.assign(reinterpret_cast<const char*>(body + 12), idLen);
+            client->keepSession = (body[7] & 0x02) == 0;
+            client->hasWill = (body[7] & 0x04) != 0;
+            if (client->hasWill) {
+                size_t at = 12 + idLen;
+                size_t n = (size_t)(body[at] << 8 | body[at + 1]);
+                client->willTopic.assign(reinterpret_cast<const char*>(body + at + 2), n);
+                at += 2 + n;
+                n = (size_t)(body[at] << 8 | body[at + 1]);
+                client->willMessage.assign(body + at + 2, body + at + 2 + n);
+                client->willQos = std::min((body[7] >> 3) & 3, 1);
+                client->willRetain = (body[7] & 0x20) != 0;
+            }
+            auto kept = sessions.find(client->clientId);
+            bool present = client->keepSession && kept != sessions.end();
+            std::vector<std::vector<uint8_t>> queued;
+            if (present) {
+                client->filters = kept->second.filters;
+                queued = std::move(kept->second.queued);
+            }
+            if (kept != sessions.end()) {
+                sessions.erase(kept);
+            }
+            appendPacket(client->rx, CONNACK, { (uint8_t)present, MQTT_CONNECT_ACCEPTED });
+            for (const std::vector<uint8_t>& publish : queued) {
+                client->rx.insert(client->rx.end(), publish.begin(), publish.end());
+            }
+            break;
+        }
+        case SUBSCRIBE & 0xf0:
+        case UNSUBSCRIBE & 0xf0: {
+            bool sub = (header & 0xf0) == (SUBSCRIBE & 0xf0);
+            std::vector<Subscription> added;
+            reply.assign(body, body + 2);                                    // Packet id
+            for (size_t i = 2; i + 2 <= len;) {
+                size_t n = (size_t)(body[i] << 8 | body[i + 1]);
+                std::string filter(reinterpret_cast<const char*>(body + i + 2), n);
+                i += 2 + n;
+                client->filters.erase(std::remove_if(client->filters.begin(), client->filters.end(),
+                                                     [&](const Subscription& s) { return s.filter == filter; }),
+                                      client->filters.end());                // A new SUBSCRIBE replaces it
+                if (sub) {
+                    uint8_t granted = i < len ? std::min<uint8_t>(body[i], 1) : 0;
+                    reply.push_back(granted);
+                    i++;
+                    client->filters.push_back({ filter, granted });
+                    added.push_back({ filter, granted });
+                }
+            }
+            appendPacket(client->rx, sub ? SUBACK : UNSUBACK, reply);
+            for (const Subscription& subscription : added) {                 // Retained ones follow the SUBACK
+                for (const RetainedMessage& message : retained) {
+                    if (topicMatches(subscription.filter, message.topic.c_str())) {
+                        appendPublish(client->rx, message.topic.c_str(), message.payload.data(),
+                                      message.payload.size(), brokerPacketId(subscription.qos, 0), false, true);
+                    }
+                }
+            }
+            break;
+        }
+        case PUBLISH: {
+            size_t n = (size_t)(body[0] << 8 | body[1]);
+            std::string topic(reinterpret_cast<const char*>(body + 2), n);
+            uint8_t qos = (header >> 1) & 3;
+            size_t payloadAt = 2 + n + (qos > 0 ? 2 : 0);
+            if (qos > 0) {
+                appendPacket(client->rx, PUBACK, { body[2 + n], body[3 + n] });
+            }
+            if (publishHook) {
+                publishHook(topic.c_str(), body + payloadAt, len - payloadAt, qos, header & 0x01);
+            }
+            if (header & 0x01) {
+                storeRetained(topic, body + payloadAt, len - payloadAt);
+            }
+            brokerPublish(topic.c_str(), body + payloadAt, len - payloadAt, qos, 0, false, false);
+            break;
+        }
+        case PINGREQ:
+            appendPacket(client->rx, PINGRESP, {});
+            break;
+        case DISCONNECT:                                                     // A clean goodbye: no will
+            client->hasWill = false;
+            break;
+        default:                                                             // PUBACK
+            break;
+        }
+    }
+    client->tx.erase(client->tx.begin(), client->tx.begin() + pos);
+}
+
+// Writes what the socket takes; false if the connection failed
+bool flush(HostClient* client) {
+    if (client->loopback && !client->tx.empty()) {
+        loopbackBroker(client);
+        client->lastSent = get_absolute_time();
+    }
+    while (!client->tx.empty()) {
+        ssize_t sent = send(client->fd, client->tx.data(), client->tx.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client->tx.erase(client->tx.begin(), client->tx.begin() + sent);
+        client->lastSent = get_absolute_time();
+    }
+    while (client->open && std::any_of(client->requests.begin(), client->requests.end(),
+                                           [](const Request& r) { return r.id == 0; })) {
+        completeRequest(client, 0, ERR_OK);                                  // QoS 0 publishes are done once sent
+    }
+    return true;
+}
+
+void handlePublish(HostClient* client, uint8_t flags, const uint8_t* body, size_t len) {
+    if (len < 2) {
+        return;
+    }
+    size_t topicLen = (size_t)(body[0] << 8 | body[1]);
+    size_t pos = 2 + topicLen;
+    uint8_t qos = (flags >> 1) & 3;
+    uint16_t id = 0;
+    if (pos > len || (qos > 0 && pos + 2 > len)) {
+        return;
+    }
+    std::string topic(reinterpret_cast<const char*>(body + 2), topicLen);
+    if (qos > 0) {
+        id = (uint16_t)(body[pos] << 8 | body[pos + 1]);
+        pos += 2;
+    }
+
+    const uint8_t* payload = body + pos;
+    size_t remaining = len - pos;
+    client->inpubPacketId = id;
+    client->inpubFlags = flags;
+    if (client->pubCb) {
+        client->pubCb(client->inpubArg, topic.c_str(), (u32_t)remaining);
+    }
+    if (client->dataCb) {
+        if (remaining == 0) {
+            client->dataCb(client->inpubArg, nullptr, 0, MQTT_DATA_FLAG_LAST);
+        }
+        while (remaining > 0) {
+            u16_t chunk = (u16_t)std::min<size_t>(remaining, MQTT_VAR_HEADER_BUFFER_LEN);
+            remaining -= chunk;
+            client->dataCb(client->inpubArg, payload, chunk, remaining == 0 ? MQTT_DATA_FLAG_LAST : 0);
+            payload += chunk;
+        }
+    }
+    if (qos == 1 && client->open) {
+        std::vector<uint8_t> ack;
+        putU16(ack, id);
+        queuePacket(client, PUBACK, ack);
+    }
+}
+
+void handlePacket(HostClient* client, uint8_t header, const uint8_t* body, size_t len) {
+    client->lastReceived = get_absolute_time();
+    switch (header & 0xf0) {
+    case CONNACK:
+        if (len >= 2) {
+            mqtt_connection_status_t status = (mqtt_connection_status_t)body[1];
+            client->connected = status == MQTT_CONNECT_ACCEPTED;
+            client->sessionPresent = client->connected && (body[0] & 0x01);
+            if (!client->connected) {
+                closeClient(client);
+            }
+            if (client->connectCb) {
+                client->connectCb(client, client->connectArg, status);
+            }
+        }
+        break;
+    case PUBLISH:
+        handlePublish(client, header & 0x0f, body, len);
+        break;
+    case PUBACK:
+    case UNSUBACK:
+        if (len >= 2) {
+            completeRequest(client, (uint16_t)(body[0] << 8 | body[1]), ERR_OK);
+        }
+        break;
+    case SUBACK & 0xf0:
+        if (len >= 3) {
+            completeRequest(client, (uint16_t)(body[0] << 8 | body[1]), body[2] < 3 ? ERR_OK : ERR_ABRT);
+        }
+        break;
+    default:                                                                 // PINGRESP and anything unexpected
+        break;
+    }
+}
+
+// Splits rx into complete packets; leaves a partial one for next time
+void parse(HostClient* client) {
+    size_t pos = 0;
+    size_t at;
+    size_t len;
+    while (client->open && framePacket(client->rx, pos, at, len)) {
+        // Copy out: callbacks may queue packets or close the client
+        std::vector<uint8_t> body(client->rx.begin() + at, client->rx.begin() + at + len);
+        uint8_t header = client->rx[pos];
+        pos = at + len;
+        handlePacket(client, header, body.data(), body.size());
+    }
+    if (client->open) {
+        client->rx.erase(client->rx.begin(), client->rx.begin() + pos);
+    }
+}
+
+// PINGREQ when idle for keep_alive; give up after 1.5 x keep_alive of silence
+void checkKeepAlive(HostClient* client) {
+    if (!client->connected || client->keepAlive == 0) {
+        return;
+    }
+    int64_t keepAliveUs = (int64_t)client->keepAlive * 1000000;
+    absolute_time_t now = get_absolute_time();
+    if (absolute_time_diff_us(client->lastReceived, now) > keepAliveUs * 3 / 2) {
+        dropClient(client, MQTT_CONNECT_TIMEOUT);
+        return;
+    }
+    if (absolute_time_diff_us(client->lastSent, now) >= keepAliveUs) {
+        queuePacket(client, PINGREQ, {});
+        flush(client);
+    }
+}
+
+void service(HostClient* client) {
+    if (client->loopback && !brokerUp) {
+        dropClient(client, MQTT_CONNECT_DISCONNECTED);
+        return;
+    }
+    if (client->loopback) {
+        flush(client);
+        parse(client);
+        checkKeepAlive(client);
+        return;
+    }
+    if (client->connecting) {
+        pollfd pfd = { client->fd, POLLOUT, 0 };
+        if (poll(&pfd, 1, 0) <= 0) {
+            return;
+        }
+        int error = 0;
+        socklen_t size = sizeof(error);
+        getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &size);
+        if (error != 0) {
+            dropClient(client, MQTT_CONNECT_DISCONNECTED);
+            return;
+        }
+        client->connecting = false;
+    }
+
+    uint8_t chunk[1024];
+    while (true) {
+        ssize_t got = recv(client->fd, chunk, sizeof(chunk), 0);
+        if (got > 0) {
+            client->rx.insert(client->rx.end(), chunk, chunk + got);
+            continue;
+        }
+        if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            dropClient(client, MQTT_CONNECT_DISCONNECTED);
+            return;
+        }
+        break;
+    }
+    parse(client);
+    if (!client->open) {
+        return;
+    }
+
+    if (!flush(client)) {
+        dropClient(client, MQTT_CONNECT_DISCONNECTED);
+        return;
+    }
+    checkKeepAlive(client);
+}
+
+// Starts a non-blocking TCP connect; service() notices when it completes
+err_t openSocket(HostClient* client, const ip_addr_t* ipaddr, u16_t port) {
+    client->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (client->fd < 0) {
+        return ERR_MEM;
+    }
+    int one = 1;
+    setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = ipaddr->addr;
+    if (connect(client->fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        closeClient(client);
+        return ERR_RTE;
+    }
+    client->connecting = true;
+    return ERR_OK;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------
+//  lwIP API
+//-------------------------------------------------------------------------
+mqtt_client_t* mqtt_client_new(void) {
+    HostClient* client = new HostClient();
+    clients.push_back(client);
+    return client;
+}
+
+void mqtt_client_free(mqtt_client_t* handle) {
+    HostClient* client = toHost(handle);
+    closeClient(client);
+    clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+    delete client;
+}
+
+err_t mqtt_client_connect(mqtt_client_t* handle, const ip_addr_t* ipaddr, u16_t port, mqtt_connection_cb_t cb,
+                          void* arg, const struct mqtt_connect_client_info_t* client_info) {
+    HostClient* client = toHost(handle);
+    if (client->open) {
+        return ERR_ISCONN;
+    }
+    if (client_info == nullptr || client_info->client_id == nullptr) {
+        return ERR_VAL;
+    }
+    if (client_info->tls_config != nullptr && !loopbackMode) {
+        return ERR_VAL;                                                      // TLS only against the loopback broker
+    }
+
+    client->loopback = loopbackMode;
+    client->pcb = {};
+    client->pcb.tls = client_info->tls_config != nullptr;
+    if (!client->loopback) {
+        err_t err = openSocket(client, ipaddr, port);
+        if (err != ERR_OK) {
+            return err;
+        }
+    }
+    client->open = true;
+    client->lastReceived = get_absolute_time();
+    client->connectCb = cb;
+    client->connectArg = arg;
+    client->keepAlive = client_info->keep_alive;
+
+    uint8_t flags = client_info->keep_session ? 0 : 0x02;                    // Clean session
+    std::vector<uint8_t> body;
+    putString(body, "MQTT");
+    body.push_back(4);                                                       // 3.1.1
+    if (client_info->will_topic) {
+        flags |= 0x04 | (client_info->will_qos & 3) << 3 | (client_info->will_retain ? 0x20 : 0);
+    }
+    if (client_info->client_user) {
+        flags |= 0x80;
+    }
+    if (client_info->client_pass) {
+        flags |= 0x40;
+    }
+    body.push_back(flags);
+    putU16(body, client_info->keep_alive);
+    putString(body, client_info->client_id);
+    if (client_info->will_topic) {
+        putString(body, client_info->will_topic);
+        putString(body, client_info->will_msg ? client_info->will_msg : "",
+                  client_info->will_msg_len ? client_info->will_msg_len
+                                            : (client_info->will_msg ? strlen(client_info->will_msg) : 0));
+    }
+    if (client_info->client_user) {
+        putString(body, client_info->client_user);
+    }
+    if (client_info->client_pass) {
+        putString(body, client_info->client_pass);
+    }
+    queuePacket(client, CONNECT, body);
+    return ERR_OK;
+}
+
+// Like lwIP: the connection is closed without a DISCONNECT, so the broker
+// publishes the will, and the connection callback is not called
+void mqtt_disconnect(mqtt_client_t* handle) {
+    HostClient* client = toHost(handle);
+    closeClient(client);
+}
+
+u8_t mqtt_client_is_connected(mqtt_client_t* handle) {
+    HostClient* client = toHost(handle);
+    return client->connected;
+}
+
+u8_t mqtt_client_session_present(mqtt_client_t* handle) {
+    HostClient* client = toHost(handle);
+    return client->sessionPresent;
+}
+
+void mqtt_set_inpub_callback(mqtt_client_t* handle, mqtt_incoming_publish_cb_t pub_cb,
+                             mqtt_incoming_data_cb_t data_cb, void* arg) {
+    HostClient* client = toHost(handle);
+    client->pubCb = pub_cb;
+    client->dataCb = data_cb;
+    client->inpubArg = arg;
+}
+
+void mqtt_get_inpub_info(mqtt_client_t* handle, u16_t* pkt_id, u8_t* flags) {
+    HostClient* client = toHost(handle);
+    *pkt_id = client->inpubPacketId;
+    *flags = client->inpubFlags;
+}
+
+err_t mqtt_sub_unsub(mqtt_client_t* handle, const char* topic, u8_t qos, mqtt_request_cb_t cb, void* arg, u8_t sub) {
+    HostClient* client = toHost(handle);
+    if (!client->connected) {
+        return ERR_CONN;
+    }
+    if (client->requests.size() >= MQTT_REQ_MAX_IN_FLIGHT) {
+        return ERR_MEM;
+    }
+    uint16_t id = takePacketId(client);
+    std::vector<uint8_t> body;
+    putU16(body, id);
+    putString(body, topic);
+    if (sub) {
+        body.push_back(qos > 1 ? 1 : qos);
+    }
+    queuePacket(client, sub ? SUBSCRIBE : UNSUBSCRIBE, body);
+    client->requests.push_back({ id, cb, arg });
+    return ERR_OK;
+}
+
+err_t mqtt_publish(mqtt_client_t* handle, const char* topic, const void* payload, u16_t payload_length,
+                   u8_t qos, u8_t retain, mqtt_request_cb_t cb, void* arg) {
+    HostClient* client = toHost(handle);
+    if (!client->connected) {
+        return ERR_CONN;
+    }
+    if (client->requests.size() >= MQTT_REQ_MAX_IN_FLIGHT) {
+        return ERR_MEM;
+    }
+    uint16_t id = qos > 0 ? takePacketId(client) : 0;
+    std::vector<uint8_t> body;
+    putString(body, topic);
+    if (qos > 0) {
+        putU16(body, id);
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(payload);
+    body.insert(body.end(), bytes, bytes + payload_length);
+    if (client->tx.size() + 5 + body.size() > MQTT_OUTPUT_RINGBUF_SIZE) {   // Header + remaining length
+        return ERR_MEM;
+    }
+    queuePacket(client, (uint8_t)(PUBLISH | (qos > 0 ? 0x02 : 0) | (retain ? 0x01 : 0)), body);
+    client->requests.push_back({ id, cb, arg });
+    return ERR_OK;
+}
+
+//-------------------------------------------------------------------------
+//  altcp_tls, sessions only
+//-------------------------------------------------------------------------
+struct altcp_tls_config* altcp_tls_create_config_client(const u8_t* cert, size_t cert_len) {
+    (void)cert;
+    (void)cert_len;
+    return new altcp_tls_config();
+}
+
+struct altcp_tls_config* altcp_tls_create_config_client_2wayauth(const u8_t* ca, size_t ca_len,
+                                                                 const u8_t* privkey, size_t privkey_len,
+                                                                 const u8_t* privkey_pass, size_t privkey_pass_len,
+                                                                 const u8_t* cert, size_t cert_len) {
+    (void)ca;
+    (void)ca_len;
+    (void)privkey;
+    (void)privkey_len;
+    (void)privkey_pass;
+    (void)privkey_pass_len;
+    return altcp_tls_create_config_client(cert, cert_len);
+}
+
+void altcp_tls_free_config(struct altcp_tls_config* conf) {
+    delete conf;
+}
+
+void altcp_tls_set_server_name(struct altcp_tls_config* config, const char* server_name) {
+    config->serverName = server_name;
+}
+
+struct altcp_tls_session* altcp_tls_alloc_session(void) {
+    return new altcp_tls_session();
+}
+
+void altcp_tls_free_session(struct altcp_tls_session* session) {
+    delete session;
+}
+
+// The session of the handshake, once it is done
+err_t altcp_tls_get_session(struct altcp_pcb* conn, struct altcp_tls_session* session) {
+    if (conn == nullptr || session == nullptr || conn->session == 0) {
+        return ERR_VAL;
+    }
+    session->id = conn->session;
+    return ERR_OK;
+}
+
+// Offered by the handshake still to come
+err_t altcp_tls_set_session(struct altcp_pcb* conn, struct altcp_tls_session* session) {
+    if (conn == nullptr || session == nullptr || !conn->tls || conn->session != 0) {
+        return ERR_VAL;
+    }
+    conn->offered = session->id;
+    return ERR_OK;
+}
+
+err_t altcp_tls_session_save(const struct altcp_tls_session* session, u8_t* buf, size_t len, size_t* olen) {
+    if (session == nullptr || olen == nullptr) {
+        return ERR_ARG;
+    }
+    *olen = sizeof(session->id);
+    if (len < sizeof(session->id)) {
+        return ERR_MEM;
+    }
+    memcpy(buf, &session->id, sizeof(session->id));
+    return ERR_OK;
+}
+
+err_t altcp_tls_session_load(struct altcp_tls_session* session, const u8_t* buf, size_t len) {
+    if (session == nullptr || buf == nullptr) {
+        return ERR_ARG;
+    }
+    if (len != sizeof(session->id)) {
+        return ERR_VAL;
+    }
+    memcpy(&session->id, buf, sizeof(session->id));
+    return ERR_OK;
+}
+
+//-------------------------------------------------------------------------
+//  Host side
+//-------------------------------------------------------------------------
+void host_mqtt_service(void) {
+    std::vector<HostClient*> snapshot = clients;                          // Callbacks may free clients
+    for (HostClient* client : snapshot) {
+        if (std::find(clients.begin(), clients.end(), client) != clients.end() && client->open) {
+            service(client);
+        }
+    }
+}
+
+bool host_mqtt_wait(int64_t timeout_us) {
+    static constexpr int64_t MAX_WAIT_US = 100000;                          // Same slice as the sleeps
+    std::vector<pollfd> fds;
+    for (HostClient* client : clients) {
+        if (client->loopback && client->open && (!client->rx.empty() || !client->tx.empty())) {
+            return true;                                                     // Broker has answered
+        }
+        if (client->fd >= 0) {
+            short events = POLLIN;
+            if (client->connecting || !client->tx.empty()) {
+                events |= POLLOUT;
+            }
+            fds.push_back({ client->fd, events, 0 });
+        }
+    }
+    if (timeout_us < 0) {
+        timeout_us = 0;
+    }
+    if (host_time_is_virtual()) {
+        host_time_advance_to(delayed_by_us(get_absolute_time(), (uint64_t)timeout_us));
+        return false;
+    }
+    if (timeout_us > MAX_WAIT_US) {
+        timeout_us = MAX_WAIT_US;
+    }
+    int ready = poll(fds.data(), fds.size(), (int)((timeout_us + 999) / 1000));
+    return ready > 0;
+}
+
+void host_mqtt_set_broker_up(bool up) {
+    brokerUp = up;
+}
+
+void host_mqtt_set_loopback(bool enabled) {
+    loopbackMode = enabled;
+}
+
+void host_mqtt_set_publish_hook(host_mqtt_publish_hook_t hook) {
+    publishHook = hook;
+}
+
+int host_mqtt_deliver(const char* topic, const void* payload, size_t len) {
+    return host_mqtt_deliver_qos(topic, payload, len, 0, 0, false);
+}
+
+int host_mqtt_deliver_qos(const char* topic, const void* payload, size_t len, uint8_t qos, uint16_t packet_id,
+                          bool dup) {
+    return brokerPublish(topic, static_cast<const uint8_t*>(payload), len, qos, packet_id, dup, true);
+}
+
+int host_mqtt_retain(const char* topic, const void* payload, size_t len) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(payload);
+    storeRetained(topic, bytes, len);
+    return brokerPublish(topic, bytes, len, 1, 0, false, true);
+}
+
+size_t host_mqtt_retained(const char* topic, void* out, size_t size) {
+    for (const RetainedMessage& message : retained) {
+        if (message.topic == topic) {
+            size_t len = std::min(size, message.payload.size());
+            memcpy(out, message.payload.data(), len);
+            return len;
+        }
+    }
+    return 0;
+}
+
+void host_mqtt_reset_broker(void) {
+    sessions.clear();
+    retained.clear();
+    tlsSessions.clear();
+    tlsFullHandshakes = 0;
+}
+
+void host_tls_expire_sessions(void) {
+    tlsSessions.clear();
+}
+
+uint32_t host_tls_full_handshakes(void) {
+    return tlsFullHandshakes;
+}
@@ -0,0 +1,203 @@
+//=========================================================================
+//  HostNetwork.cpp
+//  cyw43_arch and DNS for the host. The "WiFi link" is the host's own
+//  network stack, so joining succeeds unless the access point has been
+//  switched off with host_wifi_set_available; polling services the MQTT
+//  sockets, pending async-context work and due alarms.
+//=========================================================================
+
+#include "HostHal.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/gpio.h"
+#include "lwip/dns.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+cyw43_t cyw43_state = { { 0xf1, 0x50, 0xc2, 0xb8, 0xbf, 0x22 } };
+
+struct async_context {
+    async_when_pending_worker_t* workers;
+};
+
+namespace {
+
+async_context_t context = { nullptr };
+host_poll_hook_t pollHook = nullptr;
+bool apAvailable = true;
+int linkStatus = CYW43_LINK_DOWN;
+
+// Runs the when-pending workers that were flagged; true if any ran
+bool runPendingWorkers() {
+    bool ran = false;
+    for (async_when_pending_worker_t* w = context.workers; w != nullptr; w = w->next) {
+        if (w->work_pending) {
+            w->work_pending = false;
+            w->do_work(&context, w);
+            ran = true;
+        }
+    }
+    return ran;
+}
+
+// The driver's host-wake interrupt; nothing to wake on the host
+void onHostWake() {
+}
+
+bool workPending() {
+    for (async_when_pending_worker_t* w = context.workers; w != nullptr; w = w->next) {
+        if (w->work_pending) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+void host_set_mac(const uint8_t mac[6]) {
+    memcpy(cyw43_state.mac, mac, 6);
+}
+
+int cyw43_arch_init(void) {
+    const char* env = getenv("DESKPICO_MAC");
+    unsigned int m[6];
+    if (env && sscanf(env, "%x:%x:%x:%x:%x:%x", &m[0], &m[1], &m[2], &m[3], &m[4], &m[5]) == 6) {
+        for (int i = 0; i < 6; i++) {
+            cyw43_state.mac[i] = (uint8_t)m[i];
+        }
+    }
+    gpio_add_raw_irq_handler(CYW43_PIN_WL_HOST_WAKE, onHostWake);          // As the driver does: the pin is taken
+    return 0;
+}
+
+void cyw43_arch_deinit(void) {
+    gpio_remove_raw_irq_handler(CYW43_PIN_WL_HOST_WAKE, onHostWake);
+}
+
+void cyw43_arch_enable_sta_mode(void) {
+}
+
+void host_wifi_set_available(bool available) {
+    apAvailable = available;
+    if (!available) {
+        linkStatus = CYW43_LINK_DOWN;
+    }
+}
+
+// The join completes at once: the host network is already there
+int cyw43_arch_wifi_connect_async(const char* ssid, const char* pw, uint32_t auth) {
+    (void)pw;
+    (void)auth;
+    printf("host: joining \"%s\" via the host network\n", ssid);
+    linkStatus = apAvailable ? CYW43_LINK_UP : CYW43_LINK_NONET;
+    return 0;
+}
+
+int cyw43_arch_wifi_connect_timeout_ms(const char* ssid, const char* pw, uint32_t auth, uint32_t timeout) {
+    (void)timeout;
+    cyw43_arch_wifi_connect_async(ssid, pw, auth);
+    return linkStatus == CYW43_LINK_UP ? 0 : -1;
+}
+
+int cyw43_tcpip_link_status(cyw43_t* self, int itf) {
+    (void)self;
+    (void)itf;
+    return linkStatus;
+}
+
+int cyw43_wifi_get_mac(cyw43_t* self, int itf, uint8_t mac[6]) {
+    (void)itf;
+    memcpy(mac, self->mac, 6);
+    return 0;
+}
+
+int cyw43_wifi_get_rssi(cyw43_t* self, int32_t* rssi) {
+    (void)self;
+    *rssi = -40;
+    return 0;
+}
+
+async_context_t* cyw43_arch_async_context(void) {
+    return &context;
+}
+
+bool async_context_add_when_pending_worker(async_context_t* ctx, async_when_pending_worker_t* worker) {
+    worker->next = ctx->workers;
+    ctx->workers = worker;
+    return true;
+}
+
+bool async_context_remove_when_pending_worker(async_context_t* ctx, async_when_pending_worker_t* worker) {
+    for (async_when_pending_worker_t** w = &ctx->workers; *w != nullptr; w = &(*w)->next) {
+        if (*w == worker) {
+            *w = worker->next;
+            return true;
+        }
+    }
+    return false;
+}
+
+void async_context_set_work_pending(async_context_t* ctx, async_when_pending_worker_t* worker) {
+    (void)ctx;
+    worker->work_pending = true;
+}
+
+void host_set_poll_hook(host_poll_hook_t hook) {
+    pollHook = hook;
+}
+
+void cyw43_arch_poll(void) {
+    if (pollHook) {
+        pollHook();
+    }
+    host_mqtt_service();
+    runPendingWorkers();
+    host_run_alarms();
+}
+
+//-------------------------------------------------------------------------
+//  Sleeps until socket activity, flagged async work, an alarm that flags
+//  work, or until. Alarms keep firing on time while waiting.
+//-------------------------------------------------------------------------
+void cyw43_arch_wait_for_work_until(absolute_time_t until) {
+    if (pollHook) {
+        pollHook();
+    }
+    host_run_alarms();
+    while (!workPending() && !time_reached(until)) {
+        absolute_time_t next = host_next_alarm();
+        absolute_time_t wake = next < until ? next : until;
+        if (host_mqtt_wait(absolute_time_diff_us(get_absolute_time(), wake))) {
+            return;
+        }
+        host_run_alarms();
+    }
+}
+
+//-------------------------------------------------------------------------
+//  DNS: resolved on the spot, so the callback is never needed
+//-------------------------------------------------------------------------
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg) {
+    (void)found;
+    (void)callback_arg;
+    addrinfo hints = {};
+    addrinfo* result = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(hostname, nullptr, &hints, &result) != 0 || result == nullptr) {
+        return ERR_ARG;
+    }
+    addr->addr = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(result);
+    return ERR_OK;
+}
+
+char* ip4addr_ntoa(const ip4_addr_t* addr) {
+    static char text[INET_ADDRSTRLEN];
+    in_addr in;
+    in.s_addr = addr->addr;
+    return const_cast<char*>(inet_ntop(AF_INET, &in, text, sizeof(text)));
+}
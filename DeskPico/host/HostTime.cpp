@@ -0,0 +1,279 @@
+//=========================================================================
+//  HostTime.cpp
+//  Host clock (real or virtual), sleeps and the default alarm pool.
+//  Alarms keep the SDK's return-value contract: 0 = done, < 0 = reschedule
+//  relative to the previous target (drift-free), > 0 = relative to now.
+//=========================================================================
+
+#include "HostHal.h"
+#include "pico/stdlib.h"
+#include "pico/rand.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+struct alarm_pool {
+    struct Alarm {
+        alarm_id_t id;
+        absolute_time_t at;
+        alarm_callback_t callback;
+        void* user_data;
+    };
+    std::vector<Alarm> alarms;
+    alarm_id_t nextId = 1;
+    alarm_id_t running = 0;                                                  // Alarm whose callback is executing
+    bool runningCancelled = false;
+};
+
+namespace {
+
+alarm_pool defaultPool;
+bool eventFlag = false;
+
+const auto bootTime = std::chrono::steady_clock::now();
+bool virtualClock = false;
+absolute_time_t virtualNow = 1000;
+uint64_t randState = 0x9e3779b97f4a7c15ull;
+
+} // namespace
+
+//-------------------------------------------------------------------------
+//  Clock: microseconds since the process started, plus 1 ms so that
+//  "boot" is never nil_time. The virtual clock starts at the same value
+//  and only moves when something waits.
+//-------------------------------------------------------------------------
+absolute_time_t get_absolute_time(void) {
+    if (virtualClock) {
+        return virtualNow;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - bootTime;
+    return 1000 + std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void host_time_set_virtual(bool enabled) {
+    virtualClock = enabled;
+}
+
+bool host_time_is_virtual(void) {
+    return virtualClock;
+}
+
+void host_time_advance_to(absolute_time_t target) {
+    if (virtualClock && target > virtualNow) {
+        virtualNow = target;
+    }
+}
+
+alarm_pool_t* alarm_pool_get_default(void) {
+    return &defaultPool;
+}
+
+alarm_id_t alarm_pool_add_alarm_at(alarm_pool_t* pool, absolute_time_t time, alarm_callback_t callback,
+                                   void* user_data, bool fire_if_past) {
+    if (!fire_if_past && time_reached(time)) {
+        return 0;
+    }
+    alarm_id_t id = pool->nextId++;
+    if (pool->nextId <= 0) {
+        pool->nextId = 1;
+    }
+    pool->alarms.push_back({ id, time, callback, user_data });
+    return id;
+}
+
+bool alarm_pool_cancel_alarm(alarm_pool_t* pool, alarm_id_t alarm_id) {
+    if (alarm_id == pool->running) {
+        pool->runningCancelled = true;
+        return true;
+    }
+    for (size_t i = 0; i < pool->alarms.size(); i++) {
+        if (pool->alarms[i].id == alarm_id) {
+            pool->alarms.erase(pool->alarms.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool host_run_alarms(void) {
+    alarm_pool& pool = defaultPool;
+    bool fired = false;
+
+    while (true) {
+        size_t due = pool.alarms.size();
+        for (size_t i = 0; i < pool.alarms.size(); i++) {
+            if (pool.alarms[i].at <= get_absolute_time() &&
+                (due == pool.alarms.size() || pool.alarms[i].at < pool.alarms[due].at)) {
+                due = i;
+            }
+        }
+        if (due == pool.alarms.size()) {
+            return fired;
+        }
+
+        alarm_pool::Alarm alarm = pool.alarms[due];
+        pool.alarms.erase(pool.alarms.begin() + due);
+        pool.running = alarm.id;
+        pool.runningCancelled = false;
+        int64_t again = alarm.callback(alarm.id, alarm.user_data);
+        pool.running = 0;
+        fired = true;
+        eventFlag = true;                                                    // An IRQ ran
+
+        if (again != 0 && !pool.runningCancelled) {
+            alarm.at = again < 0 ? delayed_by_us(alarm.at, (uint64_t)-again)
+                                 : make_timeout_time_us((uint64_t)again);
+            pool.alarms.push_back(alarm);
+        }
+    }
+}
+
+absolute_time_t host_next_alarm(void) {
+    absolute_time_t next = at_the_end_of_time;
+    for (const alarm_pool::Alarm& alarm : defaultPool.alarms) {
+        if (alarm.at < next) {
+            next = alarm.at;
+        }
+    }
+    return next;
+}
+
+//-------------------------------------------------------------------------
+//  Repeating timers ride on ordinary alarms, exactly like the SDK
+//-------------------------------------------------------------------------
+static int64_t repeatingTimerCallback(alarm_id_t id, void* user_data) {
+    repeating_timer_t* rt = static_cast<repeating_timer_t*>(user_data);
+    if (rt->callback(rt)) {
+        return rt->delay_us;
+    }
+    rt->alarm_id = 0;
+    return 0;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void* user_data,
+                            repeating_timer_t* out) {
+    if (delay_us == 0) {
+        delay_us = 1;
+    }
+    out->pool = &defaultPool;
+    out->callback = callback;
+    out->delay_us = delay_us;
+    out->user_data = user_data;
+    out->alarm_id = alarm_pool_add_alarm_at(out->pool, make_timeout_time_us(delay_us < 0 ? -delay_us : delay_us),
+                                            repeatingTimerCallback, out, true);
+    return out->alarm_id > 0;
+}
+
+bool cancel_repeating_timer(repeating_timer_t* timer) {
+    bool cancelled = false;
+    if (timer->alarm_id) {
+        cancelled = alarm_pool_cancel_alarm(timer->pool, timer->alarm_id);
+        timer->alarm_id = 0;
+    }
+    return cancelled;
+}
+
+//-------------------------------------------------------------------------
+//  Sleeping: wake for each alarm on the way so callbacks run on time.
+//  With the virtual clock a sleep is a jump to its end.
+//-------------------------------------------------------------------------
+static void sleepFor(absolute_time_t until) {
+    if (virtualClock) {
+        host_time_advance_to(until);
+        return;
+    }
+    static constexpr int64_t MAX_SLICE_US = 100000;                         // Callers loop; keeps durations sane
+    int64_t us = absolute_time_diff_us(get_absolute_time(), until);
+    if (us > MAX_SLICE_US) {
+        us = MAX_SLICE_US;
+    }
+    if (us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+void host_wait_until(absolute_time_t target) {
+    host_run_alarms();
+    while (!time_reached(target)) {
+        absolute_time_t next = host_next_alarm();
+        sleepFor(next < target ? next : target);
+        host_run_alarms();
+    }
+}
+
+void sleep_until(absolute_time_t target) {
+    host_wait_until(target);
+}
+
+void sleep_us(uint64_t us) {
+    host_wait_until(make_timeout_time_us(us));
+}
+
+void sleep_ms(uint32_t ms) {
+    host_wait_until(make_timeout_time_ms(ms));
+}
+
+//-------------------------------------------------------------------------
+//  Event register and WFE
+//-------------------------------------------------------------------------
+void host_signal_event(void) {
+    eventFlag = true;
+}
+
+bool host_event_pending(void) {
+    return eventFlag;
+}
+
+bool host_take_event(void) {
+    bool was = eventFlag;
+    eventFlag = false;
+    return was;
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+    host_run_alarms();
+    while (!host_take_event() && !time_reached(timeout_timestamp)) {
+        absolute_time_t next = host_next_alarm();
+        sleepFor(next < timeout_timestamp ? next : timeout_timestamp);
+        host_run_alarms();
+    }
+    return time_reached(timeout_timestamp);
+}
+
+void __sev(void) {
+    host_signal_event();
+}
+
+void __wfe(void) {
+    best_effort_wfe_or_timeout(host_next_alarm());
+}
+
+void __wfi(void) {
+    __wfe();
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    return 0;
+}
+
+void restore_interrupts(uint32_t status) {
+    (void)status;
+}
+
+//-------------------------------------------------------------------------
+//  Random numbers: xorshift64*, fixed seed
+//-------------------------------------------------------------------------
+void host_rand_seed(uint64_t seed) {
+    randState = seed ? seed : 1;
+}
+
+uint64_t get_rand_64(void) {
+    randState ^= randState >> 12;
+    randState ^= randState << 25;
+    randState ^= randState >> 27;
+    return randState * 0x2545f4914f6cdd1dull;
+}
+
+uint32_t get_rand_32(void) {
+    return (uint32_t)(get_rand_64() >> 32);
+}
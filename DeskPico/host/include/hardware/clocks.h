@@ -0,0 +1,25 @@
+/*
+ * hardware/clocks.h (host stand-in)
+ * Fixed 125 MHz system clock.
+ */
+
+#ifndef HOST_HARDWARE_CLOCKS_H
+#define HOST_HARDWARE_CLOCKS_H
+
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum clock_index { clk_gpout0 = 0, clk_ref = 4, clk_sys = 5, clk_peri = 6 };
+
+static inline uint32_t clock_get_hz(enum clock_index clk_index) {
+    return clk_index == clk_ref ? 12000000u : 125000000u;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
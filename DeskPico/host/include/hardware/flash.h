@@ -0,0 +1,34 @@
+/*
+ * hardware/flash.h (host stand-in)
+ * The flash chip is an array, read through XIP_BASE like the memory-mapped
+ * flash on the board. It starts erased; programming can only clear bits,
+ * so a write without the erase before it shows up as corrupt data.
+ */
+
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+
+#include "pico/types.h"
+
+#define FLASH_PAGE_SIZE             (1u << 8)
+#define FLASH_SECTOR_SIZE           (1u << 12)
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES       (2 * 1024 * 1024)   /* Pico W */
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE                    ((uintptr_t)host_flash)
+
+/* Offsets and counts must be whole sectors and pages, as on the chip */
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * hardware/irq.h (host stand-in)
+ * NVIC numbers and enables (enables are accepted and ignored).
+ */
+
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+#include "pico/types.h"
+#include "hardware/gpio.h"
+
+#define IO_IRQ_BANK0                13
+#define SIO_IRQ_PROC0               15
+#define SIO_IRQ_PROC1               16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline void irq_set_enabled(uint num, bool enabled) { (void)num; (void)enabled; }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
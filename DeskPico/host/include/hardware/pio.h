@@ -0,0 +1,81 @@
+/*
+ * hardware/pio.h (host stand-in)
+ * PIO blocks with instruction memory and state-machine claims; words written
+ * to a TX FIFO (directly or by DMA) reach the host PIO recorder.
+ */
+
+#ifndef HOST_HARDWARE_PIO_H
+#define HOST_HARDWARE_PIO_H
+
+#include "pico/types.h"
+#include "hardware/gpio.h"
+
+#define NUM_PIOS                    2
+#define NUM_PIO_STATE_MACHINES      4
+#define PIO_INSTRUCTION_COUNT       32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pio_hw {
+    volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t pio0_hw_inst;
+extern pio_hw_t pio1_hw_inst;
+
+#define pio0                        (&pio0_hw_inst)
+#define pio1                        (&pio1_hw_inst)
+
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef struct {
+    uint32_t clkdiv;
+    uint32_t execctrl;
+    uint32_t shiftctrl;
+    uint32_t pinctrl;
+} pio_sm_config;
+
+enum pio_fifo_join { PIO_FIFO_JOIN_NONE = 0, PIO_FIFO_JOIN_TX = 1, PIO_FIFO_JOIN_RX = 2 };
+
+static inline PIO pio_get_instance(uint instance) { return instance ? pio1 : pio0; }
+static inline uint pio_get_index(PIO pio) { return pio == pio1 ? 1 : 0; }
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) { return pio_get_index(pio) * 8 + (is_tx ? 0 : 4) + sm; }
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void pio_remove_program(PIO pio, const pio_program_t *program, uint loaded_offset);
+
+void pio_sm_claim(PIO pio, uint sm);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+bool pio_sm_is_claimed(PIO pio, uint sm);
+
+void pio_gpio_init(PIO pio, uint pin);
+int pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pins_base, uint pin_count, bool is_out);
+int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+
+static inline pio_sm_config pio_get_default_sm_config(void) { pio_sm_config c = {0, 0, 0, 0}; return c; }
+static inline void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap) { c->execctrl = (wrap_target << 7) | (wrap << 12); }
+static inline void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs) { (void)c; (void)bit_count; (void)optional; (void)pindirs; }
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) { c->pinctrl = sideset_base; }
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold) {
+    c->shiftctrl = (shift_right ? 1u : 0u) | (autopull ? 2u : 0u) | (pull_threshold << 8);
+}
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) { (void)c; (void)join; }
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div) { c->clkdiv = (uint32_t)(div * 256.0f); }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * hardware/pwm.h (host stand-in)
+ * PWM slice settings are kept per slice and reported to the host PWM
+ * recorder whenever the output changes.
+ */
+
+#ifndef HOST_HARDWARE_PWM_H
+#define HOST_HARDWARE_PWM_H
+
+#include "pico/types.h"
+
+#define NUM_PWM_SLICES              8
+#define PWM_CHAN_A                  0
+#define PWM_CHAN_B                  1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1u) & 7u; }
+static inline uint pwm_gpio_to_channel(uint gpio) { return gpio & 1u; }
+
+void pwm_set_clkdiv(uint slice_num, float divider);
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract);
+void pwm_set_wrap(uint slice_num, uint16_t wrap);
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+void pwm_set_enabled(uint slice_num, bool enabled);
+void pwm_set_counter(uint slice_num, uint16_t c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,11 @@
+/*
+ * hardware/structs/rosc.h (host stand-in)
+ * Register structs are not modelled on the host.
+ */
+
+#ifndef HOST_HARDWARE_STRUCTS_ROSC_H
+#define HOST_HARDWARE_STRUCTS_ROSC_H
+
+
+
+#endif
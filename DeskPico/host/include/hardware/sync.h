@@ -0,0 +1,27 @@
+/*
+ * hardware/sync.h (host stand-in)
+ * Barriers, events and interrupt masking. The host is single-threaded, so
+ * these only feed the host event flag.
+ */
+
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void __sev(void);
+void __wfe(void);
+void __wfi(void);
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,11 @@
+/*
+ * lwip/altcp_tcp.h (host stand-in)
+ * Not used on the host.
+ */
+
+#ifndef HOST_LWIP_ALTCP_TCP_H
+#define HOST_LWIP_ALTCP_TCP_H
+
+#include "lwip/err.h"
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * lwip/altcp_tls.h (host stand-in)
+ * Configs and the session calls (tls-session.patch included), enough for
+ * MqttClient.c built with MQTT_TLS. Nothing is encrypted: HostMqtt.cpp
+ * only models which session a handshake ends up with, and only against
+ * the loopback broker.
+ */
+
+#ifndef HOST_LWIP_ALTCP_TLS_H
+#define HOST_LWIP_ALTCP_TLS_H
+
+#include <stddef.h>
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct altcp_pcb;
+struct altcp_tls_config;
+struct altcp_tls_session;
+
+struct altcp_tls_config *altcp_tls_create_config_client(const u8_t *cert, size_t cert_len);
+struct altcp_tls_config *altcp_tls_create_config_client_2wayauth(const u8_t *ca, size_t ca_len,
+                                                                 const u8_t *privkey, size_t privkey_len,
+                                                                 const u8_t *privkey_pass, size_t privkey_pass_len,
+                                                                 const u8_t *cert, size_t cert_len);
+void altcp_tls_free_config(struct altcp_tls_config *conf);
+void altcp_tls_set_server_name(struct altcp_tls_config *config, const char *server_name);  /* mqtt-sni.patch */
+
+struct altcp_tls_session *altcp_tls_alloc_session(void);
+void altcp_tls_free_session(struct altcp_tls_session *session);                             /* NULL is fine */
+err_t altcp_tls_get_session(struct altcp_pcb *conn, struct altcp_tls_session *session);
+err_t altcp_tls_set_session(struct altcp_pcb *conn, struct altcp_tls_session *session);
+err_t altcp_tls_session_save(const struct altcp_tls_session *session, u8_t *buf, size_t len, size_t *olen);
+err_t altcp_tls_session_load(struct altcp_tls_session *session, const u8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
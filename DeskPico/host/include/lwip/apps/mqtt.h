@@ -0,0 +1,89 @@
+/*
+ * lwip/apps/mqtt.h (host stand-in)
+ * The lwIP MQTT client API, implemented over POSIX sockets by HostMqtt.cpp
+ * (MQTT 3.1.1, QoS 0/1, no TLS).
+ */
+
+#ifndef HOST_LWIP_APPS_MQTT_H
+#define HOST_LWIP_APPS_MQTT_H
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+#define MQTT_PORT                   1883
+#define MQTT_DATA_FLAG_LAST         1
+#ifndef MQTT_VAR_HEADER_BUFFER_LEN
+#define MQTT_VAR_HEADER_BUFFER_LEN  128         /* Payload fragment size handed to the data callback */
+#endif
+#ifndef MQTT_OUTPUT_RINGBUF_SIZE
+#define MQTT_OUTPUT_RINGBUF_SIZE    1024        /* As in lwipopts.h; a packet that does not fit: ERR_MEM */
+#endif
+#ifndef MQTT_REQ_MAX_IN_FLIGHT
+#define MQTT_REQ_MAX_IN_FLIGHT      4           /* Publishes and (un)subscribes awaiting completion; more: ERR_MEM */
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mqtt_client_s mqtt_client_t;
+struct altcp_tls_config;
+
+typedef enum {
+    MQTT_CONNECT_ACCEPTED                 = 0,
+    MQTT_CONNECT_REFUSED_PROTOCOL_VERSION = 1,
+    MQTT_CONNECT_REFUSED_IDENTIFIER       = 2,
+    MQTT_CONNECT_REFUSED_SERVER           = 3,
+    MQTT_CONNECT_REFUSED_USERNAME_PASS    = 4,
+    MQTT_CONNECT_REFUSED_NOT_AUTHORIZED_  = 5,
+    MQTT_CONNECT_DISCONNECTED             = 256,
+    MQTT_CONNECT_TIMEOUT                  = 257,
+} mqtt_connection_status_t;
+
+typedef void (*mqtt_connection_cb_t)(mqtt_client_t *client, void *arg, mqtt_connection_status_t status);
+typedef void (*mqtt_incoming_publish_cb_t)(void *arg, const char *topic, u32_t tot_len);
+typedef void (*mqtt_incoming_data_cb_t)(void *arg, const u8_t *data, u16_t len, u8_t flags);
+typedef void (*mqtt_request_cb_t)(void *arg, err_t err);
+
+struct mqtt_connect_client_info_t {
+    const char *client_id;
+    const char *client_user;
+    const char *client_pass;
+    u16_t keep_alive;
+    const char *will_topic;
+    const char *will_msg;
+    u16_t will_msg_len;
+    u8_t will_qos;
+    u8_t will_retain;
+    u8_t keep_session;                          /* mqtt-session.patch: resume the broker-side session */
+    struct altcp_tls_config *tls_config;
+};
+
+mqtt_client_t *mqtt_client_new(void);
+void mqtt_client_free(mqtt_client_t *client);
+err_t mqtt_client_connect(mqtt_client_t *client, const ip_addr_t *ipaddr, u16_t port, mqtt_connection_cb_t cb,
+                          void *arg, const struct mqtt_connect_client_info_t *client_info);
+void mqtt_disconnect(mqtt_client_t *client);
+u8_t mqtt_client_is_connected(mqtt_client_t *client);
+u8_t mqtt_client_session_present(mqtt_client_t *client);  /* mqtt-session.patch: from the last CONNACK */
+void mqtt_set_inpub_callback(mqtt_client_t *client, mqtt_incoming_publish_cb_t pub_cb,
+                             mqtt_incoming_data_cb_t data_cb, void *arg);
+/* From mqtt-inpub-info.patch: packet id and fixed header flags of the
+ * incoming publish, valid from the publish callback to its last fragment */
+#define MQTT_INPUB_FLAG_DUP    0x08
+#define MQTT_INPUB_FLAG_QOS    0x06
+#define MQTT_INPUB_FLAG_RETAIN 0x01
+
+void mqtt_get_inpub_info(mqtt_client_t *client, u16_t *pkt_id, u8_t *flags);
+err_t mqtt_sub_unsub(mqtt_client_t *client, const char *topic, u8_t qos, mqtt_request_cb_t cb, void *arg, u8_t sub);
+err_t mqtt_publish(mqtt_client_t *client, const char *topic, const void *payload, u16_t payload_length,
+                   u8_t qos, u8_t retain, mqtt_request_cb_t cb, void *arg);
+
+#define mqtt_subscribe(client, topic, qos, cb, arg)   mqtt_sub_unsub(client, topic, qos, cb, arg, 1)
+#define mqtt_unsubscribe(client, topic, cb, arg)      mqtt_sub_unsub(client, topic, 0, cb, arg, 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * lwip/apps/mqtt_priv.h (host stand-in)
+ * Of the client internals only conn, which the altcp_tls session calls
+ * take; the rest is private to HostMqtt.cpp.
+ */
+
+#ifndef HOST_LWIP_APPS_MQTT_PRIV_H
+#define HOST_LWIP_APPS_MQTT_PRIV_H
+
+#include "lwip/err.h"
+
+struct altcp_pcb;
+
+struct mqtt_client_s {
+    struct altcp_pcb *conn;
+};
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * lwip/dns.h (host stand-in)
+ * Resolved synchronously with getaddrinfo(); always ERR_OK or ERR_ARG.
+ */
+
+#ifndef HOST_LWIP_DNS_H
+#define HOST_LWIP_DNS_H
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
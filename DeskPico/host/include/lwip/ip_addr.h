@@ -0,0 +1,29 @@
+/*
+ * lwip/ip_addr.h (host stand-in)
+ * IPv4 only, address in network byte order like lwIP.
+ */
+
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ip4_addr {
+    u32_t addr;
+} ip4_addr_t;
+
+typedef ip4_addr_t ip_addr_t;
+
+char *ip4addr_ntoa(const ip4_addr_t *addr);
+#define ipaddr_ntoa(addr) ip4addr_ntoa(addr)
+#define ip_addr_set_zero(ipaddr) ((ipaddr)->addr = 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
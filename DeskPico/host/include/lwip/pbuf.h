@@ -0,0 +1,11 @@
+/*
+ * lwip/pbuf.h (host stand-in)
+ * Not used on the host.
+ */
+
+#ifndef HOST_LWIP_PBUF_H
+#define HOST_LWIP_PBUF_H
+
+#include "lwip/err.h"
+
+#endif
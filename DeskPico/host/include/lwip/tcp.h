@@ -0,0 +1,11 @@
+/*
+ * lwip/tcp.h (host stand-in)
+ * Not used on the host.
+ */
+
+#ifndef HOST_LWIP_TCP_H
+#define HOST_LWIP_TCP_H
+
+#include "lwip/err.h"
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * pico/cyw43_arch.h (host stand-in)
+ * WiFi is always "up" on the host; polling services the MQTT socket and
+ * the alarm list.
+ */
+
+#ifndef HOST_PICO_CYW43_ARCH_H
+#define HOST_PICO_CYW43_ARCH_H
+
+#include "pico/types.h"
+#include "pico/time.h"
+#include "pico/async_context.h"
+
+#define CYW43_AUTH_OPEN             0
+#define CYW43_AUTH_WPA2_AES_PSK     0x00400004
+#define CYW43_ITF_STA               0
+#define CYW43_LINK_DOWN             0
+#define CYW43_LINK_JOIN             1
+#define CYW43_LINK_NOIP             2
+#define CYW43_LINK_UP               3
+#define CYW43_LINK_FAIL             (-1)
+#define CYW43_LINK_NONET            (-2)
+#define CYW43_LINK_BADAUTH          (-3)
+#define CYW43_PIN_WL_HOST_WAKE      24          /* cyw43_arch_init() claims its raw GPIO IRQ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _cyw43_t {
+    uint8_t mac[6];
+} cyw43_t;
+
+extern cyw43_t cyw43_state;
+
+int cyw43_arch_init(void);
+void cyw43_arch_deinit(void);
+void cyw43_arch_enable_sta_mode(void);
+int cyw43_arch_wifi_connect_timeout_ms(const char *ssid, const char *pw, uint32_t auth, uint32_t timeout);
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth);
+void cyw43_arch_poll(void);
+void cyw43_arch_wait_for_work_until(absolute_time_t until);
+async_context_t *cyw43_arch_async_context(void);
+static inline void cyw43_arch_lwip_begin(void) {}
+static inline void cyw43_arch_lwip_end(void) {}
+
+int cyw43_tcpip_link_status(cyw43_t *self, int itf);
+int cyw43_wifi_get_mac(cyw43_t *self, int itf, uint8_t mac[6]);
+int cyw43_wifi_get_rssi(cyw43_t *self, int32_t *rssi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,19 @@
+/*
+ * pico/error.h (host stand-in)
+ * SDK return codes.
+ */
+
+#ifndef HOST_PICO_ERROR_H
+#define HOST_PICO_ERROR_H
+
+enum pico_error_codes {
+    PICO_OK = 0,
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_GENERIC = -1,
+    PICO_ERROR_TIMEOUT = -2,
+    PICO_ERROR_NO_DATA = -3,
+    PICO_ERROR_NOT_PERMITTED = -4,
+    PICO_ERROR_INVALID_ARG = -5,
+};
+
+#endif
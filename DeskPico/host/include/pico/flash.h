@@ -0,0 +1,22 @@
+/*
+ * pico/flash.h (host stand-in)
+ * Nothing else runs from flash on the host, so the function runs at once.
+ */
+
+#ifndef HOST_PICO_FLASH_H
+#define HOST_PICO_FLASH_H
+
+#include "pico/types.h"
+#include "pico/error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
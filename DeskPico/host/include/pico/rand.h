@@ -0,0 +1,23 @@
+/*
+ * pico/rand.h (host stand-in)
+ * A fixed-seed generator, so host runs (and trace replays) are repeatable.
+ * host_rand_seed() in HostHal.h picks another sequence.
+ */
+
+#ifndef HOST_PICO_RAND_H
+#define HOST_PICO_RAND_H
+
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t get_rand_32(void);
+uint64_t get_rand_64(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * pico/stdlib.h (host stand-in)
+ * Pulls in the usual SDK pieces plus the Pico W board pin defaults.
+ */
+
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/types.h"
+#include "pico/time.h"
+#include "pico/sync.h"
+#include "hardware/gpio.h"
+
+#define PICO_DEFAULT_I2C            0
+#define PICO_DEFAULT_I2C_SDA_PIN    4
+#define PICO_DEFAULT_I2C_SCL_PIN    5
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool stdio_init_all(void);
+void panic(const char *fmt, ...) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * pico/sync.h (host stand-in)
+ * Critical sections (no-ops on the single-threaded host).
+ */
+
+#ifndef HOST_PICO_SYNC_H
+#define HOST_PICO_SYNC_H
+
+#include "pico/types.h"
+#include "hardware/sync.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct critical_section {
+    uint32_t depth;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *crit_sec) { crit_sec->depth = 0; }
+static inline void critical_section_enter_blocking(critical_section_t *crit_sec) { crit_sec->depth++; }
+static inline void critical_section_exit(critical_section_t *crit_sec) { crit_sec->depth--; }
+static inline void critical_section_deinit(critical_section_t *crit_sec) { (void)crit_sec; }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
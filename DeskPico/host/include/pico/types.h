@@ -0,0 +1,16 @@
+/*
+ * pico/types.h (host stand-in)
+ * Basic SDK types.
+ */
+
+#ifndef HOST_PICO_TYPES_H
+#define HOST_PICO_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;                   /* Microseconds since boot */
+
+#endif
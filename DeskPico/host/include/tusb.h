@@ -0,0 +1,11 @@
+/*
+ * tusb.h (host stand-in)
+ * TinyUSB is not used on the host.
+ */
+
+#ifndef HOST_TUSB_H
+#define HOST_TUSB_H
+
+static inline void tud_task(void) {}
+
+#endif
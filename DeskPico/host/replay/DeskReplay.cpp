@@ -0,0 +1,768 @@
+//=========================================================================
+//  DeskReplay.cpp
+//  Replays a timed MQTT trace into the real firmware (MyApp, MqttClient.c
+//  and everything below them) on the host, under the virtual clock and
+//  the loopback broker, and records what the desk did: OLED frames, RGB
+//  LED colours, the red LED, the buzzer and its own publishes (telemetry
+//  and the like). Also reports, per message,
+//  how long the main loop took to take it out of the inbox and whether
+//  it was dropped on the way. Same trace in, same report out.
+//
+//  Trace lines (blank lines and # comments are skipped):
+//      <time> <topic> <payload...>      publish; {mac} becomes the board MAC
+//      <time> <topic> hex:<digits>      publish binary, e.g. a CBOR command
+//                                       (`DeskCbor encode --hex cmd=sit`)
+//      <time> @retain <topic> <payload> retained publish; also before boot
+//                                       (time 0), so the desk gets it on
+//                                       subscribing
+//      <time> @button                   press and release the desk button
+//      <time> @gpio <pin> <0|1>         drive an input pin
+//      <time> @wifi <up|down>           access point in range or not
+//      <time> @broker <up|down>         loopback broker running or not
+//      <time> @end                      stop here instead of after --tail
+//  <time> is milliseconds from boot, or seconds with a fraction taken
+//  relative to the first line, so `mosquitto_sub -v -F "%U %t %p"` output
+//  replays as recorded. Publishes are QoS 1, as the backend sends them.
+//=========================================================================
+
+#include "MyApp.h"
+#include "HostHal.h"
+#include "CborDiagnostic.h"
+#include "pico/cyw43_arch.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <vector>
+
+namespace {
+
+constexpr uint BUTTON_PIN = 10;                                              // As wired in MyApp
+constexpr uint RED_LED_PIN = 7;
+constexpr uint32_t BUTTON_HOLD_MS = 80;
+constexpr uint32_t DEFAULT_TAIL_MS = 6000;                                   // Covers the 5.3 s prompt
+constexpr int64_t LED_SETTLE_US = 60000;                                     // Colours held this long are logged
+
+constexpr uint DISPLAY_WIDTH = 128;
+constexpr uint DISPLAY_PAGES = 4;                                            // 128x32
+
+//-------------------------------------------------------------------------
+//  Trace
+//-------------------------------------------------------------------------
+enum class StepKind { Message, Retain, Button, Gpio, Wifi, Broker, End };
+
+struct TraceStep {
+    uint64_t atUs;
+    StepKind kind;
+    std::string topic;
+    std::string payload;
+    uint pin = 0;
+    bool level = false;
+    unsigned line = 0;
+};
+
+struct Options {
+    const char* trace = nullptr;
+    const char* output = nullptr;
+    const char* framesDir = nullptr;
+    uint32_t tailMs = DEFAULT_TAIL_MS;
+    bool ascii = false;
+    bool firmwareLog = false;
+    bool failOnDrop = false;
+    int64_t maxLatencyMs = -1;
+};
+
+bool parseTime(const std::string& text, double& firstSeconds, uint64_t& us) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || *end != '\0' || value < 0) {
+        return false;
+    }
+    if (text.find('.') == std::string::npos) {
+        us = (uint64_t)value * 1000;                                         // Milliseconds from boot
+        return true;
+    }
+    if (firstSeconds < 0) {
+        firstSeconds = value;
+    }
+    us = (uint64_t)((value - firstSeconds) * 1e6 + 0.5);
+    return true;
+}
+
+bool parseHex(const std::string& digits, std::string& bytes) {
+    if (digits.size() % 2 != 0 || digits.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+        return false;
+    }
+    bytes.clear();
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        bytes += (char)strtoul(digits.substr(i, 2).c_str(), nullptr, 16);
+    }
+    return true;
+}
+
+// Text payloads as they are, binary ones as CBOR diagnostic notation (or
+// hex if they are not CBOR either); long ones are cut
+std::string describePayload(const uint8_t* payload, size_t len) {
+    static constexpr size_t SHOWN = 160;
+    bool printable = std::all_of(payload, payload + len, [](uint8_t c) { return c >= 0x20 && c < 0x7f; });
+    std::string text;
+    if (printable) {
+        text.assign((const char*)payload, len);
+    }
+    else if (!cborDiagnostic(payload, len, text)) {
+        text = "hex:";
+        for (size_t i = 0; i < len; i++) {
+            char digits[3];
+            snprintf(digits, sizeof(digits), "%02x", payload[i]);
+            text += digits;
+        }
+    }
+    if (text.size() > SHOWN) {
+        text.resize(SHOWN);
+        text += "...";
+    }
+    return text;
+}
+
+bool loadTrace(const char* path, std::vector<TraceStep>& steps) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "DeskReplay: cannot open %s\n", path);
+        return false;
+    }
+    std::string line;
+    unsigned number = 0;
+    double firstSeconds = -1;
+    while (std::getline(in, line)) {
+        number++;
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::istringstream fields(line.substr(start));
+        std::string time;
+        TraceStep step;
+        step.line = number;
+        fields >> time >> step.topic;
+        if (step.topic.empty() || !parseTime(time, firstSeconds, step.atUs)) {
+            fprintf(stderr, "%s:%u: expected \"<time> <topic> <payload>\"\n", path, number);
+            return false;
+        }
+        if (step.topic == "@button") {
+            step.kind = StepKind::Button;
+        }
+        else if (step.topic == "@gpio") {
+            int level = -1;
+            step.kind = StepKind::Gpio;
+            if (!(fields >> step.pin >> level) || (level != 0 && level != 1)) {
+                fprintf(stderr, "%s:%u: expected \"@gpio <pin> <0|1>\"\n", path, number);
+                return false;
+            }
+            step.level = level;
+        }
+        else if (step.topic == "@wifi" || step.topic == "@broker") {
+            std::string state;
+            step.kind = step.topic == "@wifi" ? StepKind::Wifi : StepKind::Broker;
+            if (!(fields >> state) || (state != "up" && state != "down")) {
+                fprintf(stderr, "%s:%u: expected \"%s <up|down>\"\n", path, number, step.topic.c_str());
+                return false;
+            }
+            step.level = state == "up";
+        }
+        else if (step.topic == "@end") {
+            step.kind = StepKind::End;
+        }
+        else {
+            step.kind = StepKind::Message;
+            if (step.topic == "@retain") {
+                step.kind = StepKind::Retain;
+                if (!(fields >> step.topic)) {
+                    fprintf(stderr, "%s:%u: expected \"@retain <topic> <payload>\"\n", path, number);
+                    return false;
+                }
+            }
+            std::getline(fields >> std::ws, step.payload);
+            if (step.payload.rfind("hex:", 0) == 0 && !parseHex(step.payload.substr(4), step.payload)) {
+                fprintf(stderr, "%s:%u: bad hex payload\n", path, number);
+                return false;
+            }
+        }
+        steps.push_back(step);
+    }
+    std::stable_sort(steps.begin(), steps.end(),
+                     [](const TraceStep& a, const TraceStep& b) { return a.atUs < b.atUs; });
+    return true;
+}
+
+//-------------------------------------------------------------------------
+//  Recorder state
+//-------------------------------------------------------------------------
+enum class Fate { Pending, Handled, Unrouted, InboxFull, Discarded };
+
+struct Delivery {
+    size_t step;
+    uint64_t atUs;                                                           // Virtual time it reached the client
+    uint32_t seq;                                                            // Inbox slot sequence number
+    Fate fate;
+    uint64_t latencyUs = 0;                                                  // Trace time to leaving the inbox
+    double hostUs = 0;                                                       // Wall time for the same span
+    std::chrono::steady_clock::time_point hostAt;
+};
+
+struct LogEntry {
+    uint64_t atUs;
+    std::string text;
+};
+
+struct Recorder {
+    Options options;
+    std::vector<TraceStep> steps;
+    size_t nextStep = 0;
+    uint64_t endUs = 0;
+    MyApp* app = nullptr;
+    char mac[18] = {};
+
+    FILE* report = stdout;
+    std::vector<Delivery> deliveries;
+    std::vector<LogEntry> log;
+    alarm_id_t alarm = 0;
+    async_when_pending_worker_t worker = {};
+
+    // SSD1306 model
+    uint8_t gddram[8][DISPLAY_WIDTH] = {};
+    uint8_t page = 0;
+    uint8_t column = 0;
+    uint8_t colStart = 0;
+    uint8_t colEnd = DISPLAY_WIDTH - 1;
+    uint8_t pageStart = 0;
+    uint8_t pageEnd = 7;
+    uint8_t memMode = 2;                                                     // Page addressing after reset
+    uint8_t command[8] = {};
+    size_t commandLen = 0;
+    size_t commandNeed = 0;
+    bool displayDirty = false;
+    std::vector<std::vector<uint8_t>> frames;                                // Distinct frames, in first-seen order
+    size_t frameCount = 0;
+    int lastFrame = -1;
+
+    // Outputs
+    uint32_t ledWord = 0;
+    uint64_t ledChangedUs = 0;
+    bool ledLogged = true;
+    uint32_t ledLoggedWord = 0;
+    size_t ledWrites = 0;
+    bool buzzing = false;
+    uint32_t buzzHz = 0;
+    size_t buzzEvents = 0;
+    size_t published = 0;
+    size_t publishedBytes = 0;
+};
+
+Recorder rec;
+
+uint64_t nowUs() {
+    return to_us_since_boot(get_absolute_time()) - 1000;                     // Trace time 0 is boot
+}
+
+void logAt(uint64_t atUs, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void logAt(uint64_t atUs, const char* fmt, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    rec.log.push_back({ atUs, text });
+}
+
+//-------------------------------------------------------------------------
+//  OLED: an SSD1306 fed from the I2C writes
+//-------------------------------------------------------------------------
+size_t commandArgs(uint8_t cmd) {
+    switch (cmd) {
+    case 0x21: case 0x22: case 0xa3:              return 2;
+    case 0x26: case 0x27:                         return 6;
+    case 0x29: case 0x2a:                         return 5;
+    case 0x20: case 0x81: case 0x8d: case 0xa8:
+    case 0xd3: case 0xd5: case 0xd9: case 0xda:
+    case 0xdb:                                    return 1;
+    default:                                      return 0;
+    }
+}
+
+void runCommand(const uint8_t* c) {
+    if (c[0] == 0x20) {
+        rec.memMode = c[1] & 3;
+    }
+    else if (c[0] == 0x21) {
+        rec.colStart = rec.column = c[1] & 0x7f;
+        rec.colEnd = c[2] & 0x7f;
+    }
+    else if (c[0] == 0x22) {
+        rec.pageStart = rec.page = c[1] & 7;
+        rec.pageEnd = c[2] & 7;
+    }
+    else if (c[0] >= 0xb0 && c[0] <= 0xb7) {
+        rec.page = c[0] & 7;
+    }
+    else if (c[0] <= 0x0f) {
+        rec.column = (rec.column & 0xf0) | c[0];
+    }
+    else if (c[0] <= 0x1f) {
+        rec.column = (uint8_t)((rec.column & 0x0f) | (c[0] & 0x0f) << 4);
+    }
+}
+
+void writeData(uint8_t byte) {
+    rec.gddram[rec.page & 7][rec.column & 0x7f] = byte;
+    rec.displayDirty = true;
+    if (rec.memMode == 2) {                                                  // Page mode: wrap within the page
+        rec.column = (rec.column + 1) & 0x7f;
+        return;
+    }
+    if (rec.column++ >= rec.colEnd) {
+        rec.column = rec.colStart;
+        rec.page = rec.page >= rec.pageEnd ? rec.pageStart : rec.page + 1;
+    }
+}
+
+void onI2c(uint bus, uint8_t addr, const uint8_t* src, size_t len) {
+    (void)bus;
+    if (addr != SSD1306_I2C_ADDR || len == 0) {
+        return;
+    }
+    if (src[0] == SSD1306_CTRL_DATA) {
+        for (size_t i = 1; i < len; i++) {
+            writeData(src[i]);
+        }
+        return;
+    }
+    for (size_t i = 1; i < len; i++) {                                       // Command stream
+        rec.command[rec.commandLen++] = src[i];
+        if (rec.commandLen == 1) {
+            rec.commandNeed = 1 + commandArgs(src[i]);
+        }
+        if (rec.commandLen == rec.commandNeed) {
+            runCommand(rec.command);
+            rec.commandLen = 0;
+        }
+    }
+}
+
+// Pixel in OLEDDisplay's frame-buffer orientation: render() sends the
+// pages bottom-up, so GDDRAM rows are flipped back here
+bool pixel(const std::vector<uint8_t>& frame, uint x, uint y) {
+    uint row = DISPLAY_PAGES * 8 - 1 - y;
+    return frame[(row / 8) * DISPLAY_WIDTH + x] >> (row % 8) & 1;
+}
+
+void writePbm(const std::vector<uint8_t>& frame, size_t index) {
+    std::string path = std::string(rec.options.framesDir) + "/frame-" + std::to_string(index) + ".pbm";
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        fprintf(stderr, "DeskReplay: cannot write %s\n", path.c_str());
+        return;
+    }
+    fprintf(f, "P1\n%u %u\n", DISPLAY_WIDTH, DISPLAY_PAGES * 8);
+    for (uint y = 0; y < DISPLAY_PAGES * 8; y++) {
+        for (uint x = 0; x < DISPLAY_WIDTH; x++) {
+            fputc(pixel(frame, x, y) ? '1' : '0', f);
+        }
+        fputc('\n', f);
+    }
+    fclose(f);
+}
+
+// A frame is whatever the panel shows when the main loop reaches a poll point
+void captureFrame() {
+    if (!rec.displayDirty) {
+        return;
+    }
+    rec.displayDirty = false;
+    std::vector<uint8_t> frame(&rec.gddram[0][0], &rec.gddram[0][0] + DISPLAY_PAGES * DISPLAY_WIDTH);
+    auto seen = std::find(rec.frames.begin(), rec.frames.end(), frame);
+    int index = (int)(seen - rec.frames.begin());
+    if (index == rec.lastFrame) {
+        return;                                                              // Redrawn, not changed
+    }
+    rec.frameCount++;
+    rec.lastFrame = index;
+    if (seen == rec.frames.end()) {
+        rec.frames.push_back(frame);
+        if (rec.options.framesDir) {
+            writePbm(frame, index);
+        }
+        logAt(nowUs(), "oled  frame %d (new)", index);
+    }
+    else {
+        logAt(nowUs(), "oled  frame %d", index);
+    }
+    if (rec.options.ascii) {
+        for (uint y = 0; y < DISPLAY_PAGES * 8; y++) {
+            std::string row = "      |";
+            for (uint x = 0; x < DISPLAY_WIDTH; x++) {
+                row += pixel(frame, x, y) ? '#' : ' ';
+            }
+            logAt(nowUs(), "%s|", row.c_str());
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+//  RGB LED (WS2812 words, GRB in the top 24 bits), red LED and buzzer
+//-------------------------------------------------------------------------
+void logLedIfSettled(uint64_t now) {
+    if (!rec.ledLogged && now - rec.ledChangedUs >= (uint64_t)LED_SETTLE_US) {
+        rec.ledLogged = true;
+        if (rec.ledWord != rec.ledLoggedWord) {
+            rec.ledLoggedWord = rec.ledWord;
+            logAt(rec.ledChangedUs, "led   #%02x%02x%02x", (rec.ledWord >> 16) & 0xff, rec.ledWord >> 24,
+                  (rec.ledWord >> 8) & 0xff);
+        }
+    }
+}
+
+void onPio(uint pio, uint sm, uint32_t word) {
+    (void)pio;
+    (void)sm;
+    rec.ledWrites++;
+    if (word == rec.ledWord) {
+        return;
+    }
+    logLedIfSettled(nowUs());
+    rec.ledWord = word;
+    rec.ledChangedUs = nowUs();
+    rec.ledLogged = false;
+}
+
+void onGpio(uint gpio, bool level) {
+    if (gpio == RED_LED_PIN) {
+        logAt(nowUs(), "red   %s", level ? "on" : "off");
+    }
+}
+
+void onPwm(uint slice, bool enabled, uint32_t frequency_hz, uint16_t level, uint16_t wrap) {
+    (void)slice;
+    (void)wrap;
+    bool on = enabled && level > 0;
+    if (on == rec.buzzing && (!on || frequency_hz == rec.buzzHz)) {
+        return;
+    }
+    rec.buzzing = on;
+    rec.buzzHz = on ? frequency_hz : 0;
+    rec.buzzEvents++;
+    if (on) {
+        logAt(nowUs(), "buzz  %u Hz", frequency_hz);
+    }
+    else {
+        logAt(nowUs(), "buzz  off");
+    }
+}
+
+// What the desk sends to the broker
+void onPublish(const char* topic, const uint8_t* payload, size_t len, uint8_t qos, bool retain) {
+    rec.published++;
+    rec.publishedBytes += len;
+    logAt(nowUs(), "tx    %s%s%s %s", topic, qos ? " qos1" : "", retain ? " retained" : "",
+          describePayload(payload, len).c_str());
+}
+
+//-------------------------------------------------------------------------
+//  Inbox bookkeeping: a delivery is handled once the app releases its slot
+//-------------------------------------------------------------------------
+void checkInbox() {
+    const message_queue_t& inbox = rec.app->client()->inbox;
+    uint32_t head = __atomic_load_n(&inbox.head, __ATOMIC_ACQUIRE);
+    for (Delivery& d : rec.deliveries) {
+        if (d.fate == Fate::Pending && (int32_t)(head - d.seq) > 0) {
+            d.fate = Fate::Handled;
+            d.latencyUs = nowUs() - rec.steps[d.step].atUs;
+            d.hostUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - d.hostAt).count();
+        }
+    }
+}
+
+// Poll point: the main loop is between tasks
+void onPoll() {
+    if (rec.app == nullptr || rec.app->client() == nullptr) {
+        return;
+    }
+    checkInbox();
+    captureFrame();
+    logLedIfSettled(nowUs());
+}
+
+void finish();
+
+void deliver(size_t index) {
+    const TraceStep& step = rec.steps[index];
+    const message_queue_t& inbox = rec.app->client()->inbox;
+    uint32_t tail = inbox.tail;
+    uint32_t overflows = inbox.overflows;
+
+    Delivery d = { index, nowUs(), tail, Fate::Pending };
+    d.hostAt = std::chrono::steady_clock::now();
+    logAt(d.atUs, "rx    %s %s", step.topic.c_str(),
+          describePayload((const uint8_t*)step.payload.data(), step.payload.size()).c_str());
+    if (host_mqtt_deliver_qos(step.topic.c_str(), step.payload.data(), step.payload.size(), 1, 0, false) == 0) {
+        d.fate = Fate::Unrouted;
+        logAt(d.atUs, "drop  line %u: no subscriber", step.line);
+    }
+    else if (inbox.tail == tail) {
+        d.fate = inbox.overflows != overflows ? Fate::InboxFull : Fate::Discarded;
+        logAt(d.atUs, "drop  line %u: %s", step.line, d.fate == Fate::InboxFull ? "inbox full" : "discarded");
+    }
+    rec.deliveries.push_back(d);
+}
+
+void armNext();
+
+// Network context (cyw43_arch_poll): inject everything that is due
+void injectDue(async_context_t*, async_when_pending_worker_t*) {
+    uint64_t now = nowUs();
+    while (rec.nextStep < rec.steps.size() && rec.steps[rec.nextStep].atUs <= now) {
+        const TraceStep& step = rec.steps[rec.nextStep];
+        switch (step.kind) {
+        case StepKind::Message:
+            deliver(rec.nextStep);
+            break;
+        case StepKind::Retain:
+            logAt(now, "ret   %s %s", step.topic.c_str(),
+                  describePayload((const uint8_t*)step.payload.data(), step.payload.size()).c_str());
+            host_mqtt_retain(step.topic.c_str(), step.payload.data(), step.payload.size());
+            break;
+        case StepKind::Button:
+            logAt(now, "btn   press");
+            host_gpio_drive(BUTTON_PIN, false);
+            add_alarm_in_ms(BUTTON_HOLD_MS, [](alarm_id_t, void*) -> int64_t {
+                host_gpio_drive(BUTTON_PIN, true);
+                return 0;
+            }, nullptr, true);
+            break;
+        case StepKind::Gpio:
+            logAt(now, "gpio  %u = %d", step.pin, step.level);
+            host_gpio_drive(step.pin, step.level);
+            break;
+        case StepKind::Wifi:
+            logAt(now, "wifi  %s", step.level ? "up" : "down");
+            host_wifi_set_available(step.level);
+            break;
+        case StepKind::Broker:
+            logAt(now, "mqtt  broker %s", step.level ? "up" : "down");
+            host_mqtt_set_broker_up(step.level);
+            break;
+        case StepKind::End:
+            rec.endUs = now;
+            break;
+        }
+        rec.nextStep++;
+    }
+    if (now >= rec.endUs) {
+        finish();
+    }
+    armNext();
+}
+
+int64_t onStepDue(alarm_id_t, void*) {
+    rec.alarm = 0;
+    async_context_set_work_pending(cyw43_arch_async_context(), &rec.worker);
+    return 0;
+}
+
+void armNext() {
+    uint64_t at = rec.nextStep < rec.steps.size() ? std::min(rec.steps[rec.nextStep].atUs, rec.endUs) : rec.endUs;
+    if (rec.alarm == 0) {
+        rec.alarm = add_alarm_at(delayed_by_us(1000, at), onStepDue, nullptr, true);
+    }
+}
+
+//-------------------------------------------------------------------------
+//  Report
+//-------------------------------------------------------------------------
+double percentile(std::vector<uint64_t> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t i = (size_t)(p * (values.size() - 1) + 0.5);
+    return values[i] / 1000.0;
+}
+
+void finish() {
+    onPoll();
+    logLedIfSettled(at_the_end_of_time);
+
+    FILE* out = rec.report;
+    if (rec.options.output && (out = fopen(rec.options.output, "w")) == nullptr) {
+        fprintf(stderr, "DeskReplay: cannot write %s\n", rec.options.output);
+        exit(2);
+    }
+
+    std::stable_sort(rec.log.begin(), rec.log.end(),
+                     [](const LogEntry& a, const LogEntry& b) { return a.atUs < b.atUs; });
+    for (const LogEntry& entry : rec.log) {
+        fprintf(out, "%10.3f  %s\n", entry.atUs / 1000.0, entry.text.c_str());
+    }
+
+    size_t counts[5] = {};
+    std::vector<uint64_t> latencies;
+    double hostTotal = 0;
+    double hostMax = 0;
+    for (const Delivery& d : rec.deliveries) {
+        counts[(int)d.fate]++;
+        if (d.fate == Fate::Handled) {
+            latencies.push_back(d.latencyUs);
+            hostTotal += d.hostUs;
+            hostMax = std::max(hostMax, d.hostUs);
+        }
+    }
+    size_t dropped = counts[(int)Fate::Unrouted] + counts[(int)Fate::InboxFull] + counts[(int)Fate::Discarded];
+    const message_queue_t& inbox = rec.app->client()->inbox;
+    const DeskStateMachine& desk = rec.app->deskState();
+
+    fprintf(out, "\nsummary (virtual %.3f s, board %s)\n", rec.endUs / 1e6, rec.mac);
+    fprintf(out, "  messages   %zu delivered, %zu handled, %zu pending at end\n", rec.deliveries.size(),
+            counts[(int)Fate::Handled], counts[(int)Fate::Pending]);
+    fprintf(out, "  dropped    %zu (no subscriber %zu, inbox full %zu, discarded %zu)\n", dropped,
+            counts[(int)Fate::Unrouted], counts[(int)Fate::InboxFull], counts[(int)Fate::Discarded]);
+    fprintf(out, "  latency    min %.3f  p50 %.3f  p95 %.3f  max %.3f ms (virtual)\n", percentile(latencies, 0),
+            percentile(latencies, 0.5), percentile(latencies, 0.95), percentile(latencies, 1));
+    fprintf(out, "  host time  avg %.1f  max %.1f us per message\n",
+            latencies.empty() ? 0.0 : hostTotal / latencies.size(), hostMax);
+    fprintf(out, "  inbox      high water %u of %u, %u overflows\n", inbox.high_water, MESSAGE_QUEUE_LEN,
+            inbox.overflows);
+    fprintf(out, "  desk       %s, %u transitions, %u ignored\n", toString(desk.state()), desk.transitions(),
+            desk.ignored());
+    fprintf(out, "  outputs    %zu frame changes (%zu distinct), %zu LED writes, %zu buzzer changes\n",
+            rec.frameCount, rec.frames.size(), rec.ledWrites, rec.buzzEvents);
+    fprintf(out, "  published  %zu messages, %zu payload bytes\n", rec.published, rec.publishedBytes);
+    fflush(out);
+
+    bool failed = false;
+    if (rec.options.failOnDrop && (dropped > 0 || counts[(int)Fate::Pending] > 0)) {
+        fprintf(stderr, "DeskReplay: %zu dropped, %zu never handled\n", dropped, counts[(int)Fate::Pending]);
+        failed = true;
+    }
+    if (rec.options.maxLatencyMs >= 0 && percentile(latencies, 1) > rec.options.maxLatencyMs) {
+        fprintf(stderr, "DeskReplay: max latency %.3f ms over the %lld ms limit\n", percentile(latencies, 1),
+                (long long)rec.options.maxLatencyMs);
+        failed = true;
+    }
+    _exit(failed ? 1 : 0);                                                   // The firmware loop never returns
+}
+
+//-------------------------------------------------------------------------
+//  Topics and options
+//-------------------------------------------------------------------------
+void substituteMac() {
+    for (TraceStep& step : rec.steps) {
+        size_t at;
+        while ((at = step.topic.find("{mac}")) != std::string::npos) {
+            step.topic.replace(at, 5, rec.mac);
+        }
+    }
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: DeskReplay [options] <trace>\n"
+            "  -o <file>            write the report to a file\n"
+            "  --frames <dir>       save every distinct OLED frame as <dir>/frame-N.pbm\n"
+            "  --ascii              draw OLED frames in the log\n"
+            "  --tail <ms>          keep running this long after the last step (%u)\n"
+            "  --firmware-log       keep the firmware's own printf output\n"
+            "  --fail-on-drop       exit 1 if any message was dropped or never handled\n"
+            "  --max-latency <ms>   exit 1 if a message took longer than this\n",
+            DEFAULT_TAIL_MS);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-o" && hasValue) {
+            options.output = argv[++i];
+        }
+        else if (arg == "--frames" && hasValue) {
+            options.framesDir = argv[++i];
+        }
+        else if (arg == "--tail" && hasValue) {
+            options.tailMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--max-latency" && hasValue) {
+            options.maxLatencyMs = strtoll(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--ascii") {
+            options.ascii = true;
+        }
+        else if (arg == "--firmware-log") {
+            options.firmwareLog = true;
+        }
+        else if (arg == "--fail-on-drop") {
+            options.failOnDrop = true;
+        }
+        else if (arg[0] != '-' && options.trace == nullptr) {
+            options.trace = argv[i];
+        }
+        else {
+            return false;
+        }
+    }
+    return options.trace != nullptr;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv, rec.options)) {
+        usage();
+        return 2;
+    }
+    if (!loadTrace(rec.options.trace, rec.steps)) {
+        return 2;
+    }
+    rec.endUs = (rec.steps.empty() ? 0 : rec.steps.back().atUs) + (uint64_t)rec.options.tailMs * 1000;
+
+    // The firmware prints freely; keep stdout for the report unless asked
+    if (!rec.options.firmwareLog) {
+        fflush(stdout);
+        rec.report = fdopen(dup(STDOUT_FILENO), "w");
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+
+    host_time_set_virtual(true);
+    host_mqtt_set_loopback(true);
+    host_set_i2c_hook(onI2c);
+    host_set_pio_hook(onPio);
+    host_set_gpio_hook(onGpio);
+    host_set_pwm_hook(onPwm);
+    host_set_poll_hook(onPoll);
+    host_mqtt_set_publish_hook(onPublish);
+
+    static MyApp app;                                                        // Too big for comfort on the stack
+    rec.app = &app;
+
+    uint8_t mac[6];
+    cyw43_wifi_get_mac(&cyw43_state, CYW43_ITF_STA, mac);
+    snprintf(rec.mac, sizeof(rec.mac), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4],
+             mac[5]);
+    substituteMac();
+
+    rec.worker.do_work = injectDue;
+    async_context_add_when_pending_worker(cyw43_arch_async_context(), &rec.worker);
+    armNext();
+
+    app.run();
+    finish();
+}
@@ -0,0 +1,169 @@
+//=========================================================================
+//  CborDiagnostic.cpp
+//  Implementation of the diagnostic-notation printer.
+//=========================================================================
+
+#include "CborDiagnostic.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+double toDouble(const CborItem& item) {
+    if (item.size == 2) {                                                    // IEEE half
+        int exponent = (item.value >> 10) & 0x1f;
+        double mantissa = (double)(item.value & 0x3ff);
+        double value = exponent == 0    ? std::ldexp(mantissa, -24)
+                       : exponent == 31 ? (mantissa == 0 ? INFINITY : NAN)
+                                        : std::ldexp(mantissa + 1024, exponent - 25);
+        return (item.value & 0x8000) ? -value : value;
+    }
+    if (item.size == 4) {
+        uint32_t bits = (uint32_t)item.value;
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    double value;
+    memcpy(&value, &item.value, sizeof(value));
+    return value;
+}
+
+void appendText(std::string& out, const uint8_t* data, size_t length) {
+    out += '"';
+    for (size_t i = 0; i < length; i++) {
+        char c = (char)data[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((uint8_t)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+bool appendItem(CborReader& reader, const CborItem& item, std::string& out, int depth);
+
+// Children of an array (one per entry) or map (key: value)
+bool appendChildren(CborReader& reader, const CborItem& item, std::string& out, int depth) {
+    bool isMap = item.type == CborType::Map;
+    uint64_t remaining = item.value;
+    for (uint64_t n = 0; item.indefinite || n < remaining; n++) {
+        CborItem child;
+        if (!reader.next(child)) {
+            return false;
+        }
+        if (child.type == CborType::Break) {
+            return item.indefinite;
+        }
+        if (n > 0) {
+            out += ", ";
+        }
+        if (!appendItem(reader, child, out, depth + 1)) {
+            return false;
+        }
+        if (isMap) {
+            CborItem value;
+            out += ": ";
+            if (!reader.next(value) || value.type == CborType::Break || !appendItem(reader, value, out, depth + 1)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool appendItem(CborReader& reader, const CborItem& item, std::string& out, int depth) {
+    char number[32];
+    if (depth > CborReader::MAX_DEPTH) {
+        return false;
+    }
+    switch (item.type) {
+    case CborType::Unsigned:
+        snprintf(number, sizeof(number), "%llu", (unsigned long long)item.value);
+        out += number;
+        return true;
+    case CborType::Negative:
+        if (item.value == UINT64_MAX) {
+            out += "-18446744073709551616";
+        } else {
+            snprintf(number, sizeof(number), "-%llu", (unsigned long long)item.value + 1);
+            out += number;
+        }
+        return true;
+    case CborType::Bytes:
+        out += "h'";
+        for (uint64_t i = 0; i < item.value; i++) {
+            snprintf(number, sizeof(number), "%02x", item.data[i]);
+            out += number;
+        }
+        out += "'";
+        return true;
+    case CborType::Text:
+        appendText(out, item.data, (size_t)item.value);
+        return true;
+    case CborType::Array:
+    case CborType::Map: {
+        bool isMap = item.type == CborType::Map;
+        out += isMap ? "{" : "[";
+        if (item.indefinite) {
+            out += "_ ";
+        }
+        bool ok = appendChildren(reader, item, out, depth);
+        out += isMap ? "}" : "]";
+        return ok;
+    }
+    case CborType::Tag: {
+        CborItem tagged;
+        snprintf(number, sizeof(number), "%llu(", (unsigned long long)item.value);
+        out += number;
+        bool ok = reader.next(tagged) && tagged.type != CborType::Break && appendItem(reader, tagged, out, depth + 1);
+        out += ")";
+        return ok;
+    }
+    case CborType::Simple:
+        switch (item.value) {
+        case 20: out += "false"; break;
+        case 21: out += "true"; break;
+        case 22: out += "null"; break;
+        case 23: out += "undefined"; break;
+        default:
+            snprintf(number, sizeof(number), "simple(%llu)", (unsigned long long)item.value);
+            out += number;
+        }
+        return true;
+    case CborType::Float:
+        snprintf(number, sizeof(number), "%g", toDouble(item));
+        out += number;
+        return true;
+    case CborType::Break:
+        return false;                                                        // Outside an indefinite container
+    }
+    return false;
+}
+
+} // namespace
+
+bool cborDiagnostic(CborReader& reader, std::string& out) {
+    CborItem item;
+    return reader.next(item) && appendItem(reader, item, out, 0);
+}
+
+bool cborDiagnostic(const uint8_t* data, size_t size, std::string& out) {
+    CborReader reader(data, size);
+    for (bool first = true; !reader.atEnd(); first = false) {
+        if (!first) {
+            out += ", ";
+        }
+        if (!cborDiagnostic(reader, out)) {
+            return false;
+        }
+    }
+    return true;
+}
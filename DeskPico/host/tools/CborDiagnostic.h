@@ -0,0 +1,20 @@
+//=========================================================================
+//  CborDiagnostic.h
+//  CBOR in RFC 8949 diagnostic notation, for host tools and logs:
+//      {0: 4, 3: "Stand up", 5: [1000, 300, 2]}
+//=========================================================================
+
+#ifndef CBOR_DIAGNOSTIC_H
+#define CBOR_DIAGNOSTIC_H
+
+#include "Cbor.h"
+#include <string>
+
+// Appends the next item, with everything it contains, to out. False on
+// malformed or truncated input (out then ends in what could be read).
+bool cborDiagnostic(CborReader& reader, std::string& out);
+
+// Every top-level item in the buffer, separated by ", "
+bool cborDiagnostic(const uint8_t* data, size_t size, std::string& out);
+
+#endif
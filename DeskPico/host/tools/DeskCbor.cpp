@@ -0,0 +1,214 @@
+//=========================================================================
+//  DeskCbor.cpp
+//  Host side of the desk's CBOR schema (DeskMessages.h), with the same
+//  codec the firmware uses:
+//
+//      DeskCbor encode [--hex] cmd=sit [height=720] [colour=ff8800]
+//               [text="Stand up"] [until=900] [tone=1000,300,2]
+//          Writes one desk command to stdout, e.g. for
+//          `DeskCbor encode cmd=red | mosquitto_pub -t <mac>/led -s`
+//
+//      DeskCbor decode [--hex] [file]
+//          Prints the CBOR in the file (or stdin) in diagnostic notation,
+//          and the desk command it holds, if it is one. With --hex the
+//          input is hex text instead of binary.
+//=========================================================================
+
+#include "Cbor.h"
+#include "CborDiagnostic.h"
+#include "DeskMessages.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+int usage() {
+    fprintf(stderr,
+            "usage: DeskCbor encode [--hex] cmd=<word> [height=<mm>] [colour=<rrggbb>] [text=<text>]\n"
+            "                       [until=<s>] [tone=<hz>,<ms>,<repeat>]\n"
+            "       DeskCbor decode [--hex] [file]\n");
+    return 2;
+}
+
+bool parseNumber(const char* text, int base, uint64_t max, uint64_t& value) {
+    char* end = nullptr;
+    value = strtoull(text, &end, base);
+    return end != text && *end == '\0' && value <= max;
+}
+
+bool parseField(const std::string& arg, DeskMessage& message) {
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) {
+        return false;
+    }
+    std::string key = arg.substr(0, eq);
+    std::string value = arg.substr(eq + 1);
+    uint64_t n = 0;
+
+    if (key == "cmd") {
+        message.command = parseWireCommand(value);
+        return message.command != WireCommand::None;
+    }
+    if (key == "height" && parseNumber(value.c_str(), 10, UINT16_MAX, n)) {
+        message.heightMm = (uint16_t)n;
+        message.fields |= DeskMessage::HAS_HEIGHT;
+        return true;
+    }
+    if (key == "colour" && parseNumber(value.c_str(), 16, 0xffffff, n)) {
+        message.colour = (uint32_t)n;
+        message.fields |= DeskMessage::HAS_COLOUR;
+        return true;
+    }
+    if (key == "text" && value.size() <= DeskMessage::TEXT_MAX) {
+        memcpy(message.text, value.c_str(), value.size() + 1);
+        message.fields |= DeskMessage::HAS_TEXT;
+        return true;
+    }
+    if (key == "until" && parseNumber(value.c_str(), 10, UINT32_MAX, n)) {
+        message.untilS = (uint32_t)n;
+        message.fields |= DeskMessage::HAS_UNTIL;
+        return true;
+    }
+    unsigned hz = 0, ms = 0, repeat = 0;
+    char extra;
+    if (key == "tone" && sscanf(value.c_str(), "%u,%u,%u%c", &hz, &ms, &repeat, &extra) == 3
+        && hz <= UINT16_MAX && ms <= UINT16_MAX && repeat <= UINT8_MAX) {
+        message.toneHz = (uint16_t)hz;
+        message.toneMs = (uint16_t)ms;
+        message.toneRepeat = (uint8_t)repeat;
+        message.fields |= DeskMessage::HAS_TONE;
+        return true;
+    }
+    return false;
+}
+
+int encode(int argc, char** argv) {
+    DeskMessage message;
+    bool hex = false;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--hex") == 0) {
+            hex = true;
+        } else if (!parseField(argv[i], message)) {
+            fprintf(stderr, "DeskCbor: bad field \"%s\"\n", argv[i]);
+            return usage();
+        }
+    }
+
+    uint8_t out[128];
+    size_t length = encodeDeskMessage(message, out, sizeof(out));
+    if (length == 0) {
+        fprintf(stderr, "DeskCbor: message does not fit\n");
+        return 1;
+    }
+    if (hex) {
+        for (size_t i = 0; i < length; i++) {
+            printf("%02x", out[i]);
+        }
+        printf("\n");
+    } else {
+        fwrite(out, 1, length, stdout);
+    }
+    return 0;
+}
+
+bool readInput(const char* path, bool hex, std::vector<uint8_t>& data) {
+    FILE* in = path ? fopen(path, "rb") : stdin;
+    if (in == nullptr) {
+        fprintf(stderr, "DeskCbor: cannot open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> raw;
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        raw.push_back((uint8_t)c);
+    }
+    if (path) {
+        fclose(in);
+    }
+    if (!hex) {
+        data = raw;
+        return true;
+    }
+    std::string digits;
+    for (uint8_t byte : raw) {
+        if (isxdigit(byte)) {
+            digits += (char)byte;
+        }
+    }
+    if (digits.size() % 2 != 0) {
+        fprintf(stderr, "DeskCbor: odd number of hex digits\n");
+        return false;
+    }
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        data.push_back((uint8_t)strtoul(digits.substr(i, 2).c_str(), nullptr, 16));
+    }
+    return true;
+}
+
+int decode(int argc, char** argv) {
+    bool hex = false;
+    const char* path = nullptr;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--hex") == 0) {
+            hex = true;
+        } else if (path == nullptr) {
+            path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+
+    std::vector<uint8_t> data;
+    if (!readInput(path, hex, data)) {
+        return 1;
+    }
+    std::string text;
+    bool ok = cborDiagnostic(data.data(), data.size(), text);
+    printf("%s\n", text.c_str());
+    if (!ok) {
+        fprintf(stderr, "DeskCbor: malformed CBOR\n");
+        return 1;
+    }
+
+    DeskMessage message;
+    if (isDeskMessage(data.data(), data.size()) && decodeDeskMessage(data.data(), data.size(), message)
+        && message.command != WireCommand::None) {
+        printf("command %s", toString(message.command));
+        if (message.fields & DeskMessage::HAS_HEIGHT) {
+            printf(", height %u mm", message.heightMm);
+        }
+        if (message.fields & DeskMessage::HAS_COLOUR) {
+            printf(", colour #%06x", (unsigned)message.colour);
+        }
+        if (message.fields & DeskMessage::HAS_TEXT) {
+            printf(", text \"%s\"", message.text);
+        }
+        if (message.fields & DeskMessage::HAS_UNTIL) {
+            printf(", until +%u s", (unsigned)message.untilS);
+        }
+        if (message.fields & DeskMessage::HAS_TONE) {
+            printf(", tone %u Hz %u ms x%u", message.toneHz, message.toneMs, message.toneRepeat);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        return usage();
+    }
+    if (strcmp(argv[1], "encode") == 0) {
+        return encode(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "decode") == 0) {
+        return decode(argc - 2, argv + 2);
+    }
+    return usage();
+}
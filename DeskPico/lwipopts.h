@@ -90,6 +90,10 @@
 #define MQTT_DEBUG                  LWIP_DBG_OFF
 #define ALTCP_MBEDTLS_MEM_DEBUG     LWIP_DBG_OFF
 
+// MQTT: room for a telemetry batch (MyApp::TelemetryTask) next to the
+// default 256 bytes of commands and pings
+#define MQTT_OUTPUT_RINGBUF_SIZE 1024
+
 #define LWIP_ALTCP               1
 #define LWIP_ALTCP_TLS           1
 #define LWIP_ALTCP_TLS_MBEDTLS   1
@@ -0,0 +1,45 @@
+#include "Backoff.h"
+#include <gtest/gtest.h>
+
+TEST(BackoffTests, DelayDoublesUpToTheCap) {
+    Backoff backoff(1000, 8000);
+
+    EXPECT_EQ(backoff.next(500), 1000u);                                     // Top of each jitter range
+    EXPECT_EQ(backoff.next(1000), 2000u);
+    EXPECT_EQ(backoff.next(2000), 4000u);
+    EXPECT_EQ(backoff.next(4000), 8000u);
+    EXPECT_EQ(backoff.next(4000), 8000u);
+    EXPECT_EQ(backoff.attempts(), 5u);
+}
+
+TEST(BackoffTests, JitterStaysInTheUpperHalf) {
+    Backoff backoff(1000, 60000);
+    for (int i = 0; i < 4; i++) {
+        backoff.next(0);
+    }
+
+    for (uint32_t random : { 0u, 1u, 4000u, 4001u, 123456789u, UINT32_MAX }) {
+        Backoff probe = backoff;
+        uint32_t delay = probe.next(random);
+        EXPECT_GE(delay, 8000u);
+        EXPECT_LE(delay, 16000u);
+    }
+}
+
+TEST(BackoffTests, Reset_StartsOverFromTheBaseDelay) {
+    Backoff backoff(500, 60000);
+    backoff.next(0);
+    backoff.next(0);
+
+    backoff.reset();
+
+    EXPECT_EQ(backoff.attempts(), 0u);
+    EXPECT_EQ(backoff.next(0), 250u);
+}
+
+TEST(BackoffTests, ManyFailures_NeverOverflow) {
+    Backoff backoff(1000, 60000);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_LE(backoff.next(UINT32_MAX), 60000u);
+    }
+}
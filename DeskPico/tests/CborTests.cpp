@@ -0,0 +1,126 @@
+#include "Cbor.h"
+#include "DeskMessages.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> bytes(std::initializer_list<int> list) {
+    return std::vector<uint8_t>(list.begin(), list.end());
+}
+
+} // namespace
+
+TEST(CborTests, Writer_UsesTheShortestHeads) {                               // RFC 8949 appendix A
+    uint8_t out[64];
+    CborWriter writer(out, sizeof(out));
+    writer.unsignedInt(23);
+    writer.unsignedInt(24);
+    writer.unsignedInt(1000);
+    writer.unsignedInt(1000000);
+    writer.integer(-1);
+    writer.integer(-1000);
+    writer.text("IETF");
+    writer.beginArray();
+    writer.boolean(true);
+    writer.end();
+
+    std::vector<uint8_t> expected = bytes({ 0x17, 0x18, 0x18, 0x19, 0x03, 0xe8, 0x1a, 0x00, 0x0f, 0x42, 0x40,
+                                            0x20, 0x39, 0x03, 0xe7, 0x64, 'I', 'E', 'T', 'F', 0x9f, 0xf5, 0xff });
+    ASSERT_TRUE(writer.ok());
+    EXPECT_EQ(std::vector<uint8_t>(out, out + writer.size()), expected);
+}
+
+TEST(CborTests, Writer_FlagsOverflowAndRewinds) {
+    uint8_t out[4];
+    CborWriter writer(out, sizeof(out));
+    writer.unsignedInt(1);
+    size_t mark = writer.mark();
+    writer.text("too long");
+
+    EXPECT_FALSE(writer.ok());
+    writer.rewind(mark);
+    EXPECT_TRUE(writer.ok());
+    EXPECT_EQ(writer.size(), 1u);
+}
+
+TEST(CborTests, Reader_SkipsNestedAndIndefiniteItems) {
+    std::vector<uint8_t> in = bytes({ 0x82, 0x9f, 0x01, 0xa1, 0x02, 0x03, 0xff, 0xc1, 0x1a, 0, 0, 0, 1, 0x07 });
+    CborReader reader(in.data(), in.size());
+    CborItem item;
+
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_EQ(item.type, CborType::Array);
+    ASSERT_TRUE(reader.skip(item));
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_EQ(item.type, CborType::Unsigned);
+    EXPECT_EQ(item.value, 7u);
+    EXPECT_TRUE(reader.atEnd());
+}
+
+TEST(CborTests, Reader_RejectsTruncatedInput) {
+    std::vector<uint8_t> in = bytes({ 0x83, 0x01, 0x65, 'a', 'b' });
+    CborReader reader(in.data(), in.size());
+    CborItem item;
+
+    ASSERT_TRUE(reader.next(item));
+    EXPECT_FALSE(reader.skip(item));
+    EXPECT_TRUE(reader.error());
+}
+
+TEST(DeskMessageTests, RoundTrip_KeepsEveryField) {
+    DeskMessage message;
+    message.command = WireCommand::Sit;
+    message.fields = DeskMessage::HAS_HEIGHT | DeskMessage::HAS_COLOUR | DeskMessage::HAS_TEXT
+                     | DeskMessage::HAS_UNTIL | DeskMessage::HAS_TONE;
+    message.heightMm = 720;
+    message.colour = 0xff8800;
+    strcpy(message.text, "Stand up");
+    message.untilS = 900;
+    message.toneHz = 1000;
+    message.toneMs = 300;
+    message.toneRepeat = 2;
+    uint8_t out[64];
+
+    size_t length = encodeDeskMessage(message, out, sizeof(out));
+    DeskMessage decoded;
+    ASSERT_GT(length, 0u);
+    ASSERT_TRUE(isDeskMessage(out, length));
+    ASSERT_TRUE(decodeDeskMessage(out, length, decoded));
+
+    EXPECT_EQ(decoded.command, WireCommand::Sit);
+    EXPECT_EQ(decoded.fields, message.fields);
+    EXPECT_EQ(decoded.heightMm, 720);
+    EXPECT_EQ(decoded.colour, 0xff8800u);
+    EXPECT_STREQ(decoded.text, "Stand up");
+    EXPECT_EQ(decoded.untilS, 900u);
+    EXPECT_EQ(decoded.toneHz, 1000);
+    EXPECT_EQ(decoded.toneMs, 300);
+    EXPECT_EQ(decoded.toneRepeat, 2);
+    EXPECT_EQ(toDeskCommand(decoded.command), DeskCommand::Sit);
+}
+
+TEST(DeskMessageTests, UnknownKeys_AreSkipped) {
+    // {9: [1, {"x": 2}], 0: 2, "note": "hi"}
+    std::vector<uint8_t> in = bytes({ 0xa3, 0x09, 0x82, 0x01, 0xa1, 0x61, 'x', 0x02, 0x00, 0x02,
+                                      0x64, 'n', 'o', 't', 'e', 0x62, 'h', 'i' });
+    DeskMessage message;
+
+    ASSERT_TRUE(decodeDeskMessage(in.data(), in.size(), message));
+    EXPECT_EQ(message.command, WireCommand::Occupy);
+    EXPECT_EQ(message.fields, 0);
+}
+
+TEST(DeskMessageTests, BadFields_AreRejected) {
+    DeskMessage message;
+    std::vector<uint8_t> textTooLong = bytes({ 0xa1, 0x03, 0x78, 0x15 });
+    textTooLong.resize(textTooLong.size() + 0x15, 'a');
+    std::vector<uint8_t> colourTooBig = bytes({ 0xa1, 0x02, 0x1a, 0x01, 0x00, 0x00, 0x00 });
+    std::vector<uint8_t> heightAsText = bytes({ 0xa1, 0x01, 0x61, '7' });
+
+    EXPECT_FALSE(decodeDeskMessage(textTooLong.data(), textTooLong.size(), message));
+    EXPECT_FALSE(decodeDeskMessage(colourTooBig.data(), colourTooBig.size(), message));
+    EXPECT_FALSE(decodeDeskMessage(heightAsText.data(), heightAsText.size(), message));
+    EXPECT_FALSE(isDeskMessage((const uint8_t*)"red", 3));
+}
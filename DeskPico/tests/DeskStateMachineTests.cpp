@@ -0,0 +1,187 @@
+#include "DeskStateMachine.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+// Brings a fresh machine online and checks in, so tests start from Occupied
+DeskStateMachine occupiedDesk() {
+    DeskStateMachine desk;
+    desk.handle(DeskCommand::Connected);
+    desk.handle(DeskCommand::Occupy);
+    return desk;
+}
+
+} // namespace
+
+TEST(DeskStateMachineTests, ParseDeskCommand_KnownPayloads_MapToCommands) {
+    EXPECT_EQ(parseDeskCommand("red"), DeskCommand::Occupy);
+    EXPECT_EQ(parseDeskCommand("green"), DeskCommand::Free);
+    EXPECT_EQ(parseDeskCommand("reserved"), DeskCommand::Reserve);
+    EXPECT_EQ(parseDeskCommand("sit"), DeskCommand::Sit);
+    EXPECT_EQ(parseDeskCommand("stand"), DeskCommand::Stand);
+}
+
+TEST(DeskStateMachineTests, ParseDeskCommand_UnknownOrPartialPayload_IsUnknown) {
+    EXPECT_EQ(parseDeskCommand(""), DeskCommand::Unknown);
+    EXPECT_EQ(parseDeskCommand("buzz"), DeskCommand::Unknown);
+    EXPECT_EQ(parseDeskCommand("re"), DeskCommand::Unknown);
+    EXPECT_EQ(parseDeskCommand("RED"), DeskCommand::Unknown);
+}
+
+TEST(DeskStateMachineTests, StartsOfflineAndGoesFreeOnConnect) {
+    DeskStateMachine desk;
+    EXPECT_EQ(desk.state(), DeskState::Offline);
+    EXPECT_EQ(desk.output().screen, DeskScreen::Offline);
+
+    uint8_t changed = desk.handle(DeskCommand::Connected);
+
+    EXPECT_EQ(desk.state(), DeskState::Free);
+    EXPECT_EQ(changed, DeskStateMachine::CHANGED_SCREEN | DeskStateMachine::CHANGED_LED);
+    EXPECT_EQ(desk.output().screen, DeskScreen::QrCode);
+    EXPECT_EQ(desk.output().led, DeskLed::Free);
+}
+
+TEST(DeskStateMachineTests, CommandsWhileOffline_AreIgnored) {
+    DeskStateMachine desk;
+
+    EXPECT_EQ(desk.handle(DeskCommand::Occupy), 0);
+    EXPECT_EQ(desk.handle(DeskCommand::Button), 0);
+    EXPECT_EQ(desk.state(), DeskState::Offline);
+    EXPECT_EQ(desk.ignored(), 2u);
+}
+
+TEST(DeskStateMachineTests, RepeatedCommand_ProducesNoOutput) {
+    DeskStateMachine desk = occupiedDesk();
+    uint32_t transitions = desk.transitions();
+
+    EXPECT_EQ(desk.handle(DeskCommand::Occupy), 0);
+    EXPECT_EQ(desk.state(), DeskState::Occupied);
+    EXPECT_EQ(desk.transitions(), transitions);
+}
+
+TEST(DeskStateMachineTests, SitWhileFree_IsIgnored) {
+    DeskStateMachine desk;
+    desk.handle(DeskCommand::Connected);
+
+    EXPECT_EQ(desk.handle(DeskCommand::Sit), 0);
+    EXPECT_EQ(desk.state(), DeskState::Free);
+}
+
+TEST(DeskStateMachineTests, SitWhileOccupied_StartsPromptAndKeepsLed) {
+    DeskStateMachine desk = occupiedDesk();
+
+    uint8_t changed = desk.handle(DeskCommand::Sit);
+
+    EXPECT_EQ(desk.state(), DeskState::Adjusting);
+    EXPECT_EQ(changed, DeskStateMachine::CHANGED_SCREEN | DeskStateMachine::START_PROMPT);
+    EXPECT_EQ(desk.output().screen, DeskScreen::SitDown);
+    EXPECT_EQ(desk.output().led, DeskLed::Occupied);
+}
+
+TEST(DeskStateMachineTests, StandDuringSitPrompt_RestartsPromptWithNewScreen) {
+    DeskStateMachine desk = occupiedDesk();
+    desk.handle(DeskCommand::Sit);
+
+    uint8_t changed = desk.handle(DeskCommand::Stand);
+
+    EXPECT_EQ(desk.state(), DeskState::Adjusting);
+    EXPECT_EQ(changed, DeskStateMachine::CHANGED_SCREEN | DeskStateMachine::START_PROMPT);
+    EXPECT_EQ(desk.output().screen, DeskScreen::StandUp);
+}
+
+TEST(DeskStateMachineTests, SameCommandDuringPrompt_RestartsPromptOnly) {
+    DeskStateMachine desk = occupiedDesk();
+    desk.handle(DeskCommand::Sit);
+
+    EXPECT_EQ(desk.handle(DeskCommand::Sit), DeskStateMachine::START_PROMPT);
+}
+
+TEST(DeskStateMachineTests, PromptDone_ReturnsToOccupiedScreen) {
+    DeskStateMachine desk = occupiedDesk();
+    desk.handle(DeskCommand::Stand);
+
+    uint8_t changed = desk.handle(DeskCommand::PromptDone);
+
+    EXPECT_EQ(desk.state(), DeskState::Occupied);
+    EXPECT_EQ(changed, DeskStateMachine::CHANGED_SCREEN);
+    EXPECT_EQ(desk.output().screen, DeskScreen::Occupied);
+}
+
+TEST(DeskStateMachineTests, Button_TogglesCheckInAndCheckOut) {
+    DeskStateMachine desk;
+    desk.handle(DeskCommand::Connected);
+
+    desk.handle(DeskCommand::Button);
+    EXPECT_EQ(desk.state(), DeskState::Occupied);
+
+    desk.handle(DeskCommand::Button);
+    EXPECT_EQ(desk.state(), DeskState::Free);
+}
+
+TEST(DeskStateMachineTests, Reserved_PulsesAndChecksInOnOccupy) {
+    DeskStateMachine desk;
+    desk.handle(DeskCommand::Connected);
+
+    desk.handle(DeskCommand::Reserve);
+    EXPECT_EQ(desk.state(), DeskState::Reserved);
+    EXPECT_EQ(desk.output().led, DeskLed::Reserved);
+
+    desk.handle(DeskCommand::Occupy);
+    EXPECT_EQ(desk.state(), DeskState::Occupied);
+}
+
+TEST(DeskStateMachineTests, Disconnect_GoesOfflineFromAnyOnlineState) {
+    const DeskCommand toState[][2] = {
+        { DeskCommand::Unknown, DeskCommand::Unknown },                      // Free
+        { DeskCommand::Reserve, DeskCommand::Unknown },                      // Reserved
+        { DeskCommand::Occupy,  DeskCommand::Unknown },                      // Occupied
+        { DeskCommand::Occupy,  DeskCommand::Sit     },                      // Adjusting
+    };
+    for (const auto& path : toState) {
+        DeskStateMachine desk;
+        desk.handle(DeskCommand::Connected);
+        desk.handle(path[0]);
+        desk.handle(path[1]);
+
+        desk.handle(DeskCommand::Disconnected);
+
+        EXPECT_EQ(desk.state(), DeskState::Offline);
+        EXPECT_EQ(desk.output().led, DeskLed::Off);
+    }
+}
+
+TEST(DeskStateMachineTests, Reconnect_FromOccupied_ReturnsToOccupied) {
+    DeskStateMachine desk = occupiedDesk();
+    desk.handle(DeskCommand::Disconnected);
+
+    uint8_t changed = desk.handle(DeskCommand::Connected);
+
+    EXPECT_EQ(desk.state(), DeskState::Occupied);
+    EXPECT_EQ(desk.output().screen, DeskScreen::Occupied);
+    EXPECT_EQ(changed, DeskStateMachine::CHANGED_SCREEN | DeskStateMachine::CHANGED_LED);
+}
+
+TEST(DeskStateMachineTests, Reconnect_FromReserved_ReturnsToReserved_UntilOverridden) {
+    DeskStateMachine desk;
+    desk.handle(DeskCommand::Connected);
+    desk.handle(DeskCommand::Reserve);
+    desk.handle(DeskCommand::Disconnected);
+
+    desk.handle(DeskCommand::Connected);
+    EXPECT_EQ(desk.state(), DeskState::Reserved);
+    EXPECT_EQ(desk.output().led, DeskLed::Reserved);
+
+    desk.handle(DeskCommand::Free);                                          // Retained state that arrives next
+    EXPECT_EQ(desk.state(), DeskState::Free);
+}
+
+TEST(DeskStateMachineTests, Reconnect_DuringPrompt_ReturnsToOccupiedWithoutPrompt) {
+    DeskStateMachine desk = occupiedDesk();
+    desk.handle(DeskCommand::Stand);
+    desk.handle(DeskCommand::Disconnected);
+
+    uint8_t changed = desk.handle(DeskCommand::Connected);
+
+    EXPECT_EQ(desk.state(), DeskState::Occupied);
+    EXPECT_FALSE(changed & DeskStateMachine::START_PROMPT);
+}
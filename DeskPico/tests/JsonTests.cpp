@@ -0,0 +1,160 @@
+#include "Json.h"
+#include "DeskMessages.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+namespace {
+
+struct Parsed {
+    explicit Parsed(const std::string& text, size_t maxTokens = 32)
+        : text(text), doc(this->text.data(), this->text.size(), tokens, maxTokens)
+    {
+    }
+
+    std::string text;
+    JsonToken tokens[32];
+    JsonDocument doc;
+};
+
+bool decodeJson(const std::string& text, DeskMessage& message) {
+    return decodeDeskJson((const uint8_t*)text.data(), text.size(), message);
+}
+
+} // namespace
+
+TEST(JsonTests, Tokens_AreOffsetsWithParentLinks) {
+    Parsed p(R"({"a": [1, "x"], "b": {}})");
+
+    ASSERT_TRUE(p.doc.ok());
+    ASSERT_EQ(p.doc.count(), 7);                                             // {} a [] 1 "x" b {}
+    EXPECT_EQ(p.doc.token(0).type, JsonType::Object);
+    EXPECT_EQ(p.doc.token(0).size, 2);
+    EXPECT_EQ(p.doc.raw(1), "a");
+    EXPECT_EQ(p.doc.token(2).parent, 1);                                     // The key owns its value
+    EXPECT_EQ(p.doc.raw(2), R"([1, "x"])");
+    EXPECT_EQ(p.doc.token(4).type, JsonType::String);
+    EXPECT_EQ(p.doc.next(1), 5);                                             // Past the key and its array
+    EXPECT_EQ(p.doc.token(6).size, 0);
+}
+
+TEST(JsonTests, Invalid_AndPartial_AreTold) {
+    const char* invalid[] = {
+        "", "{", R"({"a" 1})", R"({"a":1,})", "[1 2]", R"({1:2})", "[01]", "[1.]", "[-]", "[tru]",
+        R"(["\x"])", "{\"a\":\"\x01\"}", "[1]]", "[1] [2]", R"({"a":1])", "'a'",
+    };
+    for (const char* text : invalid) {
+        Parsed p(text);
+        EXPECT_FALSE(p.doc.ok()) << text;
+        EXPECT_EQ(p.doc.count(), 0) << text;
+    }
+
+    EXPECT_EQ(Parsed(R"({"a":[1,)").doc.error(), JsonError::Partial);
+    EXPECT_EQ(Parsed(R"({"a":"unterminated)").doc.error(), JsonError::Partial);
+    EXPECT_EQ(Parsed("[tr").doc.error(), JsonError::Partial);
+    EXPECT_EQ(Parsed("[1] x").doc.error(), JsonError::Invalid);
+    EXPECT_TRUE(Parsed(" [ -0.5e+3 , true , null , \"\" ] ").doc.ok());
+    EXPECT_TRUE(Parsed("42").doc.ok());
+}
+
+TEST(JsonTests, TooManyTokens_IsNoMemory) {
+    EXPECT_EQ(Parsed("[1,2,3]", 3).doc.error(), JsonError::NoMemory);
+    EXPECT_TRUE(Parsed("[1,2,3]", 4).doc.ok());
+}
+
+TEST(JsonTests, Find_FollowsKeysAndIndexes) {
+    Parsed p(R"({"desk": {"tone": [440, 120, 2], "name": "A"}, "n": -7, "on": false})");
+    int64_t value = 0;
+    bool flag = true;
+
+    ASSERT_TRUE(p.doc.getInt(p.doc.find("desk.tone[1]"), value));
+    EXPECT_EQ(value, 120);
+    ASSERT_TRUE(p.doc.getInt(p.doc.find("n"), value));
+    EXPECT_EQ(value, -7);
+    ASSERT_TRUE(p.doc.getBool(p.doc.find("on"), flag));
+    EXPECT_FALSE(flag);
+    EXPECT_TRUE(p.doc.equals(p.doc.find("desk.name"), "A"));
+    EXPECT_EQ(p.doc.find("desk.tone[3]"), -1);
+    EXPECT_EQ(p.doc.find("desk.missing"), -1);
+    EXPECT_EQ(p.doc.find("n.deeper"), -1);
+    EXPECT_EQ(p.doc.find("desk.tone[x]"), -1);
+    EXPECT_EQ(p.doc.find("[1]", p.doc.find("desk.tone")), p.doc.find("desk.tone[1]"));
+}
+
+TEST(JsonTests, Numbers_OnlyIntegralFitAsInt) {
+    Parsed p(R"([9223372036854775807, -9223372036854775808, 9223372036854775808, 1.5, 1e3, null])");
+    int64_t value = 0;
+
+    ASSERT_TRUE(p.doc.getInt(p.doc.element(0, 0), value));
+    EXPECT_EQ(value, INT64_MAX);
+    ASSERT_TRUE(p.doc.getInt(p.doc.element(0, 1), value));
+    EXPECT_EQ(value, INT64_MIN);
+    EXPECT_FALSE(p.doc.getInt(p.doc.element(0, 2), value));
+    EXPECT_FALSE(p.doc.getInt(p.doc.element(0, 3), value));
+    EXPECT_FALSE(p.doc.getInt(p.doc.element(0, 4), value));
+    EXPECT_TRUE(p.doc.isNull(p.doc.element(0, 5)));
+}
+
+TEST(JsonTests, Strings_AreUnescapedIntoTheCallersBuffer) {
+    Parsed p(R"(["a\"b\\c\/\n", "æ€😀", "\ud800x", "key"])");
+    char out[16];
+
+    ASSERT_TRUE(p.doc.getString(p.doc.element(0, 0), out, sizeof(out)));
+    EXPECT_STREQ(out, "a\"b\\c/\n");
+    ASSERT_TRUE(p.doc.getString(p.doc.element(0, 1), out, sizeof(out)));
+    EXPECT_STREQ(out, "\xc3\xa6\xe2\x82\xac\xf0\x9f\x98\x80");
+    ASSERT_TRUE(p.doc.getString(p.doc.element(0, 2), out, sizeof(out)));
+    EXPECT_STREQ(out, "\xef\xbf\xbdx");                                     // Lone surrogate
+    EXPECT_TRUE(p.doc.equals(p.doc.element(0, 3), "key"));
+    EXPECT_FALSE(p.doc.getString(p.doc.element(0, 1), out, 9));             // No room for the terminator
+}
+
+TEST(JsonTests, Text_IsNotModified) {
+    std::string text = R"({"text": "Anna\n14:00"})";
+    std::string copy = text;
+    JsonToken tokens[4];
+    JsonDocument doc(text.data(), text.size(), tokens, 4);
+    char out[16];
+
+    ASSERT_TRUE(doc.getString(doc.find("text"), out, sizeof(out)));
+    EXPECT_EQ(text, copy);
+}
+
+TEST(DeskJsonTests, StructuredCommand_FillsTheMessage) {
+    DeskMessage message;
+
+    ASSERT_TRUE(decodeJson(R"({"state":"occupied","height":720,"text":"Anna 14:00"})", message));
+    EXPECT_EQ(message.command, WireCommand::Occupy);
+    EXPECT_EQ(message.fields, DeskMessage::HAS_HEIGHT | DeskMessage::HAS_TEXT);
+    EXPECT_EQ(message.heightMm, 720);
+    EXPECT_STREQ(message.text, "Anna 14:00");
+
+    ASSERT_TRUE(decodeJson(R"({"cmd":"buzz","tone":[880,200,3],"colour":"#ff8000","future":{"x":[1]}})", message));
+    EXPECT_EQ(message.command, WireCommand::Buzz);
+    EXPECT_EQ(message.toneHz, 880);
+    EXPECT_EQ(message.toneRepeat, 3);
+    EXPECT_EQ(message.colour, 0xff8000u);
+}
+
+TEST(DeskJsonTests, WrongTypesAndRanges_AreRejected) {
+    DeskMessage message;
+
+    EXPECT_FALSE(decodeJson(R"({"state":"busy"})", message));
+    EXPECT_FALSE(decodeJson(R"({"cmd":2})", message));
+    EXPECT_FALSE(decodeJson(R"({"height":-1})", message));
+    EXPECT_FALSE(decodeJson(R"({"height":70000})", message));
+    EXPECT_FALSE(decodeJson(R"({"colour":"#ff80"})", message));
+    EXPECT_FALSE(decodeJson(R"({"text":"far more than twenty bytes"})", message));
+    EXPECT_FALSE(decodeJson(R"({"tone":[880,200]})", message));
+    EXPECT_FALSE(decodeJson(R"(["sit"])", message));
+    EXPECT_EQ(message.command, WireCommand::None);
+}
+
+TEST(DeskJsonTests, IsDeskJson_OnlyForObjects) {
+    auto is = [](const char* text) { return isDeskJson((const uint8_t*)text, strlen(text)); };
+
+    EXPECT_TRUE(is(" \n{\"cmd\":\"sit\"}"));
+    EXPECT_FALSE(is("sit"));
+    EXPECT_FALSE(is("[]"));
+    EXPECT_FALSE(is(""));
+}
@@ -0,0 +1,313 @@
+#include "MqttClient.h"
+#include "HostHal.h"
+#include "pico/cyw43_arch.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+const char* LED_TOPIC = "f1:50:c2:b8:bf:22/led";
+const char* STATUS_TOPIC = "desks/f1:50:c2:b8:bf:22/status";
+
+// Counts calls; returns true for "act"
+bool countingHandler(void* arg, const uint8_t* payload, uint16_t length) {
+    (*static_cast<int*>(arg))++;
+    return std::string((const char*)payload, length) == "act";
+}
+
+// A client connected and subscribed through the host loopback broker
+class MqttClientTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        host_mqtt_set_loopback(true);
+        host_mqtt_reset_broker();
+        state = mqtt_client_init();
+        mqtt_create_client(state);
+        ledRoute = mqtt_add_route(state, LED_TOPIC, 0, countingHandler, &handled);
+        ASSERT_EQ(mqtt_start_dns_lookup(state), ERR_OK);
+        ASSERT_EQ(mqtt_test_connect(state), ERR_OK);
+        pollUntil([this] { return mqtt_client_is_connected(state->mqtt_client) != 0; });
+        mqtt_subscribe_to_topics(state);
+        pollUntil([] { return false; });                                     // Let the SUBACK through
+    }
+
+    void TearDown() override {
+        mqtt_disconnect(state->mqtt_client);
+        mqtt_client_free(state->mqtt_client);
+        free(state);
+    }
+
+    void reconnect() {
+        mqtt_close_session(state);
+        ASSERT_EQ(mqtt_test_connect(state), ERR_OK);
+        pollUntil([this] { return mqtt_client_is_connected(state->mqtt_client) != 0; });
+        mqtt_subscribe_to_topics(state);
+        pollUntil([] { return false; });
+    }
+
+    std::string retained(const char* topic) {
+        char payload[32];
+        return std::string(payload, host_mqtt_retained(topic, payload, sizeof(payload)));
+    }
+
+    template <typename Cond>
+    void pollUntil(Cond cond) {
+        for (int i = 0; i < 10 && !cond(); i++) {
+            cyw43_arch_poll();
+        }
+    }
+
+    void publish(const std::string& payload) {
+        ASSERT_EQ(host_mqtt_deliver(LED_TOPIC, payload.data(), payload.size()), 1);
+    }
+
+    MQTT_CLIENT_T* state = nullptr;
+    uint8_t ledRoute = MQTT_ROUTE_NONE;
+    int handled = 0;
+};
+
+} // namespace
+
+TEST_F(MqttClientTests, PayloadAcrossFragments_ArrivesIntactInOneRecord) {
+    std::string payload;
+    for (int i = 0; i < MESSAGE_PAYLOAD_MAX; i++) {                          // A full record: fragments, past the old u8 length
+        payload += (char)('a' + i % 26);
+    }
+
+    publish(payload);
+
+    const message_record_t* record = message_queue_peek(&state->inbox);
+    ASSERT_NE(record, nullptr);
+    EXPECT_EQ(record->topic_id, ledRoute);
+    EXPECT_EQ(record->length, MESSAGE_PAYLOAD_MAX);
+    EXPECT_EQ(std::string((const char*)record->payload), payload);
+}
+
+TEST_F(MqttClientTests, OversizePayload_IsSkippedAndNextMessageIsIntact) {
+    publish(std::string(MESSAGE_PAYLOAD_MAX + 1, 'x'));
+    publish("red");
+
+    EXPECT_EQ(state->rx_oversize, 1u);
+    ASSERT_EQ(message_queue_count(&state->inbox), 1u);
+    EXPECT_STREQ((const char*)message_queue_peek(&state->inbox)->payload, "red");
+}
+
+TEST_F(MqttClientTests, EmptyPayload_IsQueuedWithZeroLength) {
+    publish("");
+
+    const message_record_t* record = message_queue_peek(&state->inbox);
+    ASSERT_NE(record, nullptr);
+    EXPECT_EQ(record->length, 0);
+    EXPECT_EQ(record->payload[0], 0);
+}
+
+TEST_F(MqttClientTests, FullInbox_DropsAndCountsOverflow) {
+    for (int i = 0; i < MESSAGE_QUEUE_LEN; i++) {
+        publish("green");
+    }
+    publish("red");
+
+    EXPECT_EQ(message_queue_count(&state->inbox), (uint32_t)MESSAGE_QUEUE_LEN);
+    EXPECT_EQ(state->inbox.overflows, 1u);
+}
+
+TEST_F(MqttClientTests, UnroutedTopic_IsNotDeliveredOrQueued) {
+    mqtt_add_route(state, "desks/+/status", 0, countingHandler, &handled);
+    pollUntil([] { return false; });
+
+    host_mqtt_deliver("desks/a/b/status", "x", 1);                           // Subscribed nowhere: not delivered
+    EXPECT_EQ(message_queue_count(&state->inbox), 0u);
+    EXPECT_EQ(host_mqtt_deliver("desks/a/status", "x", 1), 1);
+    EXPECT_EQ(message_queue_count(&state->inbox), 1u);
+}
+
+TEST_F(MqttClientTests, SubscriptionsBeyondTheRequestQueue_AreAllSent) {
+    char filter[MQTT_FILTER_MAX];
+    for (int i = 0; i < MQTT_ROUTES_MAX - 1; i++) {                         // More than MQTT_REQ_MAX_IN_FLIGHT
+        snprintf(filter, sizeof(filter), "extra/%d", i);
+        ASSERT_NE(mqtt_add_route(state, filter, 0, countingHandler, &handled), MQTT_ROUTE_NONE);
+    }
+    pollUntil([this] { return state->sub_next == state->route_count && state->sub_pending == 0; });
+
+    EXPECT_EQ(state->sub_failed, 0u);
+    EXPECT_EQ(host_mqtt_deliver("extra/6", "x", 1), 1);
+    EXPECT_EQ(mqtt_add_route(state, "one/too/many", 0, countingHandler, &handled), MQTT_ROUTE_NONE);
+}
+
+TEST_F(MqttClientTests, Dispatch_RunsHandlersUntilOneActs) {
+    publish("ignore");
+    publish("act");
+    publish("later");
+
+    EXPECT_TRUE(mqtt_dispatch(state));
+    EXPECT_EQ(handled, 2);
+    EXPECT_EQ(message_queue_count(&state->inbox), 1u);
+    EXPECT_FALSE(mqtt_dispatch(state));
+    EXPECT_EQ(handled, 3);
+    EXPECT_EQ(message_queue_count(&state->inbox), 0u);
+}
+
+TEST_F(MqttClientTests, FullOutputRing_RefusesPublishWithErrMem) {
+    std::string payload(MQTT_OUTPUT_RINGBUF_SIZE * 2 / 3, 'x');
+
+    EXPECT_EQ(mqtt_publish_message(state, "desks/x/telemetry", payload.data(), payload.size(), 0, 0), ERR_OK);
+    EXPECT_EQ(mqtt_publish_message(state, "desks/x/telemetry", payload.data(), payload.size(), 0, 0), ERR_MEM);
+    EXPECT_EQ(state->tx_backpressure, 1u);
+
+    cyw43_arch_poll();                                                       // Ring drains
+    EXPECT_EQ(mqtt_publish_message(state, "desks/x/telemetry", payload.data(), payload.size(), 0, 0), ERR_OK);
+    EXPECT_EQ(state->tx_published, 2u);
+}
+
+TEST_F(MqttClientTests, QosOneRedelivery_IsDroppedButReusedIdsAreNot) {
+    mqtt_add_route(state, "qos1/#", 1, countingHandler, &handled);
+    pollUntil([] { return false; });
+
+    EXPECT_EQ(host_mqtt_deliver_qos("qos1/a", "x", 1, 1, 7, false), 1);
+    EXPECT_EQ(host_mqtt_deliver_qos("qos1/a", "x", 1, 1, 7, true), 1);      // PUBACK lost, sent again
+    EXPECT_EQ(message_queue_count(&state->inbox), 1u);
+    EXPECT_EQ(state->rx_duplicates, 1u);
+
+    host_mqtt_deliver_qos("qos1/a", "y", 1, 1, 7, false);                   // Id free again: a new message
+    host_mqtt_deliver_qos("qos1/a", "z", 1, 1, 9, true);                    // DUP of one never seen
+    EXPECT_EQ(message_queue_count(&state->inbox), 3u);
+    EXPECT_EQ(state->rx_duplicates, 1u);
+}
+
+TEST_F(MqttClientTests, QosOneDroppedForAFullInbox_IsTakenWhenSentAgain) {
+    mqtt_add_route(state, "qos1/#", 1, countingHandler, &handled);
+    pollUntil([] { return false; });
+    for (int i = 0; i < MESSAGE_QUEUE_LEN; i++) {
+        host_mqtt_deliver_qos("qos1/a", "x", 1, 1, (uint16_t)(100 + i), false);
+    }
+
+    host_mqtt_deliver_qos("qos1/a", "y", 1, 1, 7, false);                   // Acknowledged, but no room
+    EXPECT_EQ(state->rx_lost, 1u);
+    mqtt_dispatch(state);                                                    // Inbox drained
+    host_mqtt_deliver_qos("qos1/a", "y", 1, 1, 7, true);                    // The broker sends it again
+
+    EXPECT_EQ(state->rx_duplicates, 0u);
+    ASSERT_EQ(message_queue_count(&state->inbox), 1u);
+    EXPECT_STREQ((const char*)message_queue_peek(&state->inbox)->payload, "y");
+}
+
+TEST_F(MqttClientTests, QosZeroRoute_IsDeliveredWithoutPacketIds) {
+    host_mqtt_deliver_qos(LED_TOPIC, "red", 3, 1, 5, false);                 // Downgraded to the route's QoS 0
+    host_mqtt_deliver_qos(LED_TOPIC, "red", 3, 1, 5, true);
+
+    EXPECT_EQ(message_queue_count(&state->inbox), 2u);
+    EXPECT_EQ(state->rx_duplicates, 0u);
+}
+
+TEST_F(MqttClientTests, QosOnePublishes_AreLimitedToTheInFlightWindow) {
+    for (int i = 0; i < MQTT_PUB_INFLIGHT_MAX; i++) {
+        EXPECT_EQ(mqtt_publish_message(state, "desks/x/state", "s", 1, 1, 0), ERR_OK);
+    }
+    EXPECT_EQ(mqtt_publish_message(state, "desks/x/state", "s", 1, 1, 0), ERR_MEM);
+    EXPECT_EQ(mqtt_publish_message(state, "desks/x/telemetry", "t", 1, 0, 0), ERR_OK);   // QoS 0 is not held back
+    EXPECT_EQ(state->tx_backpressure, 1u);
+
+    cyw43_arch_poll();                                                       // PUBACKs
+    EXPECT_EQ(state->tx_inflight, 0);
+    EXPECT_EQ(state->tx_acked, (uint32_t)MQTT_PUB_INFLIGHT_MAX);
+    EXPECT_EQ(mqtt_publish_message(state, "desks/x/state", "s", 1, 1, 0), ERR_OK);
+}
+
+TEST_F(MqttClientTests, LostSession_ReleasesTheInFlightWindow) {
+    mqtt_publish_message(state, "desks/x/state", "s", 1, 1, 0);
+
+    mqtt_close_session(state);
+
+    EXPECT_EQ(state->tx_inflight, 0);
+    EXPECT_EQ(state->tx_acked, 0u);
+}
+
+TEST_F(MqttClientTests, ClientId_IsUniquePerBoard) {
+    EXPECT_STREQ(state->client_id, "desk-f150c2b8bf22");
+    EXPECT_FALSE(state->session_present);                                    // Nothing kept yet
+}
+
+TEST_F(MqttClientTests, RetainedState_ArrivesRightAfterSubscribing) {
+    host_mqtt_retain("state/desk", "occupied", 8);
+    mqtt_add_route(state, "state/desk", 1, countingHandler, &handled);
+    pollUntil([] { return false; });
+
+    const message_record_t* record = message_queue_peek(&state->inbox);
+    ASSERT_NE(record, nullptr);
+    EXPECT_STREQ((const char*)record->payload, "occupied");
+}
+
+TEST_F(MqttClientTests, KeptSession_GetsWhatWasMissedWhileAway) {
+    mqtt_add_route(state, "qos1/#", 1, countingHandler, &handled);
+    pollUntil([] { return false; });
+    host_mqtt_deliver_qos("qos1/a", "before", 6, 1, 0, false);
+    mqtt_dispatch(state);
+
+    mqtt_close_session(state);
+    EXPECT_EQ(host_mqtt_deliver_qos("qos1/a", "missed", 6, 1, 0, false), 0);  // Queued by the broker
+    host_mqtt_deliver_qos(LED_TOPIC, "red", 3, 1, 0, false);                 // QoS 0 route: not kept
+    reconnect();
+
+    EXPECT_TRUE(state->session_present);
+    ASSERT_EQ(message_queue_count(&state->inbox), 1u);
+    EXPECT_STREQ((const char*)message_queue_peek(&state->inbox)->payload, "missed");
+}
+
+TEST_F(MqttClientTests, KeptSession_StillDropsRedeliveriesFromBefore) {
+    mqtt_add_route(state, "qos1/#", 1, countingHandler, &handled);
+    pollUntil([] { return false; });
+    host_mqtt_deliver_qos("qos1/a", "x", 1, 1, 42, false);
+
+    reconnect();
+    host_mqtt_deliver_qos("qos1/a", "x", 1, 1, 42, true);                   // PUBACK was lost with the link
+
+    EXPECT_EQ(message_queue_count(&state->inbox), 1u);
+    EXPECT_EQ(state->rx_duplicates, 1u);
+}
+
+TEST_F(MqttClientTests, Status_IsRetainedOnline_UntilTheWillReplacesIt) {
+    ASSERT_EQ(mqtt_publish_status(state), ERR_OK);
+    cyw43_arch_poll();
+    EXPECT_EQ(retained(STATUS_TOPIC), MQTT_STATUS_ONLINE);
+
+    mqtt_close_session(state);                                               // No DISCONNECT, like lwIP
+
+    EXPECT_EQ(retained(STATUS_TOPIC), MQTT_STATUS_OFFLINE);
+    reconnect();
+    ASSERT_EQ(mqtt_publish_status(state), ERR_OK);
+    cyw43_arch_poll();
+    EXPECT_EQ(retained(STATUS_TOPIC), MQTT_STATUS_ONLINE);
+}
+
+TEST(MqttTopicTests, FilterMatching) {
+    EXPECT_TRUE(mqtt_topic_matches("a/b", "a/b"));
+    EXPECT_FALSE(mqtt_topic_matches("a/b", "a/bc"));
+    EXPECT_FALSE(mqtt_topic_matches("a/bc", "a/b"));
+    EXPECT_FALSE(mqtt_topic_matches("a/b", "a/b/c"));
+    EXPECT_TRUE(mqtt_topic_matches("a/+/c", "a/b/c"));
+    EXPECT_TRUE(mqtt_topic_matches("a/+", "a/"));                            // Empty level
+    EXPECT_FALSE(mqtt_topic_matches("a/+", "a/b/c"));
+    EXPECT_TRUE(mqtt_topic_matches("+/+", "/x"));
+    EXPECT_TRUE(mqtt_topic_matches("a/#", "a/b/c"));
+    EXPECT_TRUE(mqtt_topic_matches("a/#", "a"));                             // # includes the parent
+    EXPECT_FALSE(mqtt_topic_matches("a/#", "ab"));
+    EXPECT_TRUE(mqtt_topic_matches("#", "desks/x/led"));
+    EXPECT_FALSE(mqtt_topic_matches("#", "$SYS/uptime"));
+    EXPECT_FALSE(mqtt_topic_matches("+/uptime", "$SYS/uptime"));
+    EXPECT_TRUE(mqtt_topic_matches("$SYS/#", "$SYS/uptime"));
+}
+
+TEST(MqttTopicTests, DeskTopic_UsesTheBoardMac) {
+    const uint8_t mac[6] = { 0x0a, 0xbc, 0x00, 0x12, 0xef, 0x99 };
+    char topic[MQTT_FILTER_MAX];
+    host_set_mac(mac);
+
+    EXPECT_TRUE(mqtt_desk_topic(topic, sizeof(topic), "buzzer"));
+    EXPECT_STREQ(topic, "0a:bc:00:12:ef:99/buzzer");
+    EXPECT_FALSE(mqtt_desk_topic(topic, 20, "buzzer"));
+
+    const uint8_t defaultMac[6] = { 0xf1, 0x50, 0xc2, 0xb8, 0xbf, 0x22 };
+    host_set_mac(defaultMac);
+}
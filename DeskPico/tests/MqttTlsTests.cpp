@@ -0,0 +1,91 @@
+#include "MqttClient.h"
+#include "HostHal.h"
+#include "lwip/altcp_tls.h"
+#include "pico/cyw43_arch.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+
+namespace {
+
+// MqttClient.c with MQTT_TLS and MQTT_TLS_SESSION_FLASH. Each boot() is a
+// fresh client, as after a reset: only the flash is kept.
+class MqttTlsTests : public ::testing::Test {
+protected:
+    void SetUp() override {
+        host_mqtt_set_loopback(true);
+        host_mqtt_reset_broker();
+        host_flash_reset();
+    }
+
+    void TearDown() override {
+        shutdown();
+    }
+
+    void boot() {
+        shutdown();
+        state = mqtt_client_init();
+        mqtt_create_client(state);
+        ASSERT_EQ(mqtt_start_dns_lookup(state), ERR_OK);
+        ASSERT_EQ(mqtt_test_connect(state), ERR_OK);
+        for (int i = 0; i < 10 && !state->connect_done; i++) {
+            cyw43_arch_poll();
+        }
+        ASSERT_TRUE(mqtt_client_is_connected(state->mqtt_client));
+    }
+
+    void shutdown() {
+        if (state == nullptr) {
+            return;
+        }
+        mqtt_close_session(state);
+        mqtt_client_free(state->mqtt_client);
+        altcp_tls_free_session(state->tls_session);
+        altcp_tls_free_config(state->tls_config);
+        free(state);
+        state = nullptr;
+    }
+
+    MQTT_CLIENT_T* state = nullptr;
+};
+
+} // namespace
+
+TEST_F(MqttTlsTests, FirstSession_IsStoredAndResumedAfterReboot) {
+    boot();
+    EXPECT_EQ(host_tls_full_handshakes(), 1u);
+    EXPECT_EQ(host_flash_erases(), 1u);
+
+    boot();
+
+    EXPECT_EQ(host_tls_full_handshakes(), 1u);                               // Resumed from flash
+    EXPECT_EQ(host_flash_erases(), 1u);                                      // Same session: not written again
+    EXPECT_TRUE(state->tls_stored);
+}
+
+TEST_F(MqttTlsTests, Reconnects_DoNotWriteFlashAgain) {
+    boot();
+
+    for (int i = 0; i < 3; i++) {
+        mqtt_close_session(state);
+        host_tls_expire_sessions();                                          // New session every time
+        ASSERT_EQ(mqtt_test_connect(state), ERR_OK);
+        cyw43_arch_poll();
+        ASSERT_TRUE(mqtt_client_is_connected(state->mqtt_client));
+    }
+
+    EXPECT_EQ(host_tls_full_handshakes(), 4u);
+    EXPECT_EQ(host_flash_erases(), 1u);
+}
+
+TEST_F(MqttTlsTests, StoredSessionNoLongerResumed_IsReplacedByTheFullHandshake) {
+    boot();
+    host_tls_expire_sessions();
+
+    boot();                                                                  // Offers the stored one, in vain
+    EXPECT_EQ(host_tls_full_handshakes(), 2u);
+    EXPECT_EQ(host_flash_erases(), 2u);
+
+    boot();                                                                  // Resumes the new one
+    EXPECT_EQ(host_tls_full_handshakes(), 2u);
+    EXPECT_EQ(host_flash_erases(), 2u);
+}
@@ -0,0 +1,141 @@
+#include "OLEDDisplay.h"
+#include "MockDisplayTransport.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> initSequence(uint8_t height, uint8_t comPins) {
+    return {
+        SSD1306_SET_DISP,
+        SSD1306_SET_MEM_MODE, 0x00,
+        SSD1306_SET_DISP_START_LINE,
+        SSD1306_SET_SEG_REMAP | 0x01,
+        SSD1306_SET_MUX_RATIO, (uint8_t)(height - 1),
+        SSD1306_SET_COM_OUT_DIR,
+        SSD1306_SET_DISP_OFFSET, 0x00,
+        SSD1306_SET_COM_PIN_CFG, comPins,
+        SSD1306_SET_DISP_CLK_DIV, 0x80,
+        SSD1306_SET_PRECHARGE, 0xF1,
+        SSD1306_SET_VCOM_DESEL, 0x30,
+        SSD1306_SET_CONTRAST, 0xFF,
+        SSD1306_SET_ENTIRE_ON,
+        SSD1306_SET_NORM_DISP,
+        SSD1306_SET_CHARGE_PUMP, 0x14,
+        SSD1306_SET_SCROLL,
+        SSD1306_SET_DISP | 0x01,
+    };
+}
+
+} // namespace
+
+TEST(OLEDDisplayTests, Init_128x32_IsOneCommandStreamWithSequentialComPins) {
+    MockDisplayTransport bus;
+    OLEDDisplay128x32 display(bus);
+
+    display.init();
+
+    EXPECT_EQ(bus.resets, 1u);
+    EXPECT_EQ(bus.commandTransfers, 1u);
+    EXPECT_EQ(bus.commands, initSequence(32, 0x02));
+    EXPECT_EQ(bus.dataTransfers, 0u);
+}
+
+TEST(OLEDDisplayTests, Init_128x64_UsesAlternativeComPins) {
+    MockDisplayTransport bus;
+    OLEDDisplay128x64 display(bus);
+
+    display.init();
+
+    EXPECT_EQ(bus.commands, initSequence(64, 0x12));
+}
+
+TEST(OLEDDisplayTests, Render_AddressesEachPageThenSendsItsColumns) {
+    MockDisplayTransport bus;
+    OLEDDisplay128x32 display(bus);
+
+    display.render();
+
+    std::vector<uint8_t> expected;
+    for (uint8_t page = 0; page < OLEDDisplay128x32::NUM_PAGES; page++) {
+        expected.insert(expected.end(), { (uint8_t)(0xB0 + page), 0x00, 0x10 });
+    }
+    EXPECT_EQ(bus.commands, expected);
+    EXPECT_EQ(bus.commandTransfers, 4u);
+    ASSERT_EQ(bus.dataTransfers, 4u);
+    for (const std::vector<uint8_t>& transfer : bus.transfers) {
+        EXPECT_EQ(transfer.size(), 128u);
+    }
+}
+
+TEST(OLEDDisplayTests, Render_SendsBufferPagesBottomUp) {
+    MockDisplayTransport bus;
+    OLEDDisplay128x64 display(bus);
+    display.setPixel(5, 0, true);                                            // Page 0, bit 0
+    display.setPixel(127, 63, true);                                         // Page 7, bit 7
+
+    display.render();
+
+    ASSERT_EQ(bus.transfers.size(), 8u);
+    EXPECT_EQ(bus.transfers[0][127], 0x80);                                  // Device page 0 shows buffer page 7
+    EXPECT_EQ(bus.transfers[7][5], 0x01);
+    EXPECT_EQ(bus.dataBytes, (size_t)OLEDDisplay128x64::BUF_LEN);
+}
+
+TEST(OLEDDisplayTests, Render_SendsPagesInPlaceAndLeavesTheFrameIntact) {
+    MockDisplayTransport bus;
+    OLEDDisplay128x32 display(bus);
+    for (int y = 0; y < 32; y += 8) {
+        display.setPixel(127, y, true);                                      // Last byte of each page: the next one's headroom
+    }
+
+    display.render();
+    std::vector<std::vector<uint8_t>> first = bus.transfers;
+    bus.clearLog();
+    display.render();
+
+    EXPECT_EQ(bus.transfers, first);
+    for (const std::vector<uint8_t>& page : first) {
+        EXPECT_EQ(page[127], 0x01);
+    }
+}
+
+TEST(OLEDDisplayTests, RenderRaw_SetsTheWindowThenStreamsTheFrameOnce) {
+    MockDisplayTransport bus;
+    OLEDDisplay128x32 display(bus);
+    display.setPixel(3, 10, true);                                           // Page 1, bit 2
+    display.setPixel(3, 11, true);
+    display.setPixel(3, 11, false);
+
+    display.renderRaw();
+
+    std::vector<uint8_t> window = { SSD1306_SET_COL_ADDR, 0, 127, SSD1306_SET_PAGE_ADDR, 0, 3 };
+    EXPECT_EQ(bus.commands, window);
+    ASSERT_EQ(bus.dataTransfers, 1u);
+    ASSERT_EQ(bus.lastData.size(), (size_t)OLEDDisplay128x32::BUF_LEN);
+    EXPECT_EQ(bus.lastData[1 * 128 + 3], 0x04);
+    EXPECT_EQ(bus.lastData[0 * 128 + 3], 0x00);
+}
+
+TEST(OLEDDisplayTests, OutOfRangePixelsAndText_AreIgnored) {
+    MockDisplayTransport bus;
+    OLEDDisplay128x32 display(bus);
+    display.setPixel(-1, 0, true);
+    display.setPixel(128, 0, true);
+    display.setPixel(0, 32, true);
+    display.writeText(125, 0, "A");                                          // No room for the glyph
+
+    display.renderRaw();
+
+    EXPECT_EQ(bus.lastData, std::vector<uint8_t>(OLEDDisplay128x32::BUF_LEN, 0));
+}
+
+TEST(OLEDDisplayTests, Invert_IsASingleCommand) {
+    MockDisplayTransport bus;
+    OLEDDisplay128x32 display(bus);
+
+    display.invert(true);
+    display.invert(false);
+
+    EXPECT_EQ(bus.commands, (std::vector<uint8_t>{ SSD1306_SET_INV_DISP, SSD1306_SET_NORM_DISP }));
+}
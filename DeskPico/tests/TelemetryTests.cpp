@@ -0,0 +1,106 @@
+#include "Telemetry.h"
+#include "Cbor.h"
+#include "DeskMessages.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+struct Batch {
+    uint64_t seq = 0;
+    uint64_t dropped = 0;
+    std::vector<std::vector<int64_t>> samples;                              // [kind, ms, value]
+};
+
+// Decodes a telemetry batch; fails the test on anything off-schema
+Batch decode(const uint8_t* data, size_t size) {
+    Batch batch;
+    CborReader reader(data, size);
+    CborItem item;
+    EXPECT_TRUE(reader.next(item) && item.type == CborType::Map && item.value == 3);
+    for (int pair = 0; pair < 3; pair++) {
+        CborItem key;
+        EXPECT_TRUE(reader.next(key) && key.type == CborType::Unsigned);
+        if (key.value == TELEMETRY_SAMPLES) {
+            EXPECT_TRUE(reader.next(item) && item.type == CborType::Array && item.indefinite);
+            while (reader.next(item) && item.type != CborType::Break) {
+                EXPECT_EQ(item.type, CborType::Array);
+                std::vector<int64_t> sample;
+                for (uint64_t i = 0; i < item.value; i++) {
+                    CborItem field;
+                    reader.next(field);
+                    sample.push_back(field.asInt());
+                }
+                batch.samples.push_back(sample);
+            }
+        }
+        else {
+            reader.next(item);
+            (key.value == TELEMETRY_SEQ ? batch.seq : batch.dropped) = item.value;
+        }
+    }
+    EXPECT_TRUE(reader.atEnd());
+    EXPECT_FALSE(reader.error());
+    return batch;
+}
+
+} // namespace
+
+TEST(TelemetryTests, Encode_WritesOneCborBatch) {
+    Telemetry telemetry;
+    telemetry.record(TelemetryKind::Button, 1);
+    telemetry.record(TelemetryKind::Rssi, -61);
+    uint8_t out[128];
+    uint32_t end = 0;
+
+    size_t length = telemetry.encode(out, sizeof(out), 7, end);
+    Batch batch = decode(out, length);
+
+    EXPECT_EQ(batch.seq, 7u);
+    EXPECT_EQ(batch.dropped, 0u);
+    ASSERT_EQ(batch.samples.size(), 2u);
+    EXPECT_EQ(batch.samples[0][0], (int64_t)TelemetryKind::Button);
+    EXPECT_EQ(batch.samples[1][0], (int64_t)TelemetryKind::Rssi);
+    EXPECT_EQ(batch.samples[1][2], -61);
+    EXPECT_EQ(telemetry.pending(), 2u);                                      // Still there until consumed
+
+    telemetry.consume(end);
+    EXPECT_EQ(telemetry.pending(), 0u);
+    EXPECT_EQ(telemetry.encode(out, sizeof(out), 8, end), 0u);
+}
+
+TEST(TelemetryTests, SmallBuffer_LeavesTheRestForTheNextBatch) {
+    Telemetry telemetry;
+    for (int i = 0; i < 10; i++) {
+        telemetry.record(TelemetryKind::Uptime, 100000 + i);
+    }
+    uint8_t out[40];
+    uint32_t end = 0;
+
+    size_t length = telemetry.encode(out, sizeof(out), 0, end);
+    ASSERT_GT(length, 0u);
+    size_t sent = decode(out, length).samples.size();
+    EXPECT_GT(sent, 0u);
+    EXPECT_LT(sent, 10u);
+    telemetry.consume(end);
+
+    EXPECT_EQ(telemetry.pending(), 10u - sent);
+    EXPECT_EQ(telemetry.encode(out, 8, 0, end), 0u);                         // Not even one sample fits
+}
+
+TEST(TelemetryTests, FullRing_DropsTheOldest) {
+    Telemetry telemetry;
+    uint8_t out[1024];
+    uint32_t end = 0;
+    telemetry.record(TelemetryKind::Uptime, 0);
+    telemetry.encode(out, sizeof(out), 0, end);                              // In flight while the ring fills up
+
+    for (size_t i = 1; i <= Telemetry::CAPACITY; i++) {
+        telemetry.record(TelemetryKind::Uptime, (int32_t)i);
+    }
+    EXPECT_EQ(telemetry.dropped(), 1u);
+    EXPECT_EQ(telemetry.pending(), Telemetry::CAPACITY);
+
+    telemetry.consume(end);                                                  // Its sample is gone already
+    EXPECT_EQ(telemetry.pending(), Telemetry::CAPACITY);
+}